@@ -113,14 +113,16 @@ double interpolate(double v1, double v2, double factor) {
     return v1 + (v2 - v1) * factor;
 }
 
+// The tables have a uniform 10 degrees step, so the lower index is found in O(1)
+static constexpr double GRID_STEP_DEG = 10.0;
+
 // Helper function to find the closest lower index
 int findLowerIndex(double value, const double* array, int size) {
-    for (int i = 0; i < size - 1; ++i) {
-        if (array[i] <= value && array[i + 1] >= value) {
-            return i;
-        }
+    int index = static_cast<int>(std::floor((value - array[0]) / GRID_STEP_DEG));
+    if (index < 0) {
+        return 0;
     }
-    return size - 2; // if value is beyond the array range, return the second last index
+    return index < size - 2 ? index : size - 2;
 }
 
 void calculateMagneticFieldStrengthGauss(const double lat, const double lon, const double alt,
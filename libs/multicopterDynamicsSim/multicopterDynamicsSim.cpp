@@ -5,6 +5,8 @@
  * 
  */
 #include "multicopterDynamicsSim.hpp"
+#include "common_math.hpp"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 
@@ -133,6 +135,46 @@ void MulticopterDynamicsSim::setVehicleProperties(double vehicleMass,
     forceProcessNoiseAutoCorrelation_ = forceProcessNoiseAutoCorrelation;
 }
 
+/**
+ * @brief Replace the fault schedule
+ * 
+ * @param faults Faults with the sim time of this schedule
+ */
+void MulticopterDynamicsSim::setFaults(const std::vector<Fault> & faults){
+    if(isFaultNominalSaved_){
+        applyFaults(FaultEffects());
+    }
+    nominalThrustCoefficient_ = thrustCoefficient_;
+    nominalTorqueCoefficient_ = torqueCoefficient_;
+    nominalMaxMotorSpeed_ = maxMotorSpeed_;
+    nominalMinMotorSpeed_ = minMotorSpeed_;
+    nominalMotorPosition_.resize(numCopter_);
+    for (int indx = 0; indx < numCopter_; indx++){
+        nominalMotorPosition_.at(indx) = motorFrame_.at(indx).translation();
+    }
+    nominalVehicleMass_ = vehicleMass_;
+    isFaultNominalSaved_ = true;
+    faults_.setSchedule(faults);
+    faults_.setNominalMass(nominalVehicleMass_);
+}
+
+/**
+ * @brief Set the motors and the vehicle properties for the active faults
+ * 
+ * @param effects Combined effect of the active faults
+ */
+void MulticopterDynamicsSim::applyFaults(const FaultEffects & effects){
+    const Eigen::Vector3d cgOffset(effects.cgOffset.x(), -effects.cgOffset.y(), -effects.cgOffset.z());
+    for (int indx = 0; indx < numCopter_ && indx < static_cast<int>(FaultEffects::MOTORS_MAX_AMOUNT); indx++){
+        thrustCoefficient_.at(indx) = nominalThrustCoefficient_.at(indx)*effects.propFactor[indx];
+        torqueCoefficient_.at(indx) = nominalTorqueCoefficient_.at(indx)*effects.propFactor[indx];
+        maxMotorSpeed_.at(indx) = nominalMaxMotorSpeed_.at(indx)*effects.motorSpeedFactor[indx];
+        minMotorSpeed_.at(indx) = std::min(nominalMinMotorSpeed_.at(indx), maxMotorSpeed_.at(indx));
+        motorFrame_.at(indx).translation() = nominalMotorPosition_.at(indx) - cgOffset;
+    }
+    vehicleMass_ = nominalVehicleMass_ + effects.addedMass;
+}
+
 /**
  * @brief Set orientation of world-fixed reference frame using gravity vector
  * 
@@ -363,7 +405,7 @@ Eigen::Vector3d MulticopterDynamicsSim::getTotalForce(void){
  * @param motorSpeed Vector containing motor speeds
  * @return Eigen::Vector3d Thrust vector
  */
-Eigen::Vector3d MulticopterDynamicsSim::getThrust(const std::vector<double> & motorSpeed){
+Eigen::Vector3d MulticopterDynamicsSim::getThrust(const std::vector<double> & motorSpeed) const{
     Eigen::Vector3d thrust = Eigen::Vector3d::Zero();
     for (int indx = 0; indx < numCopter_; indx++){
 
@@ -380,7 +422,7 @@ Eigen::Vector3d MulticopterDynamicsSim::getThrust(const std::vector<double> & mo
  * @param motorAcceleration Vector of motor accelerations
  * @return Eigen::Vector3d Moment vector
  */
-Eigen::Vector3d MulticopterDynamicsSim::getControlMoment(const std::vector<double> & motorSpeed, const std::vector<double> & motorAcceleration){
+Eigen::Vector3d MulticopterDynamicsSim::getControlMoment(const std::vector<double> & motorSpeed, const std::vector<double> & motorAcceleration) const{
     Eigen::Vector3d controlMoment = Eigen::Vector3d::Zero();
 
     for (int indx = 0; indx < numCopter_; indx++){
@@ -403,7 +445,7 @@ Eigen::Vector3d MulticopterDynamicsSim::getControlMoment(const std::vector<doubl
  * @param angularVelocity Vehicle angular velocity
  * @return Eigen::Vector3d Aerodynamic moment vector
  */
-Eigen::Vector3d MulticopterDynamicsSim::getAeroMoment(const Eigen::Vector3d & angularVelocity){
+Eigen::Vector3d MulticopterDynamicsSim::getAeroMoment(const Eigen::Vector3d & angularVelocity) const{
     return (-angularVelocity.norm()*aeroMomentCoefficient_*angularVelocity);
 }
 
@@ -413,7 +455,7 @@ Eigen::Vector3d MulticopterDynamicsSim::getAeroMoment(const Eigen::Vector3d & an
  * @param velocity Vehicle velocity in world-fixed reference frame
  * @return Eigen::Vector3d Drag force vector
  */
-Eigen::Vector3d MulticopterDynamicsSim::getDragForce(const Eigen::Vector3d & velocity){
+Eigen::Vector3d MulticopterDynamicsSim::getDragForce(const Eigen::Vector3d & velocity) const{
     return (-dragCoefficient_*velocity.norm()*velocity);
 }
 
@@ -434,6 +476,38 @@ void MulticopterDynamicsSim::getIMUMeasurement(Eigen::Vector3d & accOutput, Eige
     }
 }
 
+/**
+ * @brief Get vehicle accelerations with the motors held at the commanded speed
+ * 
+ * @param attitude Vehicle attitude
+ * @param velocity Vehicle velocity in world-fixed reference frame
+ * @param angularVelocity Vehicle angular velocity in vehicle-fixed reference frame
+ * @param motorSpeedCommand Motor speed commands, the motor speed is equal to the bounded command
+ * @param velocityDer Output acceleration in world-fixed reference frame, without the stochastic force
+ * @param angularVelocityDer Output angular acceleration in vehicle-fixed reference frame, without the stochastic moment
+ */
+void MulticopterDynamicsSim::getSteadyStateDerivative(const Eigen::Quaterniond & attitude,
+                                                      const Eigen::Vector3d & velocity,
+                                                      const Eigen::Vector3d & angularVelocity,
+                                                      const std::vector<double> & motorSpeedCommandIn,
+                                                      bool isCmdPercent,
+                                                      Eigen::Vector3d & velocityDer,
+                                                      Eigen::Vector3d & angularVelocityDer) const{
+    std::vector<double> motorSpeed = motorSpeedCommandIn;
+    if(isCmdPercent)
+    {
+        for (size_t i = 0; i < motorSpeed.size(); i++)
+        {
+            motorSpeed[i] *= maxMotorSpeed_[i];
+        }
+    }
+    vectorBoundOp(motorSpeed,motorSpeed,minMotorSpeed_,maxMotorSpeed_);
+
+    const std::vector<double> motorAcceleration(numCopter_, 0.);
+    velocityDer = getVelocityDerivative(attitude,Eigen::Vector3d::Zero(),velocity,motorSpeed);
+    angularVelocityDer = getAngularVelocityDerivative(motorSpeed,motorAcceleration,angularVelocity,Eigen::Vector3d::Zero());
+}
+
 /**
  * @brief Proceed vehicle dynamics using Explicit Euler integration
  * 
@@ -441,6 +515,9 @@ void MulticopterDynamicsSim::getIMUMeasurement(Eigen::Vector3d & accOutput, Eige
  * @param motorSpeedCommand Motor speed commands 
  */
 void MulticopterDynamicsSim::proceedState_ExplicitEuler(double dt_secs, const std::vector<double> & motorSpeedCommandIn, bool isCmdPercent){
+    if(faults_.update(dt_secs)){
+        applyFaults(faults_.getEffects());
+    }
     std::vector<double> motorSpeedCommand = motorSpeedCommandIn;
     if(isCmdPercent)
     {
@@ -469,7 +546,6 @@ void MulticopterDynamicsSim::proceedState_ExplicitEuler(double dt_secs, const st
     getMotorSpeedDerivative(motorSpeedDer,motorSpeed,motorSpeedCommandBounded);
     Eigen::Vector3d positionDer = velocity;
     Eigen::Vector3d velocityDer = getVelocityDerivative(attitude,stochForce_,velocity,motorSpeed);
-    Eigen::Vector4d attitudeDer = getAttitudeDerivative(attitude,angularVelocity);
     Eigen::Vector3d angularVelocityDer = getAngularVelocityDerivative(motorSpeed,motorSpeedDer,angularVelocity,stochMoment);
 
     vectorAffineOp(motorSpeed,motorSpeedDer,motorSpeed_,dt_secs);
@@ -477,9 +553,7 @@ void MulticopterDynamicsSim::proceedState_ExplicitEuler(double dt_secs, const st
     position_ = position + positionDer*dt_secs;
     velocity_ = velocity + velocityDer*dt_secs;
     angularVelocity_ = angularVelocity + angularVelocityDer*dt_secs;
-    attitude_.coeffs() = attitude.coeffs() + attitudeDer*dt_secs;
-
-    attitude_.normalize();
+    attitude_ = Math::integrateAttitude(attitude, angularVelocity, dt_secs);
 
     if( position_.z() < 0){
         position_[2] = 0.00;
@@ -502,6 +576,9 @@ void MulticopterDynamicsSim::proceedState_ExplicitEuler(double dt_secs, const st
  * @param motorSpeedCommand Motor speed commands 
  */
 void MulticopterDynamicsSim::proceedState_RK4(double dt_secs, const std::vector<double> & motorSpeedCommandIn, bool isCmdPercent){
+    if(faults_.update(dt_secs)){
+        applyFaults(faults_.getEffects());
+    }
     std::vector<double> motorSpeedCommand = motorSpeedCommandIn;
 
     if(isCmdPercent)
@@ -640,7 +717,7 @@ void MulticopterDynamicsSim::vectorAffineOp(const std::vector<double> & vec1, co
  * @param maxvec Vector of upper bounds
  */
 void MulticopterDynamicsSim::vectorBoundOp(const std::vector<double> & vec1, std::vector<double> & vec2,
-                                         const std::vector<double> &  minvec, const std::vector<double> & maxvec){
+                                         const std::vector<double> &  minvec, const std::vector<double> & maxvec) const{
     std::transform(vec1.begin(), vec1.end(), maxvec.begin(), vec2.begin(), [](const double & vec1val, const double & maxvalue)->double{return fmin(vec1val,maxvalue);});
     std::transform(vec2.begin(), vec2.end(), minvec.begin(), vec2.begin(), [](const double & vec2val, const double & minvalue)->double{return fmax(vec2val,minvalue);});
 }
@@ -681,7 +758,7 @@ void MulticopterDynamicsSim::getMotorSpeedDerivative(std::vector<double> & motor
  * @return Eigen::Vector3d Acceleration vector
  */
 Eigen::Vector3d MulticopterDynamicsSim::getVelocityDerivative(const Eigen::Quaterniond & attitude, const Eigen::Vector3d & stochForce,
-                                        const Eigen::Vector3d & velocity, const std::vector<double> & motorSpeed){
+                                        const Eigen::Vector3d & velocity, const std::vector<double> & motorSpeed) const{
     return (gravity_ + (attitude*getThrust(motorSpeed) + getDragForce(velocity) + stochForce)/vehicleMass_);
 }
 
@@ -710,7 +787,7 @@ Eigen::Vector4d MulticopterDynamicsSim::getAttitudeDerivative(const Eigen::Quate
  * @return Eigen::Vector3d Angular acceleration
  */
 Eigen::Vector3d MulticopterDynamicsSim::getAngularVelocityDerivative(const std::vector<double> & motorSpeed,
-    const std::vector<double>& motorAcceleration, const Eigen::Vector3d & angularVelocity, const Eigen::Vector3d & stochMoment){
+    const std::vector<double>& motorAcceleration, const Eigen::Vector3d & angularVelocity, const Eigen::Vector3d & stochMoment) const{
 
     Eigen::Vector3d angularMomentum = vehicleInertia_*angularVelocity;
 
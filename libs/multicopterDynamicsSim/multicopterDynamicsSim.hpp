@@ -12,6 +12,7 @@
 #include <Eigen/Geometry>
 #include <vector>
 #include "inertialMeasurementSim.hpp"
+#include "faults.hpp"
 
 /**
  * @brief Multicopter dynamics simulator class
@@ -64,9 +65,24 @@ class MulticopterDynamicsSim{
         
         void proceedState_ExplicitEuler(double dt_secs, const std::vector<double> & motorSpeedCommand, bool isCmdPercent = false);
         void proceedState_RK4(double dt_secs, const std::vector<double> & motorSpeedCommand, bool isCmdPercent = false);
+        void getSteadyStateDerivative(const Eigen::Quaterniond & attitude,
+                                      const Eigen::Vector3d & velocity,
+                                      const Eigen::Vector3d & angularVelocity,
+                                      const std::vector<double> & motorSpeedCommand,
+                                      bool isCmdPercent,
+                                      Eigen::Vector3d & velocityDer,
+                                      Eigen::Vector3d & angularVelocityDer) const;
 
         void getIMUMeasurement(Eigen::Vector3d & accOutput, Eigen::Vector3d & gyroOutput);
 
+        /**
+         * @brief Replace the fault schedule, the motors indexes are the ones of this class.
+         * The faults change the motors and the vehicle properties when they start or end,
+         * so the step only checks the schedule time. Servo faults are ignored.
+         * @note The CG offset of Fault is FRD, it is converted to the vehicle frame here
+         */
+        void setFaults(const std::vector<Fault> & faults);
+
         /// @name IMU simulator
         inertialMeasurementSim imu_ = inertialMeasurementSim(0.,0.,0.,0.);
 
@@ -133,11 +149,24 @@ class MulticopterDynamicsSim{
         /// @name Vehicle stochastic force vector
         Eigen::Vector3d stochForce_ = Eigen::Vector3d::Zero(); // N
 
-        Eigen::Vector3d getThrust(const std::vector<double> & motorSpeed);
+        /// @name Fault injection
+        //@{
+        FaultInjector faults_;
+        bool isFaultNominalSaved_ = false;
+        std::vector<double> nominalThrustCoefficient_;
+        std::vector<double> nominalTorqueCoefficient_;
+        std::vector<double> nominalMaxMotorSpeed_;
+        std::vector<double> nominalMinMotorSpeed_;
+        std::vector<Eigen::Vector3d> nominalMotorPosition_;
+        double nominalVehicleMass_ = 0.;
+        void applyFaults(const FaultEffects & effects);
+        //@}
+
+        Eigen::Vector3d getThrust(const std::vector<double> & motorSpeed) const;
         Eigen::Vector3d getControlMoment(const std::vector<double> & motorSpeed,
-                                         const std::vector<double> & motorAcceleration);
-        Eigen::Vector3d getAeroMoment(const Eigen::Vector3d & angularVelocity);
-        Eigen::Vector3d getDragForce(const Eigen::Vector3d & velocity);
+                                         const std::vector<double> & motorAcceleration) const;
+        Eigen::Vector3d getAeroMoment(const Eigen::Vector3d & angularVelocity) const;
+        Eigen::Vector3d getDragForce(const Eigen::Vector3d & velocity) const;
         Eigen::Vector3d getVehicleSpecificForce(void);
         Eigen::Vector3d getTotalForce(void);
 
@@ -145,17 +174,17 @@ class MulticopterDynamicsSim{
                                      const std::vector<double> & motorSpeed,
                                      const std::vector<double> & motorSpeedCommand);
         Eigen::Vector3d getVelocityDerivative(const Eigen::Quaterniond & attitude, const Eigen::Vector3d & stochForce,
-                                              const Eigen::Vector3d & velocity, const std::vector<double> & motorSpeed);
+                                              const Eigen::Vector3d & velocity, const std::vector<double> & motorSpeed) const;
         Eigen::Vector3d getAngularVelocityDerivative(const std::vector<double> & motorSpeed,
                                                      const std::vector<double>& motorAcceleration,
                                                      const Eigen::Vector3d & angularVelocity,
-                                                     const Eigen::Vector3d & stochMoment);
+                                                     const Eigen::Vector3d & stochMoment) const;
         Eigen::Vector4d getAttitudeDerivative(const Eigen::Quaterniond & attitude, const Eigen::Vector3d & angularVelocity);
         void vectorAffineOp(const std::vector<double> & vec1, const std::vector<double> & vec2, 
                             std::vector<double> & vec3, double val);
         void vectorScalarProd(const std::vector<double> & vec1, std::vector<double> & vec2, double val);
         void vectorBoundOp(const std::vector<double> & vec1, std::vector<double> & vec2,
-                           const std::vector<double> &  minvec, const std::vector<double> & maxvec);
+                           const std::vector<double> &  minvec, const std::vector<double> & maxvec) const;
 };
 
 #endif // MULTICOPTERDYNAMICSSIM_H
\ No newline at end of file
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+Convert a yaml file with the vehicle parameters or the aerodynamic tables into a C++ header with
+constexpr arrays, so a vehicle model can be compiled with them instead of reading the parameter server.
+Numbers and booleans are supported, scalars are stored as arrays of size 1.
+
+Usage: generate_baked_params.py --name vtol_7kg --output vtol_7kg.hpp config/vehicle_params/vtol_7kg/params.yaml
+"""
+import argparse
+import os
+import re
+import sys
+
+import yaml
+
+
+def to_identifier(name):
+    identifier = re.sub(r'\W', '_', name)
+    return identifier if not identifier[0].isdigit() else '_' + identifier
+
+
+def to_values(name, value):
+    values = value if isinstance(value, list) else [value]
+    if not values or not all(isinstance(item, (bool, int, float)) for item in values):
+        raise ValueError(f'{name}: only numbers, booleans and their lists are supported')
+    return [float(item) for item in values]
+
+
+def generate_header(namespace, source, params):
+    guard = f'BAKED_PARAMS_{namespace.upper()}_HPP'
+    lines = [
+        f'// Generated by scripts/generate_baked_params.py from {source}, do not edit',
+        f'#ifndef {guard}',
+        f'#define {guard}',
+        '',
+        '#include "bakedParams.hpp"',
+        '',
+        f'namespace BakedParams::{namespace} {{',
+    ]
+    entries = []
+    for name, value in params.items():
+        values = to_values(name, value)
+        identifier = to_identifier(name)
+        body = ', '.join(repr(item) for item in values)
+        lines.append(f'inline constexpr double {identifier}[{len(values)}] = {{{body}}};')
+        entries.append(f'    {{"{name}", {identifier}, {len(values)}}},')
+    lines.append('')
+    lines.append(f'inline constexpr BakedParam PARAMS[{len(entries)}] = {{')
+    lines.extend(entries)
+    lines.append('};')
+    lines.append(f'}}  // namespace BakedParams::{namespace}')
+    lines.append('')
+    lines.append(f'#endif  // {guard}')
+    return '\n'.join(lines) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--name', required=True, help='namespace inside BakedParams, e.g. the vehicle name')
+    parser.add_argument('--output', required=True, help='path of the generated header')
+    parser.add_argument('input', help='yaml file with the parameters')
+    args = parser.parse_args()
+
+    with open(args.input, 'r') as stream:
+        params = yaml.safe_load(stream)
+    if not isinstance(params, dict) or not params:
+        sys.exit(f'{args.input}: a non empty dictionary is expected')
+
+    source = os.path.join(*os.path.normpath(args.input).split(os.sep)[-2:])
+    header = generate_header(to_identifier(args.name), source, params)
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, 'w') as stream:
+        stream.write(header)
+
+
+if __name__ == '__main__':
+    main()
@@ -54,10 +54,6 @@ void Actuators::_actuatorsCallback(sensor_msgs::Joy::Ptr msg){
     for(size_t idx = 0; idx < actuatorsSize; idx++){
         actuators[idx] = msg->axes[idx];
     }
-
-    if (_scenarioType == 1) {
-        actuators[7] = 0.0;
-    }
 }
 
 void Actuators::_armCallback(std_msgs::Bool msg){
@@ -38,7 +38,6 @@ struct Actuators {
 
     std::vector<double> actuators;
     uint8_t actuatorsSize{0};
-    uint8_t _scenarioType{0};
 
 private:
     void _actuatorsCallback(sensor_msgs::Joy::Ptr msg);
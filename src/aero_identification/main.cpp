@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#include <ros/ros.h>
+#include <sstream>
+#include "vtolAeroIdentification.hpp"
+
+
+int main(int argc, char **argv){
+    ros::init(argc, argv, "aero_identification_node");
+    ros::NodeHandle node_handler("~");
+
+    std::string logs;
+    std::string output;
+    if(!node_handler.getParam("logs", logs) || !node_handler.getParam("output", output)){
+        ROS_ERROR("AeroIdentification: There are no `logs` or `output` parameters.");
+        return -1;
+    }
+    int threads = 0;
+    node_handler.getParam("threads", threads);
+    AeroIdentificationOptions options;
+    node_handler.getParam("regularization", options.regularization);
+
+    VtolDynamics dynamics;
+    if(dynamics.init() == -1){
+        ROS_ERROR("AeroIdentification: VTOL dynamics initialization failed.");
+        return -1;
+    }
+
+    std::vector<AeroFlightSample> samples;
+    std::stringstream logsStream(logs);
+    std::string log;
+    while(logsStream >> log){
+        if(loadAeroFlightLog(log, samples) == -1){
+            ROS_ERROR_STREAM("AeroIdentification: Can't read the log " << log);
+            return -1;
+        }
+        ROS_INFO_STREAM("AeroIdentification: " << log << " is loaded, " << samples.size() << " samples in total.");
+    }
+
+    VtolAeroIdentification identification(dynamics, options);
+    auto result = identification.fit(samples, static_cast<size_t>(std::max(threads, 0)));
+    ROS_INFO_STREAM("AeroIdentification: " << result.parametersAmount << " table entries are corrected.");
+    ROS_INFO_STREAM("AeroIdentification: force RMS " << result.forceRmsBefore << " -> "
+                                                     << result.forceRmsAfter << " N.");
+    ROS_INFO_STREAM("AeroIdentification: moment RMS " << result.momentRmsBefore.transpose() << " -> "
+                                                      << result.momentRmsAfter.transpose() << " N*m.");
+
+    if(writeAeroTablesYaml(output, result.tables) == -1){
+        ROS_ERROR_STREAM("AeroIdentification: Can't write " << output);
+        return -1;
+    }
+    ROS_INFO_STREAM("AeroIdentification: the tables are written to " << output);
+    return 0;
+}
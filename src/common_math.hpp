@@ -20,6 +20,9 @@
 #ifndef COMMON_MATH_HPP
 #define COMMON_MATH_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
 #include <Eigen/Geometry>
 
 namespace Math
@@ -29,42 +32,220 @@ namespace Math
     */
     double lerp(double a, double b, double f);
 
-    double polyval(const Eigen::VectorXd& poly, double val);
+    /**
+     * @brief lerp() with the fraction of any scalar type, e.g. Eigen::AutoDiffScalar
+     */
+    template<typename Scalar>
+    Scalar lerp(double a, double b, const Scalar& f){
+        return a + f * (b - a);
+    }
+
+    /**
+     * @brief Plain value of a scalar, it is used to find the table segments and to compare.
+     * Non arithmetic scalars should provide value(), as Eigen::AutoDiffScalar does.
+     */
+    template<typename Scalar>
+    double getValue(const Scalar& scalar){
+        if constexpr (std::is_arithmetic_v<Scalar>){
+            return static_cast<double>(scalar);
+        }else{
+            return getValue(scalar.value());
+        }
+    }
+
+    /**
+     * @brief Exponential map attitude update, exact for a constant angular velocity over the step:
+     * q+ = q * (cos(|w| dt / 2), sin(|w| dt / 2) * w / |w|)
+     * @param[in] angularVel - body frame, rad/sec
+     * @note The unit norm is kept without normalization
+     */
+    Eigen::Quaterniond integrateAttitude(const Eigen::Quaterniond& attitude,
+                                         const Eigen::Vector3d& angularVel,
+                                         double dtSecs);
+
+    /**
+     * @note The functions below are templates over Eigen expressions, so fixed-size tables,
+     * blocks and lazy expressions (e.g. -table) are read in place without a temporary copy.
+     * The arguments and the results are generic over the scalar type, so the tables can be
+     * differentiated by a forward-mode AD type.
+     */
+    template<typename Derived, typename Scalar>
+    Scalar polyval(const Eigen::MatrixBase<Derived>& poly, const Scalar& val){
+        using std::pow;
+        Scalar result(0);
+        for(uint8_t idx = 0; idx < poly.rows(); idx++){
+            result += poly[idx] * pow(val, static_cast<double>(poly.rows() - 1 - idx));
+        }
+        return result;
+    }
 
     /**
      * @brief Given monotonic sequence (increasing or decreasing) and key,
      return the index of the previous element closest to the key
      * @note size should be greater or equel than 2!
      */
-    size_t findPrevRowIdxInMonotonicSequence(const Eigen::MatrixXd& matrix, double key);
+    template<typename Derived, typename Key>
+    size_t findPrevRowIdxInMonotonicSequence(const Eigen::MatrixBase<Derived>& matrix, const Key& keyScalar){
+        const double key = getValue(keyScalar);
+        size_t row_idx;
+        const size_t num_of_rows = matrix.rows();
+        bool is_increasing_sequence = matrix(num_of_rows - 1, 0) > matrix(0, 0);
+        if(is_increasing_sequence){
+            for(row_idx = 1; row_idx < num_of_rows - 1; row_idx++){
+                if(key <= matrix(row_idx, 0)){
+                    break;
+                }
+            }
+            row_idx--;
+        }else{
+            for(row_idx = 1; row_idx < num_of_rows - 1; row_idx++){
+                if(key >= matrix(row_idx, 0)){
+                    break;
+                }
+            }
+            row_idx--;
+        }
+        return row_idx;
+    }
 
     /**
      * @brief Given an increasing sequence and a key,
      return the index of the previous element closest to the key
      * @note size should be greater or equel than 2!
      */
-    size_t findPrevRowIdxInIncreasingSequence(const Eigen::MatrixXd& table, double value);
+    template<typename Derived, typename Key>
+    size_t findPrevRowIdxInIncreasingSequence(const Eigen::MatrixBase<Derived>& table, const Key& key){
+        const double value = getValue(key);
+        size_t row_idx = 0;
+        size_t num_of_rows = table.rows();
+        while(row_idx + 2 < num_of_rows && table(row_idx + 1, 0) < value){
+            row_idx++;
+        }
+        return row_idx;
+    }
+
+    /**
+     * @brief Same segment as findPrevRowIdxInIncreasingSequence(), but the search starts from the segment
+     * of the previous call. A slowly changing key stays in the same segment, so it is two comparisons,
+     * otherwise the step is doubled until the key is bracketed and the bracket is bisected,
+     * so the worst case is O(log n).
+     * @param[in] point - point(idx) returns the point of the increasing sequence
+     * @param[in] size - amount of the points, should be greater or equal than 2
+     * @param[in, out] cursor - the segment of the previous call, any value is valid
+     */
+    template<typename Point>
+    size_t huntSegmentIdx(const Point& point, size_t size, double key, size_t& cursor){
+        const size_t lastSegmentIdx = size - 2;
+        auto isBelowKey = [&](size_t idx){
+            return idx == 0 || (idx <= lastSegmentIdx && point(idx) < key);
+        };
+
+        size_t low = std::min(cursor, lastSegmentIdx);
+        size_t high = low + 1;
+        size_t step = 1;
+        if(isBelowKey(low)){
+            while(isBelowKey(high)){
+                low = high;
+                step *= 2;
+                high = std::min(low + step, lastSegmentIdx + 1);
+            }
+        }else{
+            high = low;
+            low = high - 1;
+            while(!isBelowKey(low)){
+                high = low;
+                step *= 2;
+                low = high > step ? high - step : 0;
+            }
+        }
+
+        while(high - low > 1){
+            const size_t middle = low + (high - low) / 2;
+            if(isBelowKey(middle)){
+                low = middle;
+            }else{
+                high = middle;
+            }
+        }
+        cursor = low;
+        return low;
+    }
+
+    /**
+     * @brief findPrevRowIdxInMonotonicSequence() by huntSegmentIdx()
+     */
+    template<typename Derived, typename Key>
+    size_t huntPrevRowIdxInMonotonicSequence(const Eigen::MatrixBase<Derived>& matrix,
+                                             const Key& keyScalar,
+                                             size_t& cursor){
+        const size_t num_of_rows = matrix.rows();
+        const double sign = matrix(num_of_rows - 1, 0) > matrix(0, 0) ? 1.0 : -1.0;
+        auto point = [&matrix, sign](size_t idx){ return sign * matrix(idx, 0); };
+        return huntSegmentIdx(point, num_of_rows, sign * getValue(keyScalar), cursor);
+    }
 
     /**
      * @note Similar to https://www.mathworks.com/help/matlab/ref/griddata.html
      * Implementation from https://en.wikipedia.org/wiki/Bilinear_interpolation
      */
-    double griddata(const Eigen::MatrixXd& x,
-                    const Eigen::MatrixXd& y,
-                    const Eigen::MatrixXd& z,
-                    double x_val,
-                    double y_val);
+    template<typename DerivedX, typename DerivedY, typename DerivedZ, typename Scalar>
+    Scalar griddata(const Eigen::MatrixBase<DerivedX>& x,
+                    const Eigen::MatrixBase<DerivedY>& y,
+                    const Eigen::MatrixBase<DerivedZ>& z,
+                    const Scalar& x_val,
+                    const Scalar& y_val){
+        size_t x1_idx = findPrevRowIdxInMonotonicSequence(x, x_val);
+        size_t y1_idx = findPrevRowIdxInMonotonicSequence(y, y_val);
+        size_t x2_idx = x1_idx + 1;
+        size_t y2_idx = y1_idx + 1;
+        double Q11 = z(y1_idx, x1_idx);
+        double Q12 = z(y2_idx, x1_idx);
+        double Q21 = z(y1_idx, x2_idx);
+        double Q22 = z(y2_idx, x2_idx);
+        Scalar R1 = ((x(x2_idx) - x_val) * Q11 + (x_val - x(x1_idx)) * Q21) / (x(x2_idx) - x(x1_idx));
+        Scalar R2 = ((x(x2_idx) - x_val) * Q12 + (x_val - x(x1_idx)) * Q22) / (x(x2_idx) - x(x1_idx));
+        Scalar f =  ((y(y2_idx) - y_val) * R1  + (y_val - y(y1_idx)) * R2)  / (y(y2_idx) - y(y1_idx));
+        return f;
+    }
 
     /**
      * @param[in] table must have size (1 + NUM_OF_COEFFS, NUM_OF_POINTS), min size is (2, 2)
      * @param[in] airSpeedMod should be between table(0, 0) and table(NUM_OF_COEFFS, 0)
      * @param[in, out] polynomialCoeffs must have size should be at least NUM_OF_COEFFS
+     * @param[in, out] cursor - optional segment of the previous call, see huntSegmentIdx()
      * @return true and modify polynomialCoeffs if input is ok, otherwise return false
      */
-    bool calculatePolynomial(const Eigen::MatrixXd& table,
-                             double airSpeedMod,
-                             Eigen::VectorXd& polynomialCoeffs);
+    template<typename DerivedTable, typename DerivedCoeffs, typename Scalar>
+    bool calculatePolynomial(const Eigen::MatrixBase<DerivedTable>& table,
+                             const Scalar& airSpeedMod,
+                             Eigen::MatrixBase<DerivedCoeffs>& polynomialCoeffs,
+                             size_t* cursor = nullptr){
+        if(table.cols() < 2 || table.rows() < 2 || polynomialCoeffs.rows() < table.cols() - 1){
+            return false;  // wrong input
+        }
+
+        const size_t prevRowIdx = cursor != nullptr ? huntPrevRowIdxInMonotonicSequence(table, airSpeedMod, *cursor) :
+                                                      findPrevRowIdxInMonotonicSequence(table, airSpeedMod);
+        if(prevRowIdx + 2 > static_cast<size_t>(table.rows())){
+            return false;  // wrong found row
+        }
+
+        const size_t nextRowIdx = prevRowIdx + 1;
+        const double airspeedStep = table(nextRowIdx, 0) - table(prevRowIdx, 0);
+        if (std::abs(airspeedStep) < 0.001) {
+            return false;  // wrong table, prevent division on zero
+        }
+
+        Scalar delta = (airSpeedMod - table(prevRowIdx, 0)) / airspeedStep;
+        const size_t numberOfCoeffs = table.cols() - 1;
+        for(size_t coeff_idx = 0; coeff_idx < numberOfCoeffs; coeff_idx++){
+            const double prevValue = table(prevRowIdx, coeff_idx + 1);
+            const double nextValue = table(nextRowIdx, coeff_idx + 1);
+            polynomialCoeffs[coeff_idx] = lerp(prevValue, nextValue, delta);
+        }
 
+        return true;
+    }
 
 }  // namespace Math
 
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#ifndef UAV_DYNAMICS_BAKED_PARAMS_HPP
+#define UAV_DYNAMICS_BAKED_PARAMS_HPP
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A parameter compiled into the binary by scripts/generate_baked_params.py.
+ * Numbers and booleans are stored as double, scalars as arrays of size 1.
+ */
+struct BakedParam{
+    const char* name;
+    const double* values;
+    size_t size;
+};
+
+/**
+ * @brief Same interface as ros::param::get() for the generated PARAMS arrays
+ * @return false if the parameter is absent or a scalar is requested from an array
+ */
+template<typename T>
+bool getBakedParam(const BakedParam* params, size_t amount, const std::string& name, T& value){
+    for(size_t param_idx = 0; param_idx < amount; param_idx++){
+        const auto& param = params[param_idx];
+        if(name != param.name){
+            continue;
+        }
+        if constexpr (std::is_arithmetic_v<T>){
+            if(param.size != 1){
+                return false;
+            }
+            value = static_cast<T>(param.values[0]);
+        }else{
+            using Item = typename T::value_type;
+            value.resize(param.size);
+            for(size_t idx = 0; idx < param.size; idx++){
+                value[idx] = static_cast<Item>(param.values[idx]);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+template<size_t Amount, typename T>
+bool getBakedParam(const BakedParam (&params)[Amount], const std::string& name, T& value){
+    return getBakedParam(params, Amount, name, value);
+}
+
+#endif  // UAV_DYNAMICS_BAKED_PARAMS_HPP
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#ifndef UAV_DYNAMICS_DIAGNOSTICS_HPP
+#define UAV_DYNAMICS_DIAGNOSTICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+enum class DiagnosticEvent : uint8_t {
+    AIRSPEED_LIMIT = 0,             // FRD airspeed component is clamped, value is the largest one, m/sec
+    AOA_SATURATION,                 // value is the unclamped AoA, deg
+    AOS_SATURATION,                 // value is the unclamped AoS, deg
+    AERO_TABLE_EXTRAPOLATION,       // airspeed is above the aerodynamic tables, value is it, m/sec
+    PROP_TABLE_EXTRAPOLATION,       // inflow is outside of the 2-D prop table, value is it, m/sec
+    CALIBRATION,                    // calibration step, value is the SimMode_t
+
+    AMOUNT,
+};
+
+/**
+ * @brief Event counters of the physics code. The step path only records events with relaxed
+ * atomics, so it doesn't lock and doesn't do I/O, and a background thread reports them.
+ * @note Counters are monotonic, a reporter keeps its own previous values to get the rate
+ */
+class DynamicsDiagnostics{
+public:
+    static constexpr size_t EVENTS_AMOUNT = static_cast<size_t>(DiagnosticEvent::AMOUNT);
+
+    DynamicsDiagnostics() = default;
+    DynamicsDiagnostics(const DynamicsDiagnostics& other) noexcept {
+        for(size_t idx = 0; idx < EVENTS_AMOUNT; idx++){
+            _counters[idx].store(other._counters[idx].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            _lastValues[idx].store(other._lastValues[idx].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+    DynamicsDiagnostics& operator=(const DynamicsDiagnostics& other) noexcept {
+        for(size_t idx = 0; idx < EVENTS_AMOUNT; idx++){
+            _counters[idx].store(other._counters[idx].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            _lastValues[idx].store(other._lastValues[idx].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    void record(DiagnosticEvent event, double value) const noexcept {
+        auto idx = static_cast<size_t>(event);
+        _counters[idx].fetch_add(1, std::memory_order_relaxed);
+        _lastValues[idx].store(value, std::memory_order_relaxed);
+    }
+
+    uint64_t getCounter(DiagnosticEvent event) const noexcept {
+        return _counters[static_cast<size_t>(event)].load(std::memory_order_relaxed);
+    }
+
+    double getLastValue(DiagnosticEvent event) const noexcept {
+        return _lastValues[static_cast<size_t>(event)].load(std::memory_order_relaxed);
+    }
+
+    static const char* getName(DiagnosticEvent event) noexcept {
+        static constexpr std::array<const char*, EVENTS_AMOUNT> NAMES{
+            "airspeed_limit", "aoa_saturation", "aos_saturation",
+            "aero_table_extrapolation", "prop_table_extrapolation", "calibration"
+        };
+        return NAMES[static_cast<size_t>(event)];
+    }
+
+private:
+    mutable std::array<std::atomic<uint64_t>, EVENTS_AMOUNT> _counters{};
+    mutable std::array<std::atomic<double>, EVENTS_AMOUNT> _lastValues{};
+};
+
+#endif  // UAV_DYNAMICS_DIAGNOSTICS_HPP
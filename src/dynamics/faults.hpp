@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#ifndef UAV_DYNAMICS_FAULTS_HPP
+#define UAV_DYNAMICS_FAULTS_HPP
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+enum class FaultType : uint8_t {
+    MOTOR_THRUST = 0,               // the motor speed is limited to value of the max one, 0 is the motor loss
+    PROP_DAMAGE,                    // the prop thrust and torque are multiplied by value at the same speed
+    SERVO_STUCK,                    // the servo holds its position at the fault start
+    SERVO_FLOATING,                 // the surface trails the flow: it ignores the commands and goes to zero
+    MASS_SHIFT,                     // value is the added mass, kg, cgOffset is the CG shift, FRD meters.
+                                    // The removed mass is limited to MAX_REMOVED_MASS_RATIO of the nominal one
+
+    AMOUNT,
+};
+
+struct Fault{
+    FaultType type{FaultType::MOTOR_THRUST};
+    double startSecs{0.0};          // sim time since the schedule is set
+    double endSecs{std::numeric_limits<double>::infinity()};
+    size_t index{0};                // motor index in the setpoint, servo: 0 ailerons, 1 elevators, 2 rudders
+    double value{0.0};
+    Eigen::Vector3d cgOffset{Eigen::Vector3d::Zero()};
+};
+
+enum class ServoFault : uint8_t {
+    NONE = 0,
+    STUCK,
+    FLOATING,
+};
+
+/**
+ * @brief Combined effect of the active faults
+ */
+struct FaultEffects{
+    static constexpr size_t MOTORS_MAX_AMOUNT = 16;
+    static constexpr size_t SERVOS_MAX_AMOUNT = 3;
+
+    std::array<double, MOTORS_MAX_AMOUNT> motorSpeedFactor;
+    std::array<double, MOTORS_MAX_AMOUNT> propFactor;
+    std::array<ServoFault, SERVOS_MAX_AMOUNT> servos;
+    double addedMass{0.0};                          // kg
+    Eigen::Vector3d cgOffset{Eigen::Vector3d::Zero()};  // FRD, meters
+
+    FaultEffects(){
+        motorSpeedFactor.fill(1.0);
+        propFactor.fill(1.0);
+        servos.fill(ServoFault::NONE);
+    }
+};
+
+/**
+ * @brief Sim time schedule of the faults.
+ * A model calls update() once per step: while the set of the active faults doesn't change it is one
+ * comparison with the next event time, and only on a change the model applies getEffects().
+ * Injection points in the force loops check isActive() first, so without faults they cost one
+ * predictable branch. With UAV_DYNAMICS_NO_FAULTS defined both return a constant false and the
+ * injection points are compiled away.
+ */
+class FaultInjector{
+public:
+    static constexpr double MAX_REMOVED_MASS_RATIO = 0.9;
+    static constexpr size_t SCHEDULE_ROW_SIZE = 8;
+
+    /**
+     * @brief Read a schedule from a flat parameter or message array with SCHEDULE_ROW_SIZE values
+     * per fault: type, start, end, index, value and the CG offset x, y, z. A negative end means
+     * the fault doesn't end.
+     * @return false if the size isn't a multiple of the row or a value is wrong, faults are kept then
+     */
+    static bool parseSchedule(const std::vector<double>& rows, std::vector<Fault>& faults){
+        if(rows.size() % SCHEDULE_ROW_SIZE != 0){
+            return false;
+        }
+        std::vector<Fault> parsed(rows.size() / SCHEDULE_ROW_SIZE);
+        for(size_t idx = 0; idx < parsed.size(); idx++){
+            const double* row = rows.data() + idx * SCHEDULE_ROW_SIZE;
+            auto isFinite = [](double value){ return std::isfinite(value); };
+            const bool isValid = std::all_of(row, row + 2, isFinite) && !std::isnan(row[2]) &&
+                                 std::all_of(row + 3, row + SCHEDULE_ROW_SIZE, isFinite);
+            if(!isValid || row[0] < 0.0 || row[0] >= static_cast<double>(FaultType::AMOUNT) || row[3] < 0.0){
+                return false;
+            }
+            auto& fault = parsed[idx];
+            fault.type = static_cast<FaultType>(static_cast<uint8_t>(row[0]));
+            fault.startSecs = row[1];
+            fault.endSecs = row[2] < 0.0 ? std::numeric_limits<double>::infinity() : row[2];
+            fault.index = static_cast<size_t>(row[3]);
+            fault.value = row[4];
+            fault.cgOffset = Eigen::Vector3d(row[5], row[6], row[7]);
+        }
+        faults = std::move(parsed);
+        return true;
+    }
+
+    void setSchedule(const std::vector<Fault>& faults){
+        _faults = faults;
+        _timeSecs = 0.0;
+        _effects = FaultEffects();
+        _scheduledAddedMass = 0.0;
+        _isActive = false;
+        _nextEventSecs = _faults.empty() ? std::numeric_limits<double>::infinity() : 0.0;
+    }
+
+    /**
+     * @return true if the active faults have changed, then the model should apply getEffects()
+     */
+    bool update(double dtSecs){
+#ifdef UAV_DYNAMICS_NO_FAULTS
+        return false;
+#else
+        _timeSecs += dtSecs;
+        if(_timeSecs < _nextEventSecs){
+            return false;
+        }
+        updateEffects();
+        return true;
+#endif
+    }
+
+    bool isActive() const{
+#ifdef UAV_DYNAMICS_NO_FAULTS
+        return false;
+#else
+        return _isActive;
+#endif
+    }
+
+    /**
+     * @brief The models call it when they save the nominal parameters. Until then the mass shift
+     * faults can only add mass.
+     */
+    void setNominalMass(double mass){
+        _minAddedMass = -MAX_REMOVED_MASS_RATIO * std::max(mass, 0.0);
+        _effects.addedMass = std::max(_scheduledAddedMass, _minAddedMass);
+    }
+
+    const FaultEffects& getEffects() const{ return _effects; }
+    const std::vector<Fault>& getSchedule() const{ return _faults; }
+    double getTime() const{ return _timeSecs; }
+
+private:
+    void updateEffects(){
+        _effects = FaultEffects();
+        _scheduledAddedMass = 0.0;
+        _isActive = false;
+        _nextEventSecs = std::numeric_limits<double>::infinity();
+        for(const auto& fault : _faults){
+            if(_timeSecs < fault.startSecs){
+                _nextEventSecs = std::min(_nextEventSecs, fault.startSecs);
+                continue;
+            }
+            if(_timeSecs >= fault.endSecs){
+                continue;
+            }
+            _nextEventSecs = std::min(_nextEventSecs, fault.endSecs);
+            _isActive = true;
+
+            switch(fault.type){
+                case FaultType::MOTOR_THRUST:
+                    if(fault.index < FaultEffects::MOTORS_MAX_AMOUNT){
+                        _effects.motorSpeedFactor[fault.index] *= std::clamp(fault.value, 0.0, 1.0);
+                    }
+                    break;
+                case FaultType::PROP_DAMAGE:
+                    if(fault.index < FaultEffects::MOTORS_MAX_AMOUNT){
+                        _effects.propFactor[fault.index] *= std::max(fault.value, 0.0);
+                    }
+                    break;
+                case FaultType::SERVO_STUCK:
+                    if(fault.index < FaultEffects::SERVOS_MAX_AMOUNT){
+                        _effects.servos[fault.index] = ServoFault::STUCK;
+                    }
+                    break;
+                case FaultType::SERVO_FLOATING:
+                    if(fault.index < FaultEffects::SERVOS_MAX_AMOUNT){
+                        _effects.servos[fault.index] = ServoFault::FLOATING;
+                    }
+                    break;
+                case FaultType::MASS_SHIFT:
+                    _scheduledAddedMass += fault.value;
+                    _effects.cgOffset += fault.cgOffset;
+                    break;
+                default:
+                    break;
+            }
+        }
+        _effects.addedMass = std::max(_scheduledAddedMass, _minAddedMass);
+    }
+
+    std::vector<Fault> _faults;
+    FaultEffects _effects;
+    double _scheduledAddedMass{0.0};
+    double _minAddedMass{0.0};
+    double _timeSecs{0.0};
+    double _nextEventSecs{std::numeric_limits<double>::infinity()};
+    bool _isActive{false};
+};
+
+#endif  // UAV_DYNAMICS_FAULTS_HPP
@@ -18,6 +18,7 @@
 
 
 #include "octocopter.hpp"
+#include <algorithm>
 #include <iostream>
 #include <ros/ros.h>
 #include <geometry_msgs/TransformStamped.h>
@@ -122,6 +123,23 @@ void MultirotorDynamics::process(double dt_secs, const std::vector<double>& setp
     multicopterSim_->proceedState_ExplicitEuler(dt_secs, actuators, true);
 }
 
+void MultirotorDynamics::setFaults(const std::vector<Fault>& faults){
+    std::vector<Fault> mappedFaults = faults;
+    for(auto& fault : mappedFaults){
+        if(fault.type != FaultType::MOTOR_THRUST && fault.type != FaultType::PROP_DAMAGE){
+            continue;
+        }
+        std::vector<double> setpoint(number_of_motors, 0.0);
+        if(fault.index < setpoint.size()){
+            setpoint[fault.index] = 1.0;
+        }
+        auto actuators = mapCmdActuator(setpoint);
+        auto motor = std::find(actuators.begin(), actuators.end(), 1.0);
+        fault.index = static_cast<size_t>(std::distance(actuators.begin(), motor));
+    }
+    multicopterSim_->setFaults(mappedFaults);
+}
+
 Eigen::Vector3d MultirotorDynamics::getVehiclePosition() const{
     return multicopterSim_->getVehiclePosition();
 }
@@ -143,10 +161,59 @@ void MultirotorDynamics::getIMUMeasurement(Eigen::Vector3d & accOutput,
 }
 
 bool MultirotorDynamics::getMotorsRpm(std::vector<double>& motorsRpm) {
-    const auto motorsSpeed = multicopterSim_->getMotorsSpeed();
-    for (auto motorSpeed : motorsSpeed) {
-        motorsRpm.push_back(motorSpeed * 9.54929658551);  // rad/sec to RPM
+    const auto& motorsSpeed = multicopterSim_->getMotorsSpeed();
+    motorsRpm.resize(motorsSpeed.size());
+    for (size_t idx = 0; idx < motorsSpeed.size(); idx++) {
+        motorsRpm[idx] = motorsSpeed[idx] * 9.54929658551;  // rad/sec to RPM
     }
 
     return true;
 }
+
+size_t MultirotorDynamics::getMotorsAmount() const{
+    return number_of_motors;
+}
+
+void MultirotorDynamics::calculateSteadyAccelerations(const Eigen::Vector3d& velocity,
+                                                      const Eigen::Quaterniond& attitude,
+                                                      const Eigen::Vector3d& angularVelocity,
+                                                      const std::vector<double>& setpoint,
+                                                      Eigen::Vector3d& linearAccel,
+                                                      Eigen::Vector3d& angularAccel) const{
+    auto actuators = mapCmdActuator(setpoint);
+    multicopterSim_->getSteadyStateDerivative(attitude, velocity, angularVelocity, actuators, true,
+                                              linearAccel, angularAccel);
+}
+
+// Rotation by pi about the x axis: NED to north-west-up and FRD to FLU, it is its own inverse
+static const Eigen::Quaterniond NED_TO_NWU(0, 1, 0, 0);
+
+MultirotorTrimModel::MultirotorTrimModel(const MultirotorDynamics& dynamics) : _dynamics(dynamics){
+}
+std::unique_ptr<TrimModel> MultirotorTrimModel::clone() const{
+    return std::make_unique<MultirotorTrimModel>(_dynamics);
+}
+size_t MultirotorTrimModel::getSetpointsAmount() const{
+    return _dynamics.getMotorsAmount();
+}
+void MultirotorTrimModel::getSetpointLimits(Eigen::VectorXd& lower, Eigen::VectorXd& upper) const{
+    lower.setZero(_dynamics.getMotorsAmount());
+    upper.setOnes(_dynamics.getMotorsAmount());
+}
+void MultirotorTrimModel::calculateAccelerations(const Eigen::Vector3d& linearVelNed,
+                                                 const Eigen::Quaterniond& attitude,
+                                                 const Eigen::Vector3d& angularVel,
+                                                 const std::vector<double>& setpoint,
+                                                 Eigen::Vector3d& linearAccel,
+                                                 Eigen::Vector3d& angularAccel){
+    Eigen::Vector3d modelLinearAccel;
+    Eigen::Vector3d modelAngularAccel;
+    _dynamics.calculateSteadyAccelerations(NED_TO_NWU * linearVelNed,
+                                           NED_TO_NWU * attitude * NED_TO_NWU,
+                                           NED_TO_NWU * angularVel,
+                                           setpoint,
+                                           modelLinearAccel,
+                                           modelAngularAccel);
+    linearAccel = NED_TO_NWU * modelLinearAccel;
+    angularAccel = NED_TO_NWU * modelAngularAccel;
+}
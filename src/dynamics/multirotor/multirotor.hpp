@@ -20,6 +20,7 @@
 #define SRC_DYNAMICS_MULTIROTOR_MULTIROTOR_HPP
 
 #include "uavDynamicsSimBase.hpp"
+#include "trimSolver.hpp"
 #include "../libs/multicopterDynamicsSim/multicopterDynamicsSim.hpp"
 
 class MultirotorDynamics: public UavDynamicsSimBase{
@@ -41,6 +42,25 @@ public:
     void getIMUMeasurement(Eigen::Vector3d & accOutput, Eigen::Vector3d & gyroOutput) override;
     bool getMotorsRpm(std::vector<double>& motorsRpm) override;
 
+    size_t getMotorsAmount() const;
+
+    /**
+     * @brief Motors indexes of the faults are converted from the setpoint to MulticopterDynamicsSim
+     */
+    void setFaults(const std::vector<Fault>& faults) override;
+
+    /**
+     * @brief Accelerations with the motors held at the unitless setpoint of process(),
+     * without the motors lag and the stochastic force and moment. It is the model of MultirotorTrimModel.
+     * @note Vectors are in the frames of MulticopterDynamicsSim: the world z axis is up, FLU body
+     */
+    void calculateSteadyAccelerations(const Eigen::Vector3d& velocity,
+                                      const Eigen::Quaterniond& attitude,
+                                      const Eigen::Vector3d& angularVelocity,
+                                      const std::vector<double>& setpoint,
+                                      Eigen::Vector3d& linearAccel,
+                                      Eigen::Vector3d& angularAccel) const;
+
 protected:
     /**
      * @brief Set motor frames
@@ -56,4 +76,27 @@ protected:
     uint8_t number_of_motors;
 };
 
+/**
+ * @brief TrimSolver model of an initialized MultirotorDynamics. The model frames are converted to
+ * NED and FRD by the rotation by pi about the x axis, so the world is treated as north-west-up.
+ * @note The clones share the vehicle, it must outlive them and must not be modified during solving
+ */
+class MultirotorTrimModel : public TrimModel{
+public:
+    explicit MultirotorTrimModel(const MultirotorDynamics& dynamics);
+
+    std::unique_ptr<TrimModel> clone() const override;
+    size_t getSetpointsAmount() const override;
+    void getSetpointLimits(Eigen::VectorXd& lower, Eigen::VectorXd& upper) const override;
+    void calculateAccelerations(const Eigen::Vector3d& linearVelNed,
+                                const Eigen::Quaterniond& attitude,
+                                const Eigen::Vector3d& angularVel,
+                                const std::vector<double>& setpoint,
+                                Eigen::Vector3d& linearAccel,
+                                Eigen::Vector3d& angularAccel) override;
+
+private:
+    const MultirotorDynamics& _dynamics;
+};
+
 #endif  // SRC_DYNAMICS_MULTIROTOR_MULTIROTOR_HPP
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#ifndef UAV_DYNAMICS_STAGED_UPDATE_HPP
+#define UAV_DYNAMICS_STAGED_UPDATE_HPP
+
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief Single slot handoff of an object built by another thread to the dynamics thread.
+ * Both sides only exchange a pointer, so the step path doesn't lock. The ownership moves with
+ * the pointer: a newer post() deletes the older unclaimed object, take() gives it to the caller.
+ * @note A copy starts empty, so the dynamics that own it stay copyable
+ */
+template<typename T>
+class StagedUpdate{
+public:
+    StagedUpdate() = default;
+    StagedUpdate(const StagedUpdate&) noexcept {}
+    StagedUpdate& operator=(const StagedUpdate&) noexcept { return *this; }
+    ~StagedUpdate() { delete _pending.load(std::memory_order_relaxed); }
+
+    void post(std::unique_ptr<T> update) noexcept {
+        delete _pending.exchange(update.release(), std::memory_order_acq_rel);
+    }
+
+    /**
+     * @return the latest posted object or nullptr, it is a single relaxed load if nothing is posted
+     */
+    std::unique_ptr<T> take() noexcept {
+        if(_pending.load(std::memory_order_relaxed) == nullptr){
+            return nullptr;
+        }
+        return std::unique_ptr<T>(_pending.exchange(nullptr, std::memory_order_acq_rel));
+    }
+
+private:
+    std::atomic<T*> _pending{nullptr};
+};
+
+#endif  // UAV_DYNAMICS_STAGED_UPDATE_HPP
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#include "trimSolver.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+static constexpr size_t RESIDUALS_AMOUNT = 6;       // linear and angular accelerations
+static constexpr size_t ANGLES_AMOUNT = 2;          // roll and pitch
+static constexpr size_t MAX_LINE_SEARCH_STEPS = 10;
+static constexpr double DAMPING = 1e-9;
+
+/**
+ * @brief FRD to NED attitude by the intrinsic yaw, pitch and roll rotations
+ */
+static Eigen::Quaterniond eulerToQuaternion(double roll, double pitch, double yaw){
+    return Eigen::AngleAxisd(yaw, Eigen::Vector3d::UnitZ()) *
+           Eigen::AngleAxisd(pitch, Eigen::Vector3d::UnitY()) *
+           Eigen::AngleAxisd(roll, Eigen::Vector3d::UnitX());
+}
+
+/**
+ * @return Derivative of roll, pitch and yaw by the FRD angular velocity
+ */
+static Eigen::Vector3d calculateEulerRates(const Eigen::Vector3d& euler, const Eigen::Vector3d& angularVel){
+    const double sinRoll = std::sin(euler[0]);
+    const double cosRoll = std::cos(euler[0]);
+    const double tanPitch = std::tan(euler[1]);
+    const double cosPitchInv = 1.0 / std::cos(euler[1]);
+    Eigen::Matrix3d kinematics;
+    kinematics << 1, sinRoll * tanPitch,        cosRoll * tanPitch,
+                  0, cosRoll,                   -sinRoll,
+                  0, sinRoll * cosPitchInv,     cosRoll * cosPitchInv;
+    return kinematics * angularVel;
+}
+
+/**
+ * @brief x = [velocity NED, roll, pitch, yaw, angular velocity FRD]
+ */
+static Eigen::Matrix<double, TrimSolver::STATE_SIZE, 1> calculateStateDerivative(TrimModel& model,
+        const Eigen::Matrix<double, TrimSolver::STATE_SIZE, 1>& state,
+        const std::vector<double>& setpoint){
+    const Eigen::Vector3d linearVelNed = state.segment<3>(0);
+    const Eigen::Vector3d euler = state.segment<3>(3);
+    const Eigen::Vector3d angularVel = state.segment<3>(6);
+    Eigen::Vector3d linearAccel;
+    Eigen::Vector3d angularAccel;
+    model.calculateAccelerations(linearVelNed, eulerToQuaternion(euler[0], euler[1], euler[2]), angularVel,
+                                 setpoint, linearAccel, angularAccel);
+
+    Eigen::Matrix<double, TrimSolver::STATE_SIZE, 1> derivative;
+    derivative << linearAccel, calculateEulerRates(euler, angularVel), angularAccel;
+    return derivative;
+}
+
+TrimSolver::TrimSolver(const TrimModel& model, const TrimOptions& options) :
+        _model(model.clone()), _options(options){
+    const size_t setpointsAmount = _model->getSetpointsAmount();
+    _model->getSetpointLimits(_lower, _upper);
+    assert(static_cast<size_t>(_lower.size()) == setpointsAmount);
+    assert(static_cast<size_t>(_upper.size()) == setpointsAmount);
+
+    if(_options.initialSetpoint.empty()){
+        _options.initialSetpoint.resize(setpointsAmount);
+        for(size_t idx = 0; idx < setpointsAmount; idx++){
+            _options.initialSetpoint[idx] = 0.5 * (_lower[idx] + _upper[idx]);
+        }
+    }
+    _options.fixedSetpoints.resize(setpointsAmount, false);
+    assert(_options.initialSetpoint.size() == setpointsAmount);
+}
+
+TrimResult TrimSolver::solve(const TrimPoint& point) const{
+    auto model = _model->clone();
+    return solvePoint(*model, point);
+}
+
+std::vector<TrimResult> TrimSolver::solve(const std::vector<TrimPoint>& points, size_t threadsAmount) const{
+    if(threadsAmount == 0){
+        threadsAmount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    threadsAmount = std::min(threadsAmount, points.size());
+
+    std::vector<TrimResult> results(points.size());
+    std::atomic<size_t> nextPointIdx{0};
+    auto worker = [&](){
+        auto model = _model->clone();
+        for(size_t idx = nextPointIdx++; idx < points.size(); idx = nextPointIdx++){
+            results[idx] = solvePoint(*model, points[idx]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadsAmount);
+    for(size_t idx = 0; idx < threadsAmount; idx++){
+        threads.emplace_back(worker);
+    }
+    for(auto& thread : threads){
+        thread.join();
+    }
+    return results;
+}
+
+/**
+ * @note The unknowns are the free setpoints, the roll and the pitch, the residuals are the linear and
+ * the angular accelerations of the straight flight with zero angular velocity
+ */
+TrimResult TrimSolver::solvePoint(TrimModel& model, const TrimPoint& point) const{
+    TrimResult result;
+    result.point = point;
+    result.setpoint = _options.initialSetpoint;
+    if(std::abs(point.climbRate) > point.airspeed){
+        return result;
+    }
+    const double horizontalSpeed = std::sqrt(point.airspeed * point.airspeed - point.climbRate * point.climbRate);
+    result.linearVelNed << horizontalSpeed, 0.0, -point.climbRate;
+
+    std::vector<size_t> freeSetpoints;
+    for(size_t idx = 0; idx < result.setpoint.size(); idx++){
+        if(!_options.fixedSetpoints[idx]){
+            freeSetpoints.push_back(idx);
+        }
+    }
+    const size_t unknownsAmount = freeSetpoints.size() + ANGLES_AMOUNT;
+
+    std::vector<double> setpoint = result.setpoint;
+    auto calculateResidual = [&](const Eigen::VectorXd& unknowns){
+        for(size_t idx = 0; idx < freeSetpoints.size(); idx++){
+            setpoint[freeSetpoints[idx]] = unknowns[idx];
+        }
+        const double roll = unknowns[freeSetpoints.size()];
+        const double pitch = unknowns[freeSetpoints.size() + 1];
+        Eigen::Vector3d linearAccel;
+        Eigen::Vector3d angularAccel;
+        model.calculateAccelerations(result.linearVelNed, eulerToQuaternion(roll, pitch, 0.0),
+                                     Eigen::Vector3d::Zero(), setpoint, linearAccel, angularAccel);
+        Eigen::Matrix<double, RESIDUALS_AMOUNT, 1> residual;
+        residual << linearAccel, angularAccel;
+        return residual;
+    };
+    auto clampToLimits = [&](Eigen::VectorXd& unknowns){
+        for(size_t idx = 0; idx < freeSetpoints.size(); idx++){
+            const size_t setpointIdx = freeSetpoints[idx];
+            unknowns[idx] = std::clamp(unknowns[idx], _lower[setpointIdx], _upper[setpointIdx]);
+        }
+        for(size_t idx = freeSetpoints.size(); idx < unknownsAmount; idx++){
+            unknowns[idx] = std::clamp(unknowns[idx], -M_PI_2 + 0.01, M_PI_2 - 0.01);
+        }
+    };
+
+    Eigen::VectorXd unknowns = Eigen::VectorXd::Zero(unknownsAmount);
+    for(size_t idx = 0; idx < freeSetpoints.size(); idx++){
+        unknowns[idx] = result.setpoint[freeSetpoints[idx]];
+    }
+
+    Eigen::Matrix<double, RESIDUALS_AMOUNT, 1> residual = calculateResidual(unknowns);
+    Eigen::Matrix<double, RESIDUALS_AMOUNT, Eigen::Dynamic> jacobian(RESIDUALS_AMOUNT, unknownsAmount);
+    const double step = _options.perturbation;
+    while(residual.norm() > _options.tolerance && result.iterations < _options.maxIterations){
+        result.iterations++;
+        for(size_t idx = 0; idx < unknownsAmount; idx++){
+            Eigen::VectorXd plus = unknowns;
+            Eigen::VectorXd minus = unknowns;
+            plus[idx] += step;
+            minus[idx] -= step;
+            clampToLimits(plus);
+            clampToLimits(minus);
+            jacobian.col(idx) = (calculateResidual(plus) - calculateResidual(minus)) / (plus[idx] - minus[idx]);
+        }
+
+        // Minimal norm step: J^T * (J * J^T + damping * I)^-1 * r
+        Eigen::Matrix<double, RESIDUALS_AMOUNT, RESIDUALS_AMOUNT> system = jacobian * jacobian.transpose();
+        system.diagonal().array() += DAMPING * std::max(system.diagonal().maxCoeff(), 1.0);
+        const Eigen::VectorXd delta = jacobian.transpose() * system.ldlt().solve(residual);
+
+        double gain = 1.0;
+        bool isImproved = false;
+        for(size_t lineSearchStep = 0; lineSearchStep < MAX_LINE_SEARCH_STEPS; lineSearchStep++){
+            Eigen::VectorXd candidate = unknowns - gain * delta;
+            clampToLimits(candidate);
+            auto candidateResidual = calculateResidual(candidate);
+            if(candidateResidual.norm() < residual.norm()){
+                unknowns = candidate;
+                residual = candidateResidual;
+                isImproved = true;
+                break;
+            }
+            gain *= 0.5;
+        }
+        if(!isImproved){
+            break;
+        }
+    }
+
+    calculateResidual(unknowns);
+    result.setpoint = setpoint;
+    result.roll = unknowns[freeSetpoints.size()];
+    result.pitch = unknowns[freeSetpoints.size() + 1];
+    result.attitude = eulerToQuaternion(result.roll, result.pitch, 0.0);
+    result.residual = residual.norm();
+    result.isConverged = result.residual <= _options.tolerance;
+    linearize(model, result);
+    return result;
+}
+
+void TrimSolver::linearize(TrimModel& model, TrimResult& result) const{
+    Eigen::Matrix<double, STATE_SIZE, 1> state;
+    state << result.linearVelNed, result.roll, result.pitch, 0.0, Eigen::Vector3d::Zero();
+    const double step = _options.perturbation;
+
+    result.A.resize(STATE_SIZE, STATE_SIZE);
+    for(size_t idx = 0; idx < STATE_SIZE; idx++){
+        auto plus = state;
+        auto minus = state;
+        plus[idx] += step;
+        minus[idx] -= step;
+        result.A.col(idx) = (calculateStateDerivative(model, plus, result.setpoint) -
+                             calculateStateDerivative(model, minus, result.setpoint)) / (2 * step);
+    }
+
+    const size_t setpointsAmount = result.setpoint.size();
+    result.B.resize(STATE_SIZE, setpointsAmount);
+    std::vector<double> plus = result.setpoint;
+    std::vector<double> minus = result.setpoint;
+    for(size_t idx = 0; idx < setpointsAmount; idx++){
+        // One-sided at the limits, the model saturates the setpoint there
+        plus[idx] = std::min(plus[idx] + step, _upper[idx]);
+        minus[idx] = std::max(minus[idx] - step, _lower[idx]);
+        result.B.col(idx) = (calculateStateDerivative(model, state, plus) -
+                             calculateStateDerivative(model, state, minus)) / (plus[idx] - minus[idx]);
+        plus[idx] = result.setpoint[idx];
+        minus[idx] = result.setpoint[idx];
+    }
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#ifndef UAV_DYNAMICS_TRIM_SOLVER_HPP
+#define UAV_DYNAMICS_TRIM_SOLVER_HPP
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Vehicle model of TrimSolver: accelerations for the given state with the actuators held at
+ * the unitless setpoint of UavDynamicsSimBase::process(), i.e. without the actuators lag and noise.
+ * The vehicle flies in still air, so the velocity is also the airspeed.
+ * @note Vectors are in the NED and FRD frames regardless of the frames of the vehicle
+ */
+class TrimModel{
+public:
+    virtual ~TrimModel() = default;
+
+    /**
+     * @brief Each solver thread works with its own clone
+     */
+    virtual std::unique_ptr<TrimModel> clone() const = 0;
+
+    virtual size_t getSetpointsAmount() const = 0;
+    virtual void getSetpointLimits(Eigen::VectorXd& lower, Eigen::VectorXd& upper) const = 0;
+
+    /**
+     * @param[out] linearAccel - NED, m/sec^2
+     * @param[out] angularAccel - FRD, rad/sec^2
+     */
+    virtual void calculateAccelerations(const Eigen::Vector3d& linearVelNed,
+                                        const Eigen::Quaterniond& attitude,
+                                        const Eigen::Vector3d& angularVel,
+                                        const std::vector<double>& setpoint,
+                                        Eigen::Vector3d& linearAccel,
+                                        Eigen::Vector3d& angularAccel) = 0;
+};
+
+/**
+ * @brief Straight flight to the north with zero heading
+ */
+struct TrimPoint{
+    double airspeed{0.0};                           // m/sec
+    double climbRate{0.0};                          // m/sec, positive up, not above the airspeed
+};
+
+struct TrimOptions{
+    std::vector<double> initialSetpoint;            // empty means the middle of the limits
+    std::vector<bool> fixedSetpoints;               // true keeps the initial value, e.g. a stopped motor
+    size_t maxIterations{100};
+    double tolerance{1e-6};                         // norm of the linear and angular accelerations
+    double perturbation{1e-6};                      // central differences step of the setpoints and the state
+};
+
+/**
+ * @brief Trim and linearization of one operating point.
+ * The state is x = [velocity NED, roll, pitch, yaw, angular velocity FRD], the input is the setpoint,
+ * the position is omitted because the dynamics doesn't depend on it.
+ */
+struct TrimResult{
+    TrimPoint point;
+    bool isConverged{false};
+    size_t iterations{0};
+    double residual{0.0};                           // norm of the accelerations at the solution
+
+    std::vector<double> setpoint;
+    double roll{0.0};                               // rad
+    double pitch{0.0};                              // rad
+    Eigen::Vector3d linearVelNed{Eigen::Vector3d::Zero()};
+    Eigen::Quaterniond attitude{Eigen::Quaterniond::Identity()};
+
+    Eigen::MatrixXd A;                              // 9 x 9, dx/dt = A * dx + B * du
+    Eigen::MatrixXd B;                              // 9 x setpoints amount
+};
+
+/**
+ * @brief Offline trim solver: the setpoint, the roll and the pitch that zero the accelerations are
+ * found with damped Gauss-Newton iterations on the finite differences Jacobian, the setpoints are kept
+ * within the limits. If there are more unknowns than equations, the step of the minimal norm is taken,
+ * so the solution stays close to the initial setpoint.
+ */
+class TrimSolver{
+public:
+    static constexpr size_t STATE_SIZE = 9;
+
+    TrimSolver(const TrimModel& model, const TrimOptions& options);
+
+    TrimResult solve(const TrimPoint& point) const;
+
+    /**
+     * @brief Solve the independent points in parallel
+     * @param[in] threadsAmount - 0 means std::thread::hardware_concurrency()
+     * @return Results in the order of the points
+     */
+    std::vector<TrimResult> solve(const std::vector<TrimPoint>& points, size_t threadsAmount = 0) const;
+
+private:
+    TrimResult solvePoint(TrimModel& model, const TrimPoint& point) const;
+    void linearize(TrimModel& model, TrimResult& result) const;
+
+    std::unique_ptr<TrimModel> _model;
+    TrimOptions _options;
+    Eigen::VectorXd _lower;
+    Eigen::VectorXd _upper;
+};
+
+#endif  // UAV_DYNAMICS_TRIM_SOLVER_HPP
@@ -25,6 +25,8 @@
 #include <ros/ros.h>
 #include <geometry_msgs/TransformStamped.h>
 #include <tf2_ros/static_transform_broadcaster.h>
+#include "diagnostics.hpp"
+#include "faults.hpp"
 
 
 class UavDynamicsSimBase{
@@ -52,6 +54,12 @@ public:
     virtual Eigen::Vector3d getVehicleAirspeed() const = 0;
     virtual Eigen::Vector3d getVehicleAngularVelocity(void) const = 0;
     virtual void getIMUMeasurement(Eigen::Vector3d & accOutput, Eigen::Vector3d & gyroOutput) = 0;
+
+    /**
+     * @brief Overwrite motorsRpm with the current motors rpm
+     * @note Implementations reuse the vector capacity, so a caller that keeps the vector
+     * between steps doesn't allocate after the first call
+     */
     virtual bool getMotorsRpm(std::vector<double>& motorsRpm);
 
     enum class SimMode_t{
@@ -77,6 +85,26 @@ public:
         AIRSPEED = 21,              // Emulate airspeed
     };
     virtual int8_t calibrate(SimMode_t calibrationType) { return -1; }
+
+    /**
+     * @brief Replace the fault schedule, the sim time of the schedule starts from zero
+     */
+    virtual void setFaults(const std::vector<Fault>& /*faults*/) {}
+
+    /**
+     * @brief Reload the vehicle parameters from rosparam while the simulation is running.
+     * It is called from another thread than process(), the new parameters are applied by it.
+     * @return -1 if it is not supported or the new parameters are wrong, the old ones are kept then
+     */
+    virtual int8_t reloadParams() { return -1; }
+
+    /**
+     * @brief Event counters of the physics, they are safe to read from another thread
+     */
+    const DynamicsDiagnostics& getDiagnostics() const { return _diagnostics; }
+
+protected:
+    DynamicsDiagnostics _diagnostics;
 };
 
 
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#include "vehicleParamsCache.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static constexpr char MAGIC[8] = {'U', 'A', 'V', 'P', 'A', 'R', 'A', 'M'};
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+/**
+ * @return Hash of the paths, sizes and modification times, 0 if any of the files is absent
+ */
+static uint64_t calculateSourcesStamp(const std::vector<std::string>& sources){
+    uint64_t stamp = VehicleParamsCache::calculateChecksum(nullptr, 0);
+    for(const auto& source : sources){
+        struct stat status;
+        if(stat(source.c_str(), &status) != 0){
+            return 0;
+        }
+        const int64_t fileInfo[3] = {status.st_size, status.st_mtim.tv_sec, status.st_mtim.tv_nsec};
+        stamp = VehicleParamsCache::calculateChecksum(reinterpret_cast<const uint8_t*>(source.data()),
+                                                      source.size(), stamp);
+        stamp = VehicleParamsCache::calculateChecksum(reinterpret_cast<const uint8_t*>(fileInfo),
+                                                      sizeof(fileInfo), stamp);
+    }
+    return stamp;
+}
+
+VehicleParamsCache::~VehicleParamsCache(){
+    unmap();
+}
+
+uint64_t VehicleParamsCache::calculateChecksum(const uint8_t* data, size_t size, uint64_t hash){
+    for(size_t idx = 0; idx < size; idx++){
+        hash = (hash ^ data[idx]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+bool VehicleParamsCache::open(const std::string& path, const std::vector<std::string>& sources){
+    unmap();
+    _path = path;
+    _sourcesStamp = calculateSourcesStamp(sources);
+    _recorded.clear();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+    struct stat status;
+    if(fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(Header)){
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED){
+        return false;
+    }
+    _mapping = static_cast<const uint8_t*>(mapping);
+    _mappingSize = status.st_size;
+
+    Header header;
+    std::memcpy(&header, _mapping, sizeof(Header));
+    const uint8_t* payload = _mapping + sizeof(Header);
+    const size_t entriesSize = header.entriesAmount * sizeof(Entry);
+    if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header.version != VERSION ||
+            _sourcesStamp == 0 || header.sourcesStamp != _sourcesStamp ||
+            header.payloadSize != _mappingSize - sizeof(Header) ||
+            entriesSize > header.payloadSize ||
+            calculateChecksum(payload, header.payloadSize) != header.checksum){
+        unmap();
+        return false;
+    }
+
+    const auto* entries = reinterpret_cast<const Entry*>(payload);
+    const auto* values = reinterpret_cast<const double*>(payload + entriesSize);
+    const size_t valuesAmount = (header.payloadSize - entriesSize) / sizeof(double);
+    _index.reserve(header.entriesAmount);
+    for(size_t idx = 0; idx < header.entriesAmount; idx++){
+        const auto& entry = entries[idx];
+        if(entry.name[NAME_MAX_LENGTH] != '\0' || entry.offset > valuesAmount ||
+                entry.size > valuesAmount - entry.offset){
+            unmap();
+            return false;
+        }
+        _index.push_back({entry.name, values + entry.offset, entry.size});
+    }
+    return true;
+}
+
+bool VehicleParamsCache::isMapped() const{
+    return _mapping != nullptr;
+}
+
+int8_t VehicleParamsCache::write() const{
+    if(_path.empty() || _sourcesStamp == 0 || _recorded.empty()){
+        return -1;
+    }
+
+    std::vector<Entry> entries(_recorded.size());
+    std::vector<double> values;
+    for(size_t idx = 0; idx < _recorded.size(); idx++){
+        const auto& param = _recorded[idx];
+        if(param.name.size() > NAME_MAX_LENGTH){
+            return -1;
+        }
+        std::memset(&entries[idx], 0, sizeof(Entry));
+        std::memcpy(entries[idx].name, param.name.data(), param.name.size());
+        entries[idx].offset = values.size();
+        entries[idx].size = param.values.size();
+        values.insert(values.end(), param.values.begin(), param.values.end());
+    }
+
+    const size_t entriesSize = entries.size() * sizeof(Entry);
+    const size_t valuesSize = values.size() * sizeof(double);
+    std::vector<uint8_t> payload(entriesSize + valuesSize);
+    std::memcpy(payload.data(), entries.data(), entriesSize);
+    std::memcpy(payload.data() + entriesSize, values.data(), valuesSize);
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entriesAmount = entries.size();
+    header.sourcesStamp = _sourcesStamp;
+    header.payloadSize = payload.size();
+    header.checksum = calculateChecksum(payload.data(), payload.size());
+
+    // The other processes see either the old file or the complete new one
+    const std::string tmpPath = _path + ".tmp" + std::to_string(getpid());
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    file.close();
+    if(!file || std::rename(tmpPath.c_str(), _path.c_str()) != 0){
+        std::remove(tmpPath.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+void VehicleParamsCache::unmap(){
+    if(_mapping != nullptr){
+        munmap(const_cast<uint8_t*>(_mapping), _mappingSize);
+    }
+    _mapping = nullptr;
+    _mappingSize = 0;
+    _index.clear();
+}
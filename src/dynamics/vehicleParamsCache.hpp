@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#ifndef UAV_DYNAMICS_VEHICLE_PARAMS_CACHE_HPP
+#define UAV_DYNAMICS_VEHICLE_PARAMS_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "bakedParams.hpp"
+
+/**
+ * @brief Binary cache of the vehicle parameters and the aerodynamic tables.
+ * The first start reads the parameter server, record()s the values and write()s the file.
+ * The next starts map the file read-only, so the processes on one host share its pages and
+ * the loaders copy the values without the parameter server calls.
+ * The file has a versioned header with the FNV-1a checksum of the payload and a stamp of the source
+ * yaml files (path, size and modification time), so a damaged or outdated cache is rewritten.
+ * Layout: Header, Entry[entriesAmount], double values[]. The byte order is the native one.
+ */
+class VehicleParamsCache{
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t NAME_MAX_LENGTH = 63;
+
+    VehicleParamsCache() = default;
+    ~VehicleParamsCache();
+    VehicleParamsCache(const VehicleParamsCache&) = delete;
+    VehicleParamsCache& operator=(const VehicleParamsCache&) = delete;
+
+    /**
+     * @param[in] sources - files the parameters are loaded from, they are stat()-ed only
+     * @return true if the cache is valid and mapped, otherwise the parameters should be recorded
+     */
+    bool open(const std::string& path, const std::vector<std::string>& sources);
+    bool isMapped() const;
+
+    /**
+     * @brief Same interface as ros::param::get() for the mapped cache
+     */
+    template<typename T>
+    bool get(const std::string& name, T& value) const{
+        return getBakedParam(_index.data(), _index.size(), name, value);
+    }
+
+    template<typename T>
+    void record(const std::string& name, const T& value){
+        std::vector<double> values;
+        if constexpr (std::is_arithmetic_v<T>){
+            values.push_back(static_cast<double>(value));
+        }else{
+            values.assign(value.begin(), value.end());
+        }
+        _recorded.push_back({name, std::move(values)});
+    }
+
+    /**
+     * @brief Write the recorded parameters to a temporary file and rename it to the path of open()
+     * @return 0 on success, -1 if there is nothing to write or the file can't be written
+     */
+    int8_t write() const;
+
+    static uint64_t calculateChecksum(const uint8_t* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS);
+
+private:
+    static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+    struct Header{
+        char magic[8];
+        uint32_t version;
+        uint32_t entriesAmount;
+        uint64_t sourcesStamp;
+        uint64_t payloadSize;               // entries and values
+        uint64_t checksum;                  // of the payload
+    };
+    struct Entry{
+        char name[NAME_MAX_LENGTH + 1];
+        uint64_t offset;                    // index of the first value
+        uint64_t size;
+    };
+    struct RecordedParam{
+        std::string name;
+        std::vector<double> values;
+    };
+
+    void unmap();
+
+    std::string _path;
+    uint64_t _sourcesStamp{0};
+    const uint8_t* _mapping{nullptr};
+    size_t _mappingSize{0};
+    std::vector<BakedParam> _index;
+    std::vector<RecordedParam> _recorded;
+};
+
+#endif  // UAV_DYNAMICS_VEHICLE_PARAMS_CACHE_HPP
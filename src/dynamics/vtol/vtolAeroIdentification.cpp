@@ -0,0 +1,482 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#include "vtolAeroIdentification.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+static constexpr size_t LOG_STATE_COLUMNS = 19;
+
+/**
+ * @brief The force depends on the CL, CS and CD tables, each moment axis on its own tables
+ */
+enum class AeroBlock : uint8_t {
+    FORCE = 0,
+    MOMENT_X,
+    MOMENT_Y,
+    MOMENT_Z,
+
+    AMOUNT,
+};
+static constexpr size_t AERO_BLOCKS_AMOUNT = static_cast<size_t>(AeroBlock::AMOUNT);
+
+/**
+ * @brief Row-major table as a range of the parameters of its block
+ */
+struct AeroTableLayout{
+    AeroBlock block;
+    size_t offset;                                  // index of the first entry in the block
+    size_t cols;
+    size_t size;
+    double* data;
+};
+
+/**
+ * @brief Derivative of the block output by one table entry: the force or the moment of one axis
+ */
+struct AeroRegressor{
+    size_t paramIdx;
+    Eigen::Vector3d gradient;                       // only x is used by the moment blocks
+};
+
+/**
+ * @brief Normal equations of one block
+ */
+struct NormalEquations{
+    Eigen::MatrixXd lhs;
+    Eigen::VectorXd rhs;
+    double residualSquaredSum{0.0};
+
+    void resize(size_t size){
+        lhs.setZero(size, size);
+        rhs.setZero(size);
+        residualSquaredSum = 0.0;
+    }
+    void add(const NormalEquations& other){
+        lhs += other.lhs;
+        rhs += other.rhs;
+        residualSquaredSum += other.residualSquaredSum;
+    }
+};
+
+template<typename Derived>
+static AeroTableLayout makeLayout(AeroBlock block, size_t& blockSize, Eigen::MatrixBase<Derived>& table){
+    static_assert(Derived::IsRowMajor, "Aerodynamic tables are row-major");
+    AeroTableLayout layout{block, blockSize, static_cast<size_t>(table.cols()), static_cast<size_t>(table.size()),
+                           table.derived().data()};
+    blockSize += table.size();
+    return layout;
+}
+
+static std::array<AeroTableLayout, AERO_TABLES_AMOUNT> makeLayouts(TablesWithCoeffs& tables,
+                                                                  std::array<size_t, AERO_BLOCKS_AMOUNT>& sizes){
+    sizes.fill(0);
+    auto& force = sizes[static_cast<size_t>(AeroBlock::FORCE)];
+    auto& momentX = sizes[static_cast<size_t>(AeroBlock::MOMENT_X)];
+    auto& momentY = sizes[static_cast<size_t>(AeroBlock::MOMENT_Y)];
+    auto& momentZ = sizes[static_cast<size_t>(AeroBlock::MOMENT_Z)];
+    return {
+        makeLayout(AeroBlock::FORCE, force, tables.CLPolynomial),
+        makeLayout(AeroBlock::FORCE, force, tables.CSPolynomial),
+        makeLayout(AeroBlock::FORCE, force, tables.CDPolynomial),
+        makeLayout(AeroBlock::FORCE, force, tables.CS_rudder),
+        makeLayout(AeroBlock::FORCE, force, tables.CS_beta),
+        makeLayout(AeroBlock::MOMENT_X, momentX, tables.CmxPolynomial),
+        makeLayout(AeroBlock::MOMENT_Y, momentY, tables.CmyPolynomial),
+        makeLayout(AeroBlock::MOMENT_Z, momentZ, tables.CmzPolynomial),
+        makeLayout(AeroBlock::MOMENT_X, momentX, tables.CmxAileron),
+        makeLayout(AeroBlock::MOMENT_Y, momentY, tables.CmyElevator),
+        makeLayout(AeroBlock::MOMENT_Z, momentZ, tables.CmzRudder),
+    };
+}
+
+/**
+ * @brief Regressors of Math::calculatePolynomial() followed by Math::polyval() of the first
+ * numberOfCoeffs coefficients
+ */
+template<typename Derived>
+static void addPolynomialRegressors(const Eigen::MatrixBase<Derived>& table,
+                                    const AeroTableLayout& layout,
+                                    double airspeedMod,
+                                    double AoA_deg,
+                                    size_t numberOfCoeffs,
+                                    const Eigen::Vector3d& gradient,
+                                    std::vector<AeroRegressor>& regressors){
+    const size_t prevRowIdx = Math::findPrevRowIdxInMonotonicSequence(table, airspeedMod);
+    const size_t nextRowIdx = prevRowIdx + 1;
+    const double delta = (airspeedMod - table(prevRowIdx, 0)) / (table(nextRowIdx, 0) - table(prevRowIdx, 0));
+    for(size_t coeffIdx = 0; coeffIdx < numberOfCoeffs; coeffIdx++){
+        const double power = std::pow(AoA_deg, static_cast<double>(numberOfCoeffs - 1 - coeffIdx));
+        const size_t col = coeffIdx + 1;
+        regressors.push_back({layout.offset + prevRowIdx * layout.cols + col, (1 - delta) * power * gradient});
+        regressors.push_back({layout.offset + nextRowIdx * layout.cols + col, delta * power * gradient});
+    }
+}
+
+/**
+ * @brief Regressors of the bilinear Math::griddata()
+ */
+template<typename DerivedX, typename DerivedY>
+static void addGriddataRegressors(const Eigen::MatrixBase<DerivedX>& x,
+                                  const Eigen::MatrixBase<DerivedY>& y,
+                                  const AeroTableLayout& layout,
+                                  double xVal,
+                                  double yVal,
+                                  const Eigen::Vector3d& gradient,
+                                  std::vector<AeroRegressor>& regressors){
+    const size_t x1 = Math::findPrevRowIdxInMonotonicSequence(x, xVal);
+    const size_t y1 = Math::findPrevRowIdxInMonotonicSequence(y, yVal);
+    const size_t x2 = x1 + 1;
+    const size_t y2 = y1 + 1;
+    const double wx1 = (x(x2) - xVal) / (x(x2) - x(x1));
+    const double wx2 = (xVal - x(x1)) / (x(x2) - x(x1));
+    const double wy1 = (y(y2) - yVal) / (y(y2) - y(y1));
+    const double wy2 = (yVal - y(y1)) / (y(y2) - y(y1));
+    regressors.push_back({layout.offset + y1 * layout.cols + x1, wy1 * wx1 * gradient});
+    regressors.push_back({layout.offset + y2 * layout.cols + x1, wy2 * wx1 * gradient});
+    regressors.push_back({layout.offset + y1 * layout.cols + x2, wy1 * wx2 * gradient});
+    regressors.push_back({layout.offset + y2 * layout.cols + x2, wy2 * wx2 * gradient});
+}
+
+VtolAeroIdentification::VtolAeroIdentification(const VtolDynamics& dynamics,
+                                               const AeroIdentificationOptions& options) :
+        _dynamics(dynamics), _options(options){
+    _dynamics.setAeroMemoTolerances(AeroMemoTolerances());
+}
+
+AeroIdentificationResult VtolAeroIdentification::fit(const std::vector<AeroFlightSample>& samples,
+                                                     size_t threadsAmount) const{
+    AeroIdentificationResult result;
+    result.tables = _dynamics.getTables();
+    result.samplesAmount = samples.size();
+    std::array<size_t, AERO_BLOCKS_AMOUNT> blockSizes;
+    auto layouts = makeLayouts(result.tables, blockSizes);
+
+    std::array<NormalEquations, AERO_BLOCKS_AMOUNT> equations;
+    for(size_t blockIdx = 0; blockIdx < AERO_BLOCKS_AMOUNT; blockIdx++){
+        equations[blockIdx].resize(blockSizes[blockIdx]);
+    }
+    if(samples.empty()){
+        return result;
+    }
+
+    if(threadsAmount == 0){
+        threadsAmount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    threadsAmount = std::min(threadsAmount, samples.size());
+
+    std::mutex equationsMutex;
+    auto worker = [&](size_t firstIdx, size_t lastIdx){
+        VtolDynamics dynamics = _dynamics;
+        const auto& params = dynamics.getParameters();
+        const auto& tables = dynamics.getTables();
+
+        std::array<NormalEquations, AERO_BLOCKS_AMOUNT> local;
+        for(size_t blockIdx = 0; blockIdx < AERO_BLOCKS_AMOUNT; blockIdx++){
+            local[blockIdx].resize(blockSizes[blockIdx]);
+        }
+        std::array<std::vector<AeroRegressor>, AERO_BLOCKS_AMOUNT> regressors;
+        std::vector<double> motors(params.geometry.size());
+
+        for(size_t sampleIdx = firstIdx; sampleIdx < lastIdx; sampleIdx++){
+            const auto& sample = samples[sampleIdx];
+            const auto& body = sample.body;
+
+            // 1. The error of the force and the moment of the current model
+            Eigen::Vector3d linearAccel;
+            Eigen::Vector3d angularAccel;
+            dynamics.calculateSteadyAccelerations(body, sample.windNed, sample.setpoint, linearAccel, angularAccel);
+            const Eigen::Vector3d forceError = params.mass * (body.attitude.inverse() *
+                                                              (sample.linearAccel - linearAccel));
+            const Eigen::Vector3d momentError = params.inertia * (sample.angularAccel - angularAccel);
+
+            // 2. Derivatives of the aerodynamic force and moment by the table entries
+            const Eigen::Vector3d airspeed = dynamics.getVehicleAirspeed();
+            std::array<double, 3> servos;
+            dynamics.mapUnitlessSetpoint(sample.setpoint, motors, servos);
+            const double AoA = dynamics.calculateAnglesOfAtack(airspeed);
+            const double AoS = dynamics.calculateAnglesOfSideslip(airspeed);
+            const double AoA_deg = std::clamp(AoA * 180 / 3.1415, -45.0, +45.0);
+            const double AoS_deg = std::clamp(AoS * 180 / 3.1415, -90.0, +90.0);
+            const double airspeedMod = std::clamp(airspeed.norm(), 5.0, 40.0);
+
+            const double airspeedSquared = airspeed.squaredNorm();
+            const double forceFactor = params.derived.aeroForceFactor * airspeedSquared;
+            const double momentFactor = params.derived.aeroMomentFactor * airspeedSquared;
+            const Eigen::Vector3d pitchAxis(0, 1, 0);
+            const Eigen::Vector3d liftDirection = forceFactor * pitchAxis.cross(airspeed.normalized());
+            const Eigen::Vector3d sideDirection = forceFactor * airspeed.cross(pitchAxis.cross(airspeed.normalized()));
+            const Eigen::Vector3d dragDirection = forceFactor * (-1 * airspeed).normalized();
+            const Eigen::Vector3d momentUnit(momentFactor, 0, 0);
+
+            for(auto& blockRegressors : regressors){
+                blockRegressors.clear();
+            }
+            auto isEnabled = [this](AeroTable table){ return _options.tables[static_cast<size_t>(table)]; };
+            auto layoutOf = [&layouts](AeroTable table) -> const AeroTableLayout& {
+                return layouts[static_cast<size_t>(table)];
+            };
+            auto& forceRegressors = regressors[static_cast<size_t>(AeroBlock::FORCE)];
+            auto& momentXRegressors = regressors[static_cast<size_t>(AeroBlock::MOMENT_X)];
+            auto& momentYRegressors = regressors[static_cast<size_t>(AeroBlock::MOMENT_Y)];
+            auto& momentZRegressors = regressors[static_cast<size_t>(AeroBlock::MOMENT_Z)];
+
+            if(isEnabled(AeroTable::CL_POLYNOMIAL)){
+                addPolynomialRegressors(tables.CLPolynomial, layoutOf(AeroTable::CL_POLYNOMIAL),
+                                        airspeedMod, AoA_deg, 7, liftDirection, forceRegressors);
+            }
+            if(isEnabled(AeroTable::CS_POLYNOMIAL)){
+                addPolynomialRegressors(tables.CSPolynomial, layoutOf(AeroTable::CS_POLYNOMIAL),
+                                        airspeedMod, AoA_deg, 7, sideDirection, forceRegressors);
+            }
+            if(isEnabled(AeroTable::CD_POLYNOMIAL)){
+                addPolynomialRegressors(tables.CDPolynomial, layoutOf(AeroTable::CD_POLYNOMIAL),
+                                        airspeedMod, AoA_deg, 5, dragDirection, forceRegressors);
+            }
+            if(isEnabled(AeroTable::CS_RUDDER)){
+                addGriddataRegressors(-tables.actuator, tables.airspeed, layoutOf(AeroTable::CS_RUDDER),
+                                      servos[RUDDERS_INDEX], airspeedMod, sideDirection, forceRegressors);
+            }
+            if(isEnabled(AeroTable::CS_BETA)){
+                addGriddataRegressors(-tables.AoS, tables.airspeed, layoutOf(AeroTable::CS_BETA),
+                                      AoS_deg, airspeedMod, sideDirection, forceRegressors);
+            }
+            if(isEnabled(AeroTable::CMX_POLYNOMIAL)){
+                addPolynomialRegressors(tables.CmxPolynomial, layoutOf(AeroTable::CMX_POLYNOMIAL),
+                                        airspeedMod, AoA_deg, 7, momentUnit, momentXRegressors);
+            }
+            if(isEnabled(AeroTable::CMY_POLYNOMIAL)){
+                addPolynomialRegressors(tables.CmyPolynomial, layoutOf(AeroTable::CMY_POLYNOMIAL),
+                                        airspeedMod, AoA_deg, 7, momentUnit, momentYRegressors);
+            }
+            if(isEnabled(AeroTable::CMZ_POLYNOMIAL)){
+                addPolynomialRegressors(tables.CmzPolynomial, layoutOf(AeroTable::CMZ_POLYNOMIAL),
+                                        airspeedMod, AoA_deg, 7, -momentUnit, momentZRegressors);
+            }
+            if(isEnabled(AeroTable::CMX_AILERON)){
+                addGriddataRegressors(tables.actuator, tables.airspeed, layoutOf(AeroTable::CMX_AILERON),
+                                      servos[AILERONS_INDEX], airspeedMod,
+                                      servos[AILERONS_INDEX] * momentUnit, momentXRegressors);
+            }
+            if(isEnabled(AeroTable::CMY_ELEVATOR)){
+                addGriddataRegressors(tables.actuator, tables.airspeed, layoutOf(AeroTable::CMY_ELEVATOR),
+                                      std::abs(servos[ELEVATORS_INDEX]), airspeedMod,
+                                      servos[ELEVATORS_INDEX] * momentUnit, momentYRegressors);
+            }
+            if(isEnabled(AeroTable::CMZ_RUDDER)){
+                addGriddataRegressors(tables.actuator, tables.airspeed, layoutOf(AeroTable::CMZ_RUDDER),
+                                      servos[RUDDERS_INDEX], airspeedMod,
+                                      servos[RUDDERS_INDEX] * momentUnit, momentZRegressors);
+            }
+
+            // 3. Accumulate J^T * J and J^T * r, the regressors are sparse
+            const std::array<Eigen::Vector3d, AERO_BLOCKS_AMOUNT> errors{
+                forceError,
+                Eigen::Vector3d(momentError[0], 0, 0),
+                Eigen::Vector3d(momentError[1], 0, 0),
+                Eigen::Vector3d(momentError[2], 0, 0),
+            };
+            for(size_t blockIdx = 0; blockIdx < AERO_BLOCKS_AMOUNT; blockIdx++){
+                auto& block = local[blockIdx];
+                const auto& blockRegressors = regressors[blockIdx];
+                for(const auto& row : blockRegressors){
+                    block.rhs[row.paramIdx] += row.gradient.dot(errors[blockIdx]);
+                    for(const auto& col : blockRegressors){
+                        block.lhs(row.paramIdx, col.paramIdx) += row.gradient.dot(col.gradient);
+                    }
+                }
+                block.residualSquaredSum += errors[blockIdx].squaredNorm();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(equationsMutex);
+        for(size_t blockIdx = 0; blockIdx < AERO_BLOCKS_AMOUNT; blockIdx++){
+            equations[blockIdx].add(local[blockIdx]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadsAmount);
+    for(size_t threadIdx = 0; threadIdx < threadsAmount; threadIdx++){
+        const size_t firstIdx = samples.size() * threadIdx / threadsAmount;
+        const size_t lastIdx = samples.size() * (threadIdx + 1) / threadsAmount;
+        threads.emplace_back(worker, firstIdx, lastIdx);
+    }
+    for(auto& thread : threads){
+        thread.join();
+    }
+
+    // 4. Solve (J^T * J + regularization * diag(J^T * J)) * delta = J^T * r for the excited entries
+    std::array<Eigen::VectorXd, AERO_BLOCKS_AMOUNT> corrections;
+    std::array<double, AERO_BLOCKS_AMOUNT> rmsBefore;
+    std::array<double, AERO_BLOCKS_AMOUNT> rmsAfter;
+    for(size_t blockIdx = 0; blockIdx < AERO_BLOCKS_AMOUNT; blockIdx++){
+        const auto& block = equations[blockIdx];
+        const Eigen::VectorXd diagonal = block.lhs.diagonal();
+        std::vector<size_t> excited;
+        for(size_t paramIdx = 0; paramIdx < static_cast<size_t>(diagonal.size()); paramIdx++){
+            if(diagonal[paramIdx] > 0.0){
+                excited.push_back(paramIdx);
+            }
+        }
+
+        // The powers of AoA differ by orders of magnitude, so the equations are scaled to the unit diagonal
+        const size_t excitedAmount = excited.size();
+        Eigen::VectorXd scale(excitedAmount);
+        for(size_t idx = 0; idx < excitedAmount; idx++){
+            scale[idx] = 1.0 / std::sqrt(diagonal[excited[idx]]);
+        }
+        Eigen::MatrixXd lhs(excitedAmount, excitedAmount);
+        Eigen::VectorXd rhs(excitedAmount);
+        for(size_t row = 0; row < excitedAmount; row++){
+            rhs[row] = scale[row] * block.rhs[excited[row]];
+            for(size_t col = 0; col < excitedAmount; col++){
+                lhs(row, col) = scale[row] * block.lhs(excited[row], excited[col]) * scale[col];
+            }
+            lhs(row, row) += _options.regularization;
+        }
+        const Eigen::VectorXd delta = scale.cwiseProduct(lhs.ldlt().solve(rhs));
+
+        corrections[blockIdx].setZero(blockSizes[blockIdx]);
+        for(size_t idx = 0; idx < excitedAmount; idx++){
+            corrections[blockIdx][excited[idx]] = delta[idx];
+        }
+        const auto& correction = corrections[blockIdx];
+        const double residualAfter = block.residualSquaredSum - 2 * correction.dot(block.rhs) +
+                                     correction.dot(block.lhs * correction);
+        rmsBefore[blockIdx] = std::sqrt(block.residualSquaredSum / samples.size());
+        rmsAfter[blockIdx] = std::sqrt(std::max(residualAfter, 0.0) / samples.size());
+        result.parametersAmount += excitedAmount;
+    }
+
+    for(const auto& layout : layouts){
+        const auto& correction = corrections[static_cast<size_t>(layout.block)];
+        for(size_t idx = 0; idx < layout.size; idx++){
+            layout.data[idx] += correction[layout.offset + idx];
+        }
+    }
+
+    result.forceRmsBefore = rmsBefore[static_cast<size_t>(AeroBlock::FORCE)];
+    result.forceRmsAfter = rmsAfter[static_cast<size_t>(AeroBlock::FORCE)];
+    for(size_t axis = 0; axis < 3; axis++){
+        result.momentRmsBefore[axis] = rmsBefore[static_cast<size_t>(AeroBlock::MOMENT_X) + axis];
+        result.momentRmsAfter[axis] = rmsAfter[static_cast<size_t>(AeroBlock::MOMENT_X) + axis];
+    }
+    return result;
+}
+
+/**
+ * @return false if the cell is empty, isn't a number or has anything but spaces after it
+ */
+static bool parseLogCell(const std::string& cell, double& value){
+    size_t parsedSize;
+    try {
+        value = std::stod(cell, &parsedSize);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return cell.find_first_not_of(" \t\r", parsedSize) == std::string::npos;
+}
+
+int8_t loadAeroFlightLog(const std::string& path, std::vector<AeroFlightSample>& samples){
+    std::ifstream file(path);
+    if(!file.is_open()){
+        return -1;
+    }
+
+    std::string line;
+    std::getline(file, line);  // header
+    while(std::getline(file, line)){
+        if(line.empty()){
+            continue;
+        }
+        std::vector<double> values;
+        std::stringstream stream(line);
+        std::string cell;
+        double value;
+        while(std::getline(stream, cell, ',')){
+            if(!parseLogCell(cell, value)){
+                return -1;
+            }
+            values.push_back(value);
+        }
+        if(values.size() < LOG_STATE_COLUMNS){
+            return -1;
+        }
+
+        AeroFlightSample sample;
+        sample.body.position.setZero();
+        sample.body.linearVelNed << values[0], values[1], values[2];
+        sample.body.attitude = Eigen::Quaterniond(values[3], values[4], values[5], values[6]).normalized();
+        sample.body.angularVel << values[7], values[8], values[9];
+        sample.linearAccel << values[10], values[11], values[12];
+        sample.angularAccel << values[13], values[14], values[15];
+        sample.windNed << values[16], values[17], values[18];
+        sample.setpoint.assign(values.begin() + LOG_STATE_COLUMNS, values.end());
+        samples.push_back(std::move(sample));
+    }
+    return 0;
+}
+
+template<typename Derived>
+static void writeTable(std::ofstream& file, const char* name, const Eigen::MatrixBase<Derived>& table){
+    const Eigen::Index cols = Derived::IsRowMajor || table.cols() > 1 ? table.cols() : table.rows();
+    const Eigen::Index rows = table.size() / cols;
+    const std::string indent(std::string(name).size() + 3, ' ');
+    file << name << ": [";
+    for(Eigen::Index row = 0; row < rows; row++){
+        if(row != 0){
+            file << ",\n" << indent;
+        }
+        for(Eigen::Index col = 0; col < cols; col++){
+            file << (col == 0 ? "" : ", ") << table.derived().data()[row * cols + col];
+        }
+    }
+    file << "]\n\n";
+}
+
+int8_t writeAeroTablesYaml(const std::string& path, const TablesWithCoeffs& tables){
+    std::ofstream file(path);
+    if(!file.is_open()){
+        return -1;
+    }
+    file << std::setprecision(std::numeric_limits<double>::max_digits10);
+    writeTable(file, "actuator_table", tables.actuator);
+    writeTable(file, "airspeed_table", tables.airspeed);
+    writeTable(file, "CLPolynomial", tables.CLPolynomial);
+    writeTable(file, "CSPolynomial", tables.CSPolynomial);
+    writeTable(file, "CS_rudder_table", tables.CS_rudder);
+    writeTable(file, "CS_beta", tables.CS_beta);
+    writeTable(file, "CDPolynomial", tables.CDPolynomial);
+    writeTable(file, "CmxPolynomial", tables.CmxPolynomial);
+    writeTable(file, "CmyPolynomial", tables.CmyPolynomial);
+    writeTable(file, "CmzPolynomial", tables.CmzPolynomial);
+    writeTable(file, "CmxAileron", tables.CmxAileron);
+    writeTable(file, "CmyElevator", tables.CmyElevator);
+    writeTable(file, "CmzRudder", tables.CmzRudder);
+    writeTable(file, "AoS", tables.AoS);
+    writeTable(file, "AoA", tables.AoA);
+    file << "#       control force   torque  PWM   RPM\n";
+    writeTable(file, "prop", tables.prop);
+    return file.good() ? 0 : -1;
+}
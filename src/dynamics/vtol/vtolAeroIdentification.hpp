@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#ifndef VTOL_AERO_IDENTIFICATION_HPP
+#define VTOL_AERO_IDENTIFICATION_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+#include "vtolDynamicsSim.hpp"
+
+/**
+ * @brief One logged state of the flight, e.g. PX4 vehicle_local_position (velocity and acceleration),
+ * vehicle_attitude, vehicle_angular_velocity (rates and their derivative), the wind estimate and
+ * actuator_outputs converted to the unitless setpoint
+ */
+struct AeroFlightSample{
+    RigidBodyState body;                            // the position is unused
+    Eigen::Vector3d windNed{Eigen::Vector3d::Zero()};
+    std::vector<double> setpoint;                   // unitless setpoint of VtolDynamics::process()
+    Eigen::Vector3d linearAccel{Eigen::Vector3d::Zero()};   // NED, m/sec^2
+    Eigen::Vector3d angularAccel{Eigen::Vector3d::Zero()};  // FRD, rad/sec^2
+};
+
+enum class AeroTable : uint8_t {
+    CL_POLYNOMIAL = 0,
+    CS_POLYNOMIAL,
+    CD_POLYNOMIAL,
+    CS_RUDDER,
+    CS_BETA,
+    CMX_POLYNOMIAL,
+    CMY_POLYNOMIAL,
+    CMZ_POLYNOMIAL,
+    CMX_AILERON,
+    CMY_ELEVATOR,
+    CMZ_RUDDER,
+
+    AMOUNT,
+};
+static constexpr size_t AERO_TABLES_AMOUNT = static_cast<size_t>(AeroTable::AMOUNT);
+
+struct AeroIdentificationOptions{
+    std::array<bool, AERO_TABLES_AMOUNT> tables{
+        true, true, true, true, true, true, true, true, true, true, true
+    };                                              // tables to correct, the others are kept
+    double regularization{1e-3};                    // relative to the diagonal of the normal equations
+};
+
+struct AeroIdentificationResult{
+    TablesWithCoeffs tables;                        // the input tables with the corrections
+    size_t samplesAmount{0};
+    size_t parametersAmount{0};                     // table entries excited by the samples
+    double forceRmsBefore{0.0};                     // N, norm of the aerodynamic force error
+    double forceRmsAfter{0.0};
+    Eigen::Vector3d momentRmsBefore{Eigen::Vector3d::Zero()};   // N*m, per FRD axis
+    Eigen::Vector3d momentRmsAfter{Eigen::Vector3d::Zero()};
+};
+
+/**
+ * @brief Fit of corrections to the aerodynamic tables from the flight logs.
+ * The logged accelerations are converted to the body force and moment, the motors part and the
+ * current aerodynamics are taken from VtolDynamics, the rest is the aerodynamics error.
+ * The force and the moment of calculateAerodynamics() are linear in the table entries for the given
+ * airspeed and servos, so the least squares problem is solved in one step from the normal equations.
+ * The samples are split between the threads, each thread accumulates its own normal equations.
+ * The force and the roll, pitch and yaw moments depend on different tables, so they are 4 independent
+ * problems. Entries that are not excited by the samples are kept.
+ */
+class VtolAeroIdentification{
+public:
+    VtolAeroIdentification(const VtolDynamics& dynamics, const AeroIdentificationOptions& options);
+
+    /**
+     * @param[in] threadsAmount - 0 means std::thread::hardware_concurrency()
+     */
+    AeroIdentificationResult fit(const std::vector<AeroFlightSample>& samples, size_t threadsAmount = 0) const;
+
+private:
+    VtolDynamics _dynamics;
+    AeroIdentificationOptions _options;
+};
+
+/**
+ * @brief CSV log, a header line and a line per sample with the columns:
+ * vn, ve, vd, qw, qx, qy, qz, p, q, r, an, ae, ad, p_dot, q_dot, r_dot, wind_n, wind_e, wind_d, setpoint...
+ * @return 0 on success, -1 if the file can't be read, a line has less than 19 values or a value
+ * isn't a number, e.g. an empty cell of a gap in the log
+ */
+int8_t loadAeroFlightLog(const std::string& path, std::vector<AeroFlightSample>& samples);
+
+/**
+ * @brief Write the tables in the layout of config/aerodynamics_coeffs.yaml, the values round-trip exactly
+ * @return 0 on success, -1 if the file can't be written
+ */
+int8_t writeAeroTablesYaml(const std::string& path, const TablesWithCoeffs& tables);
+
+#endif  // VTOL_AERO_IDENTIFICATION_HPP
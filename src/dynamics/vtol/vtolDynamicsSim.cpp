@@ -23,13 +23,15 @@
 #include "vtolDynamicsSim.hpp"
 #include <ros/package.h>
 #include <array>
+#include <limits>
 #include "cs_converter.hpp"
 #include "common_math.hpp"
+#include "vehicleParamsCache.hpp"
+#ifdef UAV_DYNAMICS_BAKED_VEHICLE
+#include "baked_params/aerodynamics_coeffs.hpp"
+#include UAV_DYNAMICS_BAKED_VEHICLE_HEADER
+#endif
 
-static constexpr const size_t AILERONS_INDEX = 0;
-static constexpr const size_t ELEVATORS_INDEX = 1;
-static constexpr const size_t RUDDERS_INDEX = 2;
-static constexpr const size_t SERVOS_AMOUNT = 3;
 
 static constexpr const size_t ACTUATORS_MIN_AMOUNT = 8;
 static constexpr const size_t ACTUATORS_MAX_AMOUNT = 12;
@@ -40,6 +42,8 @@ VtolDynamics::VtolDynamics(){
     _state.airspeedFrd.setZero();
     _environment.windNED.setZero();
     _environment.windVariance = 0;
+    _environment.gustVelocityNED.setZero();
+    _environment.gustVariance = 0;
     _params.accelBias.setZero();
     _params.gyroBias.setZero();
     _state.forces.specific << 0, 0, -_environment.gravity;
@@ -55,18 +59,202 @@ int8_t VtolDynamics::init(){
         return -1;
     }
 
+    std::string integrator;
+    if (ros::param::get("/uav/sim_params/vtol_integrator", integrator)) {
+        if (integrator == "euler") {
+            setIntegrationMethod(IntegrationMethod::EULER);
+        } else if (integrator == "semi_implicit_euler") {
+            setIntegrationMethod(IntegrationMethod::SEMI_IMPLICIT_EULER);
+        } else if (integrator == "rk4") {
+            setIntegrationMethod(IntegrationMethod::RK4);
+        } else if (integrator == "rk45") {
+            setIntegrationMethod(IntegrationMethod::RK45);
+        } else {
+            ROS_ERROR("Unknown vtol_integrator \"%s\".", integrator.c_str());
+            return -1;
+        }
+    }
+
+    std::vector<double> gustNed;
+    double gustVariance;
+    if (ros::param::get("/uav/sim_params/gust_ned", gustNed) &&
+            ros::param::get("/uav/sim_params/gust_variance", gustVariance)) {
+        if (gustNed.size() != 3) {
+            ROS_ERROR("gust_ned should have 3 values.");
+            return -1;
+        }
+        setGustParameter(Eigen::Vector3d(gustNed[0], gustNed[1], gustNed[2]), gustVariance);
+    }
+    int gustSeed;
+    if (ros::param::get("/uav/sim_params/gust_seed", gustSeed)) {
+        setTurbulenceSeed(gustSeed);
+    }
+
+    int aeroUpdatePeriod;
+    if (ros::param::get("/uav/sim_params/vtol_aero_update_period", aeroUpdatePeriod)) {
+        if (aeroUpdatePeriod < 1) {
+            ROS_ERROR("vtol_aero_update_period should be positive.");
+            return -1;
+        }
+        bool isExtrapolated = false;
+        ros::param::get("/uav/sim_params/vtol_aero_extrapolation", isExtrapolated);
+        setAeroUpdatePeriod(aeroUpdatePeriod, isExtrapolated);
+    }
+
+    std::vector<double> aeroMemoTolerances;
+    if (ros::param::get("/uav/sim_params/vtol_aero_memo_tolerances", aeroMemoTolerances)) {
+        if (aeroMemoTolerances.size() != 4) {
+            ROS_ERROR("vtol_aero_memo_tolerances should have 4 values.");
+            return -1;
+        }
+        setAeroMemoTolerances({aeroMemoTolerances[0], aeroMemoTolerances[1],
+                               aeroMemoTolerances[2], aeroMemoTolerances[3]});
+    }
+
+#ifndef UAV_DYNAMICS_BAKED_VEHICLE
+    std::string cachePath;
+    if (ros::param::get("/uav/sim_params/vtol_tables_cache", cachePath)) {
+        std::vector<std::string> cacheSources;
+        ros::param::get("/uav/sim_params/vtol_tables_cache_sources", cacheSources);
+        return loadVehicleWithCache(cachePath, cacheSources);
+    }
+#endif
+
     loadTables("/uav/aerodynamics_coeffs/");
     loadParams("/uav/aerodynamics_coeffs/");
     return 0;
 }
 
+bool VtolDynamics::isBaked(){
+#ifdef UAV_DYNAMICS_BAKED_VEHICLE
+    return true;
+#else
+    return false;
+#endif
+}
+
+int8_t VtolDynamics::reloadParams(){
+#ifdef UAV_DYNAMICS_BAKED_VEHICLE
+    ROS_ERROR("The vehicle parameters are baked into the binary, they can't be reloaded.");
+    return -1;
+#else
+    auto loaded = std::make_unique<VtolDynamics>();
+    try {
+        loaded->loadTables("/uav/aerodynamics_coeffs/");
+        loaded->loadParams("/uav/aerodynamics_coeffs/");
+    } catch (const std::exception& e) {
+        ROS_ERROR("Can't reload the vehicle parameters: %s", e.what());
+        return -1;
+    }
+    return stageVehicle(*loaded);
+#endif
+}
+
+/**
+ * @note The motors amount is fixed after init(), so reading it here doesn't race with process()
+ */
+int8_t VtolDynamics::stageVehicle(const VtolDynamics& loaded){
+    const auto& params = loaded._params;
+    const auto& timeConstants = loaded._tables.actuatorTimeConstants;
+    const size_t motorsAmount = _motorsSpeed.size();
+    if(params.geometry.size() != motorsAmount || params.motorMaxSpeed.size() < motorsAmount ||
+            params.servoRange.size() < SERVOS_AMOUNT || timeConstants.size() != motorsAmount + SERVOS_AMOUNT){
+        ROS_ERROR("The reloaded vehicle should have the same motors and servos as the running one.");
+        return -1;
+    }
+    const bool isTimeConstantsValid = std::all_of(timeConstants.begin(), timeConstants.end(),
+                                                  [](double timeConstant){ return timeConstant > 0.001; });
+    if(!(params.mass > 0.0) || !params.inertia.allFinite() || !(params.inertia.determinant() > 0.0) ||
+            !isTimeConstantsValid){
+        ROS_ERROR("The reloaded mass, inertia and actuators time constants should be positive.");
+        return -1;
+    }
+
+    auto staged = std::make_unique<StagedVehicle>();
+    staged->params = params;
+    staged->tables = loaded._tables;
+    staged->motorsForcesAndMoments = loaded._motorsForcesAndMoments;
+    _stagedVehicle.post(std::move(staged));
+    return 0;
+}
+
+/**
+ * @brief Swap the staged model in at a step boundary. The replaced one is freed with the staged
+ * object, the values derived from the model are recalculated with the current environment.
+ */
+void VtolDynamics::applyStagedVehicle(StagedVehicle& staged){
+    staged.params.accelBias = _params.accelBias;
+    staged.params.gyroBias = _params.gyroBias;
+    std::swap(_params, staged.params);
+    std::swap(_tables, staged.tables);
+    _motorsForcesAndMoments = staged.motorsForcesAndMoments;
+    _cursors = TableCursors();
+    _aeroMultiRate.samplesAmount = 0;
+    if(_faultNominal.isSaved){
+        saveFaultNominalParams();
+        applyFaults(_faults.getEffects());
+    }
+    updateDerivedConstants();
+}
+
+// The cache of the running init(), the loaders are called only from it and setAeroTables() doesn't use them
+static thread_local VehicleParamsCache* loadingParamsCache = nullptr;
+
+int8_t VtolDynamics::loadVehicleWithCache(const std::string& cachePath, const std::vector<std::string>& sources){
+    VehicleParamsCache cache;
+    const bool isMapped = cache.open(cachePath, sources);
+    loadingParamsCache = &cache;
+    try {
+        loadTables("/uav/aerodynamics_coeffs/");
+        loadParams("/uav/aerodynamics_coeffs/");
+    } catch (...) {
+        loadingParamsCache = nullptr;
+        throw;
+    }
+    loadingParamsCache = nullptr;
+
+    if (!isMapped && cache.write() != 0) {
+        ROS_WARN("vtol_tables_cache: can't write %s.", cachePath.c_str());
+    }
+    return 0;
+}
+
+/**
+ * @brief The vehicle parameters and the aerodynamic tables are read from the parameter server or,
+ * if the model is compiled with UAV_DYNAMICS_BAKED_VEHICLE, from the headers generated from the yaml
+ * files at build time. As with rosparam, aerodynamics_coeffs.yaml overrides the vehicle parameters.
+ * With vtol_tables_cache they are read from the mapped cache file, the first start records them.
+ */
+template<typename T>
+static bool getVehicleParam(const std::string& path, const std::string& name, T& value){
+#ifdef UAV_DYNAMICS_BAKED_VEHICLE
+    (void)path;
+    return getBakedParam(BakedParams::aerodynamics_coeffs::PARAMS, name, value) ||
+           getBakedParam(BakedParams::UAV_DYNAMICS_BAKED_VEHICLE::PARAMS, name, value);
+#else
+    if(loadingParamsCache != nullptr && loadingParamsCache->isMapped()){
+        return loadingParamsCache->get(name, value);
+    }
+    if(!ros::param::get(path + name, value)){
+        return false;
+    }
+    if(loadingParamsCache != nullptr){
+        loadingParamsCache->record(name, value);
+    }
+    return true;
+#endif
+}
+
 template<int ROWS, int COLS, int ORDER>
 Eigen::MatrixXd getTableNew(const std::string& path, const char* name){
     std::vector<double> data;
 
-    if(ros::param::get(path + name, data) == false){
+    if(getVehicleParam(path, name, data) == false){
         throw std::invalid_argument(std::string("Wrong parameter name: ") + name);
     }
+    if(data.size() != static_cast<size_t>(ROWS * COLS)){
+        throw std::invalid_argument(std::string("Wrong parameter size: ") + name);
+    }
 
     return Eigen::Matrix<double, ROWS, COLS, ORDER>(data.data());
 }
@@ -88,25 +276,202 @@ void VtolDynamics::loadTables(const std::string& path){
     _tables.CmxAileron = getTableNew<8, 20, Eigen::RowMajor>(path, "CmxAileron");
     _tables.CmyElevator = getTableNew<8, 20, Eigen::RowMajor>(path, "CmyElevator");
     _tables.CmzRudder = getTableNew<8, 20, Eigen::RowMajor>(path, "CmzRudder");
-    _tables.prop = getTableNew<40, 5, Eigen::RowMajor>(path, "prop");
+    _tables.prop = getTableNew<PROP_TABLE_SIZE, 5, Eigen::RowMajor>(path, "prop");
+    calculatePropSegments();
+    calculateAeroGrids();
+    loadPropInflowTable(path);
+}
+
+static constexpr size_t PROP_CONTROL_IDX = 0;
+static constexpr size_t PROP_THRUST_IDX = 1;
+static constexpr size_t PROP_TORQUE_IDX = 2;
+static constexpr size_t PROP_RPM_IDX = 4;
+
+void VtolDynamics::calculatePropSegments(){
+    auto& segments = _tables.propSegments;
+    const auto& prop = _tables.prop;
+
+    for(size_t idx = 0; idx < PropSegments::AMOUNT; idx++){
+        if(!(prop(idx + 1, PROP_CONTROL_IDX) > prop(idx, PROP_CONTROL_IDX))){
+            throw std::invalid_argument("Prop table control should be strictly increasing");
+        }
+    }
+
+    for(size_t idx = 0; idx < PropSegments::AMOUNT; idx++){
+        const double controlStep = prop(idx + 1, PROP_CONTROL_IDX) - prop(idx, PROP_CONTROL_IDX);
+        segments.control[idx] = prop(idx, PROP_CONTROL_IDX);
+        segments.thrust[idx] = prop(idx, PROP_THRUST_IDX);
+        segments.torque[idx] = prop(idx, PROP_TORQUE_IDX);
+        segments.rpm[idx] = prop(idx, PROP_RPM_IDX);
+        segments.thrustSlope[idx] = (prop(idx + 1, PROP_THRUST_IDX) - prop(idx, PROP_THRUST_IDX)) / controlStep;
+        segments.torqueSlope[idx] = (prop(idx + 1, PROP_TORQUE_IDX) - prop(idx, PROP_TORQUE_IDX)) / controlStep;
+        segments.rpmSlope[idx] = (prop(idx + 1, PROP_RPM_IDX) - prop(idx, PROP_RPM_IDX)) / controlStep;
+    }
+
+    const double firstStep = prop(1, PROP_CONTROL_IDX) - prop(0, PROP_CONTROL_IDX);
+    segments.isUniform = true;
+    for(size_t idx = 1; idx < PropSegments::AMOUNT; idx++){
+        const double controlStep = prop(idx + 1, PROP_CONTROL_IDX) - prop(idx, PROP_CONTROL_IDX);
+        if(abs(controlStep - firstStep) > 1e-9 * abs(firstStep)){
+            segments.isUniform = false;
+            break;
+        }
+    }
+    segments.controlStepInv = segments.isUniform ? 1.0 / firstStep : 0.0;
+}
+
+/**
+ * @brief Normalize the axes once: the CS tables are along the inverted actuator and AoS axes,
+ * the decreasing axes and their rows or columns are reversed, so all lookups are increasing ones
+ */
+void VtolDynamics::calculateAeroGrids(){
+    auto& grids = _tables.grids;
+    const auto& airspeed = _tables.airspeed;
+    const auto& actuator = _tables.actuator;
+    bool isValid = grids.CLPolynomial.setTable(_tables.CLPolynomial) &&
+                   grids.CSPolynomial.setTable(_tables.CSPolynomial) &&
+                   grids.CDPolynomial.setTable(_tables.CDPolynomial) &&
+                   grids.CmxPolynomial.setTable(_tables.CmxPolynomial) &&
+                   grids.CmyPolynomial.setTable(_tables.CmyPolynomial) &&
+                   grids.CmzPolynomial.setTable(_tables.CmzPolynomial);
+    isValid = isValid && grids.CS_rudder.setAxes(airspeed, -actuator) && grids.CS_rudder.setValues(_tables.CS_rudder);
+    isValid = isValid && grids.CS_beta.setAxes(airspeed, -_tables.AoS) && grids.CS_beta.setValues(_tables.CS_beta);
+    isValid = isValid && grids.CmxAileron.setAxes(airspeed, actuator) &&
+              grids.CmxAileron.setValues(_tables.CmxAileron);
+    isValid = isValid && grids.CmyElevator.setAxes(airspeed, actuator) &&
+              grids.CmyElevator.setValues(_tables.CmyElevator);
+    isValid = isValid && grids.CmzRudder.setAxes(airspeed, actuator) &&
+              grids.CmzRudder.setValues(_tables.CmzRudder);
+    if(!isValid){
+        throw std::invalid_argument("Airspeed, actuator, AoS and polynomials airspeed should be strictly monotonic");
+    }
+}
+
+/**
+ * @brief The 2-D prop table is optional, it is enabled only if prop_inflow_table is present
+ */
+void VtolDynamics::loadPropInflowTable(const std::string& path){
+    std::vector<double> inflow;
+    if(getVehicleParam(path, "prop_inflow_table", inflow) == false){
+        _tables.propInflow.isEnabled = false;
+        return;
+    }
+
+    using RowMajorMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    std::array<RowMajorMatrix, PropInflowCells::OUTPUTS_AMOUNT> tables;
+    const std::array<const char*, PropInflowCells::OUTPUTS_AMOUNT> names{
+        "prop_inflow_thrust", "prop_inflow_torque", "prop_inflow_rpm"};
+    for(size_t idx = 0; idx < PropInflowCells::OUTPUTS_AMOUNT; idx++){
+        std::vector<double> data;
+        if(getVehicleParam(path, names[idx], data) == false ||
+                data.size() != PROP_TABLE_SIZE * inflow.size()){
+            throw std::invalid_argument(std::string("Wrong parameter name: ") + names[idx]);
+        }
+        tables[idx] = Eigen::Map<RowMajorMatrix>(data.data(), PROP_TABLE_SIZE, inflow.size());
+    }
+
+    std::vector<bool> motors;
+    if(getVehicleParam(path, "prop_inflow_motors", motors) == false){
+        motors.assign(MOTORS_MAX_AMOUNT, true);
+    }
+    setPropInflowTable(inflow, tables[0], tables[1], tables[2], motors);
+}
+
+void VtolDynamics::setPropInflowTable(const std::vector<double>& inflow,
+                                      const Eigen::MatrixXd& thrust,
+                                      const Eigen::MatrixXd& torque,
+                                      const Eigen::MatrixXd& rpm,
+                                      const std::vector<bool>& motors){
+    const size_t inflowAmount = inflow.size();
+    if(inflowAmount < 2 || motors.size() > MOTORS_MAX_AMOUNT){
+        throw std::invalid_argument("Wrong prop inflow table size");
+    }
+    for(size_t idx = 1; idx < inflowAmount; idx++){
+        if(inflow[idx] <= inflow[idx - 1]){
+            throw std::invalid_argument("Prop inflow table should be strictly increasing");
+        }
+    }
+    const std::array<const Eigen::MatrixXd*, PropInflowCells::OUTPUTS_AMOUNT> tables{&thrust, &torque, &rpm};
+    for(auto table : tables){
+        if(table->rows() != PROP_TABLE_SIZE || static_cast<size_t>(table->cols()) != inflowAmount){
+            throw std::invalid_argument("Wrong prop inflow table size");
+        }
+    }
+
+    auto& propInflow = _tables.propInflow;
+    propInflow.inflow = inflow;
+    propInflow.motors.fill(false);
+    std::copy(motors.begin(), motors.end(), propInflow.motors.begin());
+    propInflow.cells.resize(PropSegments::AMOUNT * (inflowAmount - 1));
+    for(size_t cmd_idx = 0; cmd_idx < PropSegments::AMOUNT; cmd_idx++){
+        const double commandStep = _tables.prop(cmd_idx + 1, PROP_CONTROL_IDX) -
+                                   _tables.prop(cmd_idx, PROP_CONTROL_IDX);
+        for(size_t inflow_idx = 0; inflow_idx < inflowAmount - 1; inflow_idx++){
+            const double inflowStep = inflow[inflow_idx + 1] - inflow[inflow_idx];
+            auto& cell = propInflow.cells[cmd_idx * (inflowAmount - 1) + inflow_idx];
+            for(size_t out_idx = 0; out_idx < PropInflowCells::OUTPUTS_AMOUNT; out_idx++){
+                const auto& table = *tables[out_idx];
+                const double f00 = table(cmd_idx, inflow_idx);
+                const double f10 = table(cmd_idx + 1, inflow_idx);
+                const double f01 = table(cmd_idx, inflow_idx + 1);
+                const double f11 = table(cmd_idx + 1, inflow_idx + 1);
+                cell.value[out_idx] = f00;
+                cell.commandSlope[out_idx] = (f10 - f00) / commandStep;
+                cell.inflowSlope[out_idx] = (f01 - f00) / inflowStep;
+                cell.crossSlope[out_idx] = (f11 - f10 - f01 + f00) / (commandStep * inflowStep);
+            }
+        }
+    }
+    propInflow.isEnabled = true;
 }
 
 void VtolDynamics::loadParams(const std::string& path){
-    if(!ros::param::get(path + "mass", _params.mass) ||
-        !ros::param::get(path + "wingArea", _params.wingArea) ||
-        !ros::param::get(path + "characteristicLength", _params.characteristicLength) ||
+    if(!getVehicleParam(path, "mass", _params.mass) ||
+        !getVehicleParam(path, "wingArea", _params.wingArea) ||
+        !getVehicleParam(path, "characteristicLength", _params.characteristicLength) ||
 
-        !ros::param::get(path + "motorMaxSpeed", _params.motorMaxSpeed) ||
-        !ros::param::get(path + "servoRange", _params.servoRange) ||
+        !getVehicleParam(path, "motorMaxSpeed", _params.motorMaxSpeed) ||
+        !getVehicleParam(path, "servoRange", _params.servoRange) ||
 
-        !ros::param::get(path + "accVariance", _params.accVariance) ||
-        !ros::param::get(path + "gyroVariance", _params.gyroVariance)) {
+        !getVehicleParam(path, "accVariance", _params.accVariance) ||
+        !getVehicleParam(path, "gyroVariance", _params.gyroVariance)) {
         // error
     }
 
     loadMotorsGeometry(path);
+    loadGroundContact(path);
+    std::vector<double> actuatorRateLimits;
+    std::vector<double> actuatorDeadbands;
+    getVehicleParam(path, "actuatorRateLimits", actuatorRateLimits);
+    getVehicleParam(path, "actuatorDeadbands", actuatorDeadbands);
+    setActuatorsLimits(actuatorRateLimits, actuatorDeadbands);
 
     _params.inertia = getTableNew<3, 3, Eigen::RowMajor>(path, "inertia");
+    updateDerivedConstants();
+}
+
+void VtolDynamics::updateDerivedConstants(){
+    auto& derived = _params.derived;
+    derived.inertiaInv = _params.inertia.inverse();
+    derived.accStdDev = sqrt(_params.accVariance);
+    derived.gyroStdDev = sqrt(_params.gyroVariance);
+    derived.windStdDev = sqrt(_environment.windVariance);
+    derived.aeroForceFactor = 0.5 * _environment.atmoRho * _params.wingArea;
+    derived.aeroMomentFactor = derived.aeroForceFactor * _params.characteristicLength;
+    derived.actuatorsDtSecs = -1.0;
+    _aeroMemo.isValid = false;
+}
+
+void VtolDynamics::updateActuatorsGain(double dtSecs){
+    auto& derived = _params.derived;
+    assert(_tables.actuatorTimeConstants.size() <= derived.actuatorsGain.size());
+    for(size_t idx = 0; idx < _tables.actuatorTimeConstants.size(); idx++){
+        assert(_tables.actuatorTimeConstants[idx] > 0.001);
+        derived.actuatorsGain[idx] = 1 - std::exp(-dtSecs / _tables.actuatorTimeConstants[idx]);
+        const double rateLimit = _params.actuatorRateLimits[idx];
+        derived.actuatorsMaxDelta[idx] = rateLimit > 0 ? rateLimit * dtSecs : std::numeric_limits<double>::max();
+    }
+    derived.actuatorsDtSecs = dtSecs;
 }
 
 void VtolDynamics::loadMotorsGeometry(const std::string& path) {
@@ -116,28 +481,27 @@ void VtolDynamics::loadMotorsGeometry(const std::string& path) {
     std::vector<bool> motorDirectionCCW;
     std::vector<double> motorAxisX;
     std::vector<double> motorAxisZ;
-    ros::param::get(path + "motorPositionX", motorPositionX);
-    ros::param::get(path + "motorPositionY", motorPositionY);
-    ros::param::get(path + "motorPositionZ", motorPositionZ);
-    ros::param::get(path + "motorDirectionCCW", motorDirectionCCW);
-    ros::param::get(path + "motorAxisX", motorAxisX);
-    ros::param::get(path + "motorAxisZ", motorAxisZ);
-    ros::param::get(path + "actuatorTimeConstants", _tables.actuatorTimeConstants);
+    getVehicleParam(path, "motorPositionX", motorPositionX);
+    getVehicleParam(path, "motorPositionY", motorPositionY);
+    getVehicleParam(path, "motorPositionZ", motorPositionZ);
+    getVehicleParam(path, "motorDirectionCCW", motorDirectionCCW);
+    getVehicleParam(path, "motorAxisX", motorAxisX);
+    getVehicleParam(path, "motorAxisZ", motorAxisZ);
+    getVehicleParam(path, "actuatorTimeConstants", _tables.actuatorTimeConstants);
 
     size_t motors_amount = motorPositionX.size();
-    assert(motors_amount >= MOTORS_MIN_AMOUNT && motors_amount <= MOTORS_MAX_AMOUNT);
+    if(motors_amount < MOTORS_MIN_AMOUNT || motors_amount > MOTORS_MAX_AMOUNT ||
+            motorPositionY.size() != motors_amount ||
+            motorPositionZ.size() != motors_amount ||
+            motorDirectionCCW.size() != motors_amount ||
+            motorAxisX.size() != motors_amount ||
+            motorAxisZ.size() != motors_amount ||
+            _tables.actuatorTimeConstants.size() != motors_amount + SERVOS_AMOUNT){
+        throw std::invalid_argument("Wrong motors geometry or actuators time constants size");
+    }
     _motorsSpeed.resize(motors_amount, 0.0);
-    _state.prevActuators.resize(motors_amount);
-    _state.crntActuators.resize(motors_amount);
-
-
-    assert(motorPositionX.size() == motors_amount);
-    assert(motorPositionY.size() == motors_amount);
-    assert(motorPositionZ.size() == motors_amount);
-    assert(motorDirectionCCW.size() == motors_amount);
-    assert(motorAxisX.size() == motors_amount);
-    assert(motorAxisZ.size() == motors_amount);
-    assert(_tables.actuatorTimeConstants.size() == motors_amount + SERVOS_AMOUNT);
+    _state.prevActuators.resize(motors_amount + SERVOS_AMOUNT, 0.0);
+    _state.crntActuators.resize(motors_amount + SERVOS_AMOUNT, 0.0);
 
     for (size_t motor_idx = 0; motor_idx < motors_amount; motor_idx++) {
         Geometry geometry;
@@ -146,19 +510,68 @@ void VtolDynamics::loadMotorsGeometry(const std::string& path) {
         geometry.directionCCW = motorDirectionCCW[motor_idx];
         _params.geometry.push_back(geometry);
     }
+
+    // The common layouts get unrolled motor loops, the others use the runtime-sized ones
+    switch(motors_amount){
+        case 5:
+            _motorsForcesAndMoments = &VtolDynamics::calculateMotorsForcesAndMomentsN<5>;
+            break;
+        case 8:
+            _motorsForcesAndMoments = &VtolDynamics::calculateMotorsForcesAndMomentsN<8>;
+            break;
+        case 9:
+            _motorsForcesAndMoments = &VtolDynamics::calculateMotorsForcesAndMomentsN<9>;
+            break;
+        default:
+            _motorsForcesAndMoments = &VtolDynamics::calculateMotorsForcesAndMomentsN<0>;
+            break;
+    }
+}
+
+/**
+ * @brief The ground contact is optional, it is enabled only if gearPositionX is present
+ */
+void VtolDynamics::loadGroundContact(const std::string& path){
+    GroundContact contact;
+    std::vector<double> gearPositionX;
+    std::vector<double> gearPositionY;
+    std::vector<double> gearPositionZ;
+    if(getVehicleParam(path, "gearPositionX", gearPositionX) == false){
+        setGroundContact(contact);
+        return;
+    }
+    if(!getVehicleParam(path, "gearPositionY", gearPositionY) ||
+            !getVehicleParam(path, "gearPositionZ", gearPositionZ) ||
+            !getVehicleParam(path, "gearStiffness", contact.stiffness) ||
+            !getVehicleParam(path, "gearDamping", contact.damping) ||
+            !getVehicleParam(path, "gearFriction", contact.friction) ||
+            gearPositionX.size() > GroundContact::GEARS_MAX_AMOUNT ||
+            gearPositionY.size() != gearPositionX.size() ||
+            gearPositionZ.size() != gearPositionX.size()){
+        throw std::invalid_argument("Wrong ground contact parameters");
+    }
+
+    contact.isEnabled = true;
+    contact.gearsAmount = gearPositionX.size();
+    for(size_t idx = 0; idx < contact.gearsAmount; idx++){
+        contact.positions[idx] << gearPositionX[idx], gearPositionY[idx], gearPositionZ[idx];
+    }
+    setGroundContact(contact);
 }
 
 void VtolDynamics::setInitialPosition(const Eigen::Vector3d & position,
                                              const Eigen::Quaterniond& attitudeXYZW){
     _state.position = position;
-    _state.attitude = attitudeXYZW;
+    _state.attitude = attitudeXYZW.normalized();
     _state.initialPose = position;
-    _state.initialAttitude = attitudeXYZW;
+    _state.initialAttitude = _state.attitude;
+    _aeroMultiRate.samplesAmount = 0;
 }
 void VtolDynamics::setInitialVelocity(const Eigen::Vector3d & linearVelocity,
                                          const Eigen::Vector3d& angularVelocity){
     _state.linearVelNed = linearVelocity;
     _state.angularVel = angularVelocity;
+    _aeroMultiRate.samplesAmount = 0;
 }
 
 void VtolDynamics::land(){
@@ -176,6 +589,148 @@ void VtolDynamics::land(){
     std::fill(std::begin(_state.motorsRpm), std::end(_state.motorsRpm), 0.0);
 }
 
+void VtolDynamics::proceedGround(const Eigen::Vector3d& Fspecific, double dtSecs){
+    if(!_params.groundContact.isEnabled){
+        if(_state.position[2] >= 0){
+            land();
+        }else{
+            _state.forces.specific = Fspecific;
+        }
+        return;
+    }
+
+    // Runge-Kutta position already averages the velocity over the step, so a constant reaction
+    // force moves it only by half of the velocity change, while the Euler methods use the end one
+    bool isRungeKutta = _integrationMethod == IntegrationMethod::RK4 ||
+                        _integrationMethod == IntegrationMethod::RK45;
+    Eigen::Vector3d Fground = applyGroundContact(dtSecs, isRungeKutta ? 0.5 : 1.0);
+    _state.forces.specific = Fspecific + calculateRotationMatrix() * Fground / _params.mass;
+}
+
+/**
+ * @brief Row of the contact jacobian: velocity of the body point along the NED direction
+ * with respect to the generalized velocity (linear NED velocity, FRD angular velocity)
+ */
+static Eigen::Matrix<double, 1, 6> calculateContactJacobian(const Eigen::Matrix3d& bodyToNed,
+                                                            const Eigen::Vector3d& point,
+                                                            const Eigen::Vector3d& direction){
+    Eigen::Matrix<double, 1, 6> jacobian;
+    jacobian.head<3>() = direction.transpose();
+    jacobian.tail<3>() = point.cross(bodyToNed.transpose() * direction).transpose();
+    return jacobian;
+}
+
+/**
+ * @brief Backward Euler of the gear springs and dampers: the normal force of each gear is
+ * f = k * (d + dt * v+) + c * v+, where d is the penetration and v+ is the penetration rate after
+ * the step. It is linear in the impulses, so the system is solved directly, and the gears that
+ * would pull the vehicle to the ground are removed. Friction impulses are limited by the Coulomb
+ * cone and by the impulse that stops the gear, so they never reverse the sliding.
+ * The velocity change is also applied to the position and the attitude of this step.
+ */
+Eigen::Vector3d VtolDynamics::applyGroundContact(double dtSecs, double positionGain){
+    constexpr size_t GEARS_MAX = GroundContact::GEARS_MAX_AMOUNT;
+    using Jacobian = Eigen::Matrix<double, Eigen::Dynamic, 6, Eigen::RowMajor, GEARS_MAX, 6>;
+    using Impulses = Eigen::Matrix<double, Eigen::Dynamic, 1, 0, GEARS_MAX, 1>;
+    using System = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, GEARS_MAX, GEARS_MAX>;
+
+    const auto& contact = _params.groundContact;
+    const Eigen::Matrix3d bodyToNed = _state.attitude.toRotationMatrix();
+    const Eigen::Vector3d down(0, 0, 1);
+
+    std::array<size_t, GEARS_MAX> gears;
+    size_t gearsAmount = 0;
+    for(size_t idx = 0; idx < contact.gearsAmount; idx++){
+        if(_state.position[2] + (bodyToNed * contact.positions[idx])[2] > 0){
+            gears[gearsAmount++] = idx;
+        }
+    }
+    if(gearsAmount == 0){
+        return Eigen::Vector3d::Zero();
+    }
+
+    Eigen::Matrix<double, 6, 1> velocity;
+    velocity << _state.linearVelNed, _state.angularVel;
+    const double massInv = 1.0 / _params.mass;
+    const Eigen::Matrix3d& inertiaInv = _params.derived.inertiaInv;
+    auto applyImpulse = [&](const Eigen::Matrix<double, 1, 6>& jacobian, double impulse){
+        velocity.head<3>() -= massInv * jacobian.head<3>().transpose() * impulse;
+        velocity.tail<3>() -= inertiaInv * jacobian.tail<3>().transpose() * impulse;
+    };
+    auto effectiveMassInv = [&](const Eigen::Matrix<double, 1, 6>& jacobian){
+        return massInv * jacobian.head<3>().squaredNorm() +
+               jacobian.tail<3>().dot(inertiaInv * jacobian.tail<3>().transpose());
+    };
+
+    // 1. Normal impulses
+    const double rateGain = dtSecs * (contact.damping + contact.stiffness * dtSecs);
+    Impulses impulses;
+    Jacobian normal;
+    for(size_t iteration = 0; iteration < contact.gearsAmount && gearsAmount > 0; iteration++){
+        normal.resize(gearsAmount, 6);
+        Impulses rhs(gearsAmount);
+        for(size_t row = 0; row < gearsAmount; row++){
+            const Eigen::Vector3d& point = contact.positions[gears[row]];
+            const double penetration = _state.position[2] + (bodyToNed * point)[2];
+            normal.row(row) = calculateContactJacobian(bodyToNed, point, down);
+            rhs[row] = dtSecs * contact.stiffness * penetration + rateGain * normal.row(row).dot(velocity);
+        }
+
+        System system = System::Identity(gearsAmount, gearsAmount);
+        for(size_t row = 0; row < gearsAmount; row++){
+            for(size_t col = 0; col < gearsAmount; col++){
+                const auto& a = normal.row(row);
+                const auto& b = normal.row(col);
+                system(row, col) += rateGain * (massInv * a.head<3>().dot(b.head<3>()) +
+                                                a.tail<3>().dot(inertiaInv * b.tail<3>().transpose()));
+            }
+        }
+        impulses = system.partialPivLu().solve(rhs);
+
+        size_t kept = 0;
+        for(size_t row = 0; row < gearsAmount; row++){
+            if(impulses[row] > 0){
+                gears[kept++] = gears[row];
+            }
+        }
+        if(kept == gearsAmount){
+            break;
+        }
+        gearsAmount = kept;
+    }
+    if(gearsAmount == 0){
+        return Eigen::Vector3d::Zero();
+    }
+
+    const Eigen::Matrix<double, 6, 1> initialVelocity = velocity;
+    for(size_t row = 0; row < gearsAmount; row++){
+        applyImpulse(normal.row(row), impulses[row]);
+    }
+
+    // 2. Friction impulses
+    for(size_t row = 0; row < gearsAmount; row++){
+        const Eigen::Vector3d& point = contact.positions[gears[row]];
+        Eigen::Vector3d pointVelocity = velocity.head<3>() + bodyToNed * velocity.tail<3>().cross(point);
+        pointVelocity[2] = 0;
+        const double slidingSpeed = pointVelocity.norm();
+        if(slidingSpeed < 1e-9){
+            continue;
+        }
+        auto jacobian = calculateContactJacobian(bodyToNed, point, pointVelocity / slidingSpeed);
+        double impulse = std::min(contact.friction * impulses[row], slidingSpeed / effectiveMassInv(jacobian));
+        applyImpulse(jacobian, impulse);
+    }
+
+    // 3. Velocity change is applied to the step
+    const Eigen::Matrix<double, 6, 1> velocityDelta = velocity - initialVelocity;
+    _state.linearVelNed = velocity.head<3>();
+    _state.angularVel = velocity.tail<3>();
+    _state.position += velocityDelta.head<3>() * positionGain * dtSecs;
+    _state.attitude = Math::integrateAttitude(_state.attitude, velocityDelta.tail<3>(), positionGain * dtSecs);
+
+    return velocityDelta.head<3>() * _params.mass / dtSecs;
+}
+
 int8_t VtolDynamics::calibrate(SimMode_t calType){
     constexpr double MAG_ROTATION_SPEED = 2 * 3.1415 / 10;
     static SimMode_t prevCalibrationType = SimMode_t::NORMAL;
@@ -279,36 +834,31 @@ int8_t VtolDynamics::calibrate(SimMode_t calType){
             break;
     }
 
-    auto modeInteger = static_cast<int>(calType);
-    if(prevCalibrationType != calType){
-        ROS_WARN_STREAM_THROTTLE(1, "init cal " << modeInteger);
-        prevCalibrationType = calType;
-    }else{
-        ROS_WARN_STREAM_THROTTLE(1, "cal " << modeInteger);
-    }
+    prevCalibrationType = calType;
+    _diagnostics.record(DiagnosticEvent::CALIBRATION, static_cast<int>(calType));
 
     constexpr double DELTA_TIME = 0.001;
 
     _state.forces.specific = calculateNormalForceWithoutMass();
-    Eigen::Quaterniond quaternion(0, _state.angularVel(0), _state.angularVel(1), _state.angularVel(2));
-    Eigen::Quaterniond attitudeDelta = _state.attitude * quaternion;
-    _state.attitude.coeffs() += attitudeDelta.coeffs() * 0.5 * DELTA_TIME;
-    _state.attitude.normalize();
+    _state.attitude = Math::integrateAttitude(_state.attitude, _state.angularVel, DELTA_TIME);
     return 1;
 }
 
 void VtolDynamics::process(double dt_secs, const std::vector<double>& unitless_setpoint){
+    if(auto staged = _stagedVehicle.take()){
+        applyStagedVehicle(*staged);
+    }
+    if(_faults.update(dt_secs)){
+        applyFaults(_faults.getEffects());
+    }
     _mapUnitlessSetpointToInternal(unitless_setpoint);
+    if(_faults.isActive()){
+        injectServoFaults();
+    }
     updateActuators(dt_secs);
 
-    Eigen::Vector3d windNed = calculateWind();
-    Eigen::Matrix3d rotationMatrix = calculateRotationMatrix();
-    _state.airspeedFrd = calculateAirSpeed(rotationMatrix, _state.linearVelNed, windNed);
-    double AoA = calculateAnglesOfAtack(_state.airspeedFrd);
-    double AoS = calculateAnglesOfSideslip(_state.airspeedFrd);
-    calculateAerodynamics(_state.airspeedFrd, AoA, AoS, _servosValues,
-                          _state.forces.aero, _state.moments.aero);
-    calculateNewState(_state.moments.aero, _state.forces.aero, _motorsSpeed, dt_secs);
+    Eigen::Vector3d windNed = calculateWind(dt_secs);
+    proceedState(windNed, _motorsSpeed, _servosValues, dt_secs);
 }
 
 
@@ -325,58 +875,190 @@ void VtolDynamics::process(double dt_secs, const std::vector<double>& unitless_s
  * N-1          Rudders     [-1.0, +1.0]    ->  [-MAX_RANGE, +MAX_RANGE]
  */
 void VtolDynamics::_mapUnitlessSetpointToInternal(const std::vector<double>& cmd) {
-    std::vector<double> input_cmd = cmd;
-    if (input_cmd.size() < _motorsSpeed.size()) {
-        input_cmd.resize(_motorsSpeed.size());
+    mapUnitlessSetpoint(cmd, _motorsSpeed, _servosValues);
+}
+void VtolDynamics::mapUnitlessSetpoint(const std::vector<double>& cmd,
+                                       std::vector<double>& motors,
+                                       std::array<double, 3>& servos) const{
+    auto getCmd = [&cmd](size_t idx) { return idx < cmd.size() ? cmd[idx] : 0.0; };
+
+    for (size_t motor_idx = 0; motor_idx < motors.size(); motor_idx++) {
+        motors[motor_idx] = getCmd(motor_idx);
+        motors[motor_idx] = boost::algorithm::clamp(motors[motor_idx], 0.0, +1.0);
+        motors[motor_idx] *= _params.motorMaxSpeed[motor_idx];
+    }
+
+    for(size_t servo_idx = 0; servo_idx < SERVOS_AMOUNT; servo_idx++){
+        size_t idx = servo_idx + motors.size();
+        servos[servo_idx] = getCmd(idx);
+        servos[servo_idx] = boost::algorithm::clamp(servos[servo_idx], -1.0, +1.0);
+        servos[servo_idx] *= _params.servoRange[servo_idx];
     }
+    servos[ELEVATORS_INDEX] *= -1;  // elevator is inverted
+}
 
-    for (size_t motor_idx = 0; motor_idx < _motorsSpeed.size(); motor_idx++) {
-        _motorsSpeed[motor_idx] = input_cmd[motor_idx];
-        _motorsSpeed[motor_idx] = boost::algorithm::clamp(_motorsSpeed[motor_idx], 0.0, +1.0);
-        _motorsSpeed[motor_idx] *= _params.motorMaxSpeed[motor_idx];
+void VtolDynamics::setFaults(const std::vector<Fault>& faults){
+    static_assert(MOTORS_MAX_AMOUNT <= FaultEffects::MOTORS_MAX_AMOUNT);
+    static_assert(SERVOS_AMOUNT <= FaultEffects::SERVOS_MAX_AMOUNT);
+    if(_faultNominal.isSaved){
+        applyFaults(FaultEffects());
     }
+    saveFaultNominalParams();
+    _faults.setSchedule(faults);
+}
 
-    for(size_t servo_idx = 0; servo_idx < SERVOS_AMOUNT; servo_idx++){
-        size_t idx = servo_idx + _motorsSpeed.size();
-        _servosValues[servo_idx] = input_cmd[idx];
-        _servosValues[servo_idx] = boost::algorithm::clamp(_servosValues[servo_idx], -1.0, +1.0);
-        _servosValues[servo_idx] *= _params.servoRange[servo_idx];
+void VtolDynamics::saveFaultNominalParams(){
+    _faultNominal.mass = _params.mass;
+    _faultNominal.motorMaxSpeed = _params.motorMaxSpeed;
+    _faultNominal.motorsPosition.resize(_params.geometry.size());
+    for(size_t idx = 0; idx < _params.geometry.size(); idx++){
+        _faultNominal.motorsPosition[idx] = _params.geometry[idx].position;
     }
-    _servosValues[ELEVATORS_INDEX] *= -1;  // elevator is inverted
+    _faultNominal.isSaved = true;
+    _faults.setNominalMass(_params.mass);
 }
 
-void VtolDynamics::updateActuators(double dtSecs){
-    assert(_motorsSpeed.size() == _state.prevActuators.size());
-    assert(_motorsSpeed.size() == _state.crntActuators.size());
-    assert(_motorsSpeed.size() + 3 == _tables.actuatorTimeConstants.size());
+const FaultInjector& VtolDynamics::getFaults() const{
+    return _faults;
+}
 
-    for(size_t idx = 0; idx < _motorsSpeed.size(); idx++){
-        _state.prevActuators[idx] = _state.crntActuators[idx];
-        auto cmd_delta = _state.prevActuators[idx] - _motorsSpeed[idx];
-        assert(_tables.actuatorTimeConstants[idx] > 0.001);
-        _motorsSpeed[idx] += cmd_delta * (1 - pow(2.71, -dtSecs/_tables.actuatorTimeConstants[idx]));
-        _state.crntActuators[idx] = _motorsSpeed[idx];
+/**
+ * @brief The moments are taken about the shifted CG, so the motors arms are shifted here and
+ * the aerodynamic moment is transferred in calculateAeroForces()
+ */
+void VtolDynamics::applyFaults(const FaultEffects& effects){
+    const auto& nominal = _faultNominal;
+    _params.mass = nominal.mass + effects.addedMass;
+    for(size_t idx = 0; idx < nominal.motorMaxSpeed.size(); idx++){
+        _params.motorMaxSpeed[idx] = nominal.motorMaxSpeed[idx] * effects.motorSpeedFactor[idx];
     }
+    for(size_t idx = 0; idx < nominal.motorsPosition.size(); idx++){
+        _params.geometry[idx].position = nominal.motorsPosition[idx] - effects.cgOffset;
+    }
+}
 
-    assert(_state.crntActuators.size() == _state.prevActuators.size());
+/**
+ * @brief A stuck servo is commanded to its current position, a floating one to zero,
+ * the actuators lag is kept
+ */
+void VtolDynamics::injectServoFaults(){
+    const auto& servos = _faults.getEffects().servos;
+    const size_t motorsAmount = _motorsSpeed.size();
+    for(size_t idx = 0; idx < SERVOS_AMOUNT; idx++){
+        if(servos[idx] == ServoFault::STUCK){
+            _servosValues[idx] = _state.crntActuators[motorsAmount + idx];
+        }else if(servos[idx] == ServoFault::FLOATING){
+            _servosValues[idx] = 0.0;
+        }
+    }
 }
 
-Eigen::Vector3d VtolDynamics::calculateWind(){
-    Eigen::Vector3d wind;
-    wind[0] = sqrt(_environment.windVariance) * _distribution(_generator) + _environment.windNED[0];
-    wind[1] = sqrt(_environment.windVariance) * _distribution(_generator) + _environment.windNED[1];
-    wind[2] = sqrt(_environment.windVariance) * _distribution(_generator) + _environment.windNED[2];
+/**
+ * @brief One pass over all motors and servos: a discrete first order lag with the gain
+ * precomputed for the current dt, the optional deadband and rate limit.
+ * The deadband holds the output while the command stays close to it.
+ */
+void VtolDynamics::updateActuators(double dtSecs){
+    const size_t motorsAmount = _motorsSpeed.size();
+    const size_t channelsAmount = motorsAmount + SERVOS_AMOUNT;
+    assert(channelsAmount == _state.prevActuators.size());
+    assert(channelsAmount == _state.crntActuators.size());
+    assert(channelsAmount == _tables.actuatorTimeConstants.size());
+
+    if(dtSecs != _params.derived.actuatorsDtSecs){
+        updateActuatorsGain(dtSecs);
+    }
+    const auto& derived = _params.derived;
+    const auto& deadbands = _params.actuatorDeadbands;
+
+    std::array<double, ACTUATORS_CHANNELS_MAX_AMOUNT> cmd;
+    std::copy(_motorsSpeed.begin(), _motorsSpeed.end(), cmd.begin());
+    std::copy(_servosValues.begin(), _servosValues.end(), cmd.begin() + motorsAmount);
+
+    std::swap(_state.prevActuators, _state.crntActuators);
+    const auto& prev = _state.prevActuators;
+    auto& crnt = _state.crntActuators;
+    for(size_t idx = 0; idx < channelsAmount; idx++){
+        double delta = cmd[idx] - prev[idx];
+        delta *= static_cast<double>(std::abs(delta) > deadbands[idx]);
+        delta = boost::algorithm::clamp(delta * derived.actuatorsGain[idx],
+                                        -derived.actuatorsMaxDelta[idx], derived.actuatorsMaxDelta[idx]);
+        crnt[idx] = prev[idx] + delta;
+    }
+
+    std::copy(crnt.begin(), crnt.begin() + motorsAmount, _motorsSpeed.begin());
+    std::copy(crnt.begin() + motorsAmount, crnt.end(), _servosValues.begin());
+}
 
-    /**
-     * @note Implement own gust logic
-     * innopolis_vtol_indi logic doesn't suit us
-     */
-    Eigen::Vector3d gust;
-    gust.setZero();
+Eigen::Vector3d VtolDynamics::calculateWind(double dtSecs){
+    Eigen::Vector3d wind;
+    const double windStdDev = _params.derived.windStdDev;
+    wind[0] = windStdDev * _distribution(_generator) + _environment.windNED[0];
+    wind[1] = windStdDev * _distribution(_generator) + _environment.windNED[1];
+    wind[2] = windStdDev * _distribution(_generator) + _environment.windNED[2];
+
+    Eigen::Vector3d gust = _environment.gustVelocityNED;
+    if(_environment.gustVariance > 0 && dtSecs > 0){
+        updateTurbulenceCoefficients(dtSecs);
+        auto& turbulence = _turbulence;
+        for(size_t axis = 0; axis < 3; axis++){
+            turbulence.velocityFrd[axis] = turbulence.a[axis] * turbulence.velocityFrd[axis] +
+                                           turbulence.b[axis] * turbulence.distribution(turbulence.generator);
+        }
+        gust += _state.attitude * turbulence.velocityFrd;
+    }
 
     return wind + gust;
 }
 
+/**
+ * @brief Low altitude MIL-F-8785C length scales and intensities up to 1000 ft,
+ * above it the turbulence is isotropic with 1750 ft length scale.
+ * The airspeed is clamped to the same range as in calculateAerodynamics().
+ */
+void VtolDynamics::updateTurbulenceCoefficients(double dtSecs){
+    constexpr double FEET_TO_METERS = 0.3048;
+    constexpr double LOW_ALTITUDE_MAX_FT = 1000.0;
+    constexpr double HIGH_ALTITUDE_LENGTH_FT = 1750.0;
+    constexpr double ALTITUDE_MIN_FT = 10.0;
+
+    auto& turbulence = _turbulence;
+    const double airspeed = boost::algorithm::clamp(_state.airspeedFrd.norm(), 5, 40);
+    const double altitude = std::max(-_state.position[2], 0.0);
+    const auto airspeedBand = static_cast<int64_t>(airspeed / DrydenTurbulence::AIRSPEED_BAND);
+    const auto altitudeBand = static_cast<int64_t>(altitude / DrydenTurbulence::ALTITUDE_BAND);
+    if(dtSecs == turbulence.dtSecs && airspeedBand == turbulence.airspeedBand &&
+            altitudeBand == turbulence.altitudeBand){
+        return;
+    }
+
+    // Coefficients are evaluated in the middle of the band
+    const double bandAirspeed = (airspeedBand + 0.5) * DrydenTurbulence::AIRSPEED_BAND;
+    const double bandAltitudeFt = (altitudeBand + 0.5) * DrydenTurbulence::ALTITUDE_BAND / FEET_TO_METERS;
+    const double altitudeFt = boost::algorithm::clamp(bandAltitudeFt, ALTITUDE_MIN_FT, LOW_ALTITUDE_MAX_FT);
+    const double sigmaW = sqrt(_environment.gustVariance);
+    Eigen::Vector3d lengthScale;
+    Eigen::Vector3d sigma;
+    if(bandAltitudeFt < LOW_ALTITUDE_MAX_FT){
+        const double factor = 0.177 + 0.000823 * altitudeFt;
+        const double horizontalLength = altitudeFt / pow(factor, 1.2) * FEET_TO_METERS;
+        const double horizontalSigma = sigmaW / pow(factor, 0.4);
+        lengthScale << horizontalLength, horizontalLength, altitudeFt * FEET_TO_METERS;
+        sigma << horizontalSigma, horizontalSigma, sigmaW;
+    }else{
+        lengthScale.setConstant(HIGH_ALTITUDE_LENGTH_FT * FEET_TO_METERS);
+        sigma.setConstant(sigmaW);
+    }
+
+    for(size_t axis = 0; axis < 3; axis++){
+        turbulence.a[axis] = std::exp(-bandAirspeed * dtSecs / lengthScale[axis]);
+        turbulence.b[axis] = sigma[axis] * sqrt(1.0 - turbulence.a[axis] * turbulence.a[axis]);
+    }
+    turbulence.dtSecs = dtSecs;
+    turbulence.airspeedBand = airspeedBand;
+    turbulence.altitudeBand = altitudeBand;
+}
+
 Eigen::Matrix3d VtolDynamics::calculateRotationMatrix() const{
     return _state.attitude.toRotationMatrix().transpose();
 }
@@ -386,10 +1068,10 @@ Eigen::Vector3d VtolDynamics::calculateAirSpeed(const Eigen::Matrix3d& rotationM
                                                        const Eigen::Vector3d& windSpeedNED) const{
     Eigen::Vector3d airspeedFrd = rotationMatrix * (velocityNED + windSpeedNED);
     if(abs(airspeedFrd[0]) > 40 || abs(airspeedFrd[1]) > 40 || abs(airspeedFrd[2]) > 40){
+        _diagnostics.record(DiagnosticEvent::AIRSPEED_LIMIT, airspeedFrd.cwiseAbs().maxCoeff());
         airspeedFrd[0] = boost::algorithm::clamp(airspeedFrd[0], -40, +40);
         airspeedFrd[1] = boost::algorithm::clamp(airspeedFrd[1], -40, +40);
         airspeedFrd[2] = boost::algorithm::clamp(airspeedFrd[2], -40, +40);
-        std::cout << "Warning: airspeed is out of limit." << std::endl;
     }
 
     return airspeedFrd;
@@ -405,24 +1087,11 @@ double VtolDynamics::calculateDynamicPressure(double airspeed_mod) const{
  * it must be [0, -3.14] if angle is [0, -180]
  */
 double VtolDynamics::calculateAnglesOfAtack(const Eigen::Vector3d& airspeed_frd) const{
-    double A = sqrt(airspeed_frd[0] * airspeed_frd[0] + airspeed_frd[2] * airspeed_frd[2]);
-    if(A < 0.001){
-        return 0;
-    }
-    A = airspeed_frd[2] / A;
-    A = boost::algorithm::clamp(A, -1.0, +1.0);
-    A = (airspeed_frd[0] > 0) ? asin(A) : 3.1415 - asin(A);
-    return (A > 3.1415) ? A - 2 * 3.1415 : A;
+    return calculateAnglesOfAtackT(airspeed_frd);
 }
 
 double VtolDynamics::calculateAnglesOfSideslip(const Eigen::Vector3d& airspeed_frd) const{
-    double B = airspeed_frd.norm();
-    if(B < 0.001){
-        return 0;
-    }
-    B = airspeed_frd[1] / B;
-    B = boost::algorithm::clamp(B, -1.0, +1.0);
-    return asin(B);
+    return calculateAnglesOfSideslipT(airspeed_frd);
 }
 
 /**
@@ -438,137 +1107,593 @@ void VtolDynamics::calculateAerodynamics(const Eigen::Vector3d& airspeed,
                                          Eigen::Vector3d& Faero,
                                          Eigen::Vector3d& Maero){
     // 0. Common computation
-    double AoA_deg = boost::algorithm::clamp(AoA * 180 / 3.1415, -45.0, +45.0);
-    double AoS_deg = boost::algorithm::clamp(AoS * 180 / 3.1415, -90.0, +90.0);
-    double airspeedMod = airspeed.norm();
-    double dynamicPressure = calculateDynamicPressure(airspeedMod);
-    double airspeedModClamped = boost::algorithm::clamp(airspeed.norm(), 5, 40);
-
-    // 1. Calculate aero force
-    Eigen::VectorXd polynomialCoeffs(7);
+    double AoA_deg = AoA * 180 / 3.1415;
+    if(std::abs(AoA_deg) > 45.0){
+        _diagnostics.record(DiagnosticEvent::AOA_SATURATION, AoA_deg);
+        AoA_deg = boost::algorithm::clamp(AoA_deg, -45.0, +45.0);
+    }
+    double AoS_deg = AoS * 180 / 3.1415;
+    if(std::abs(AoS_deg) > 90.0){
+        _diagnostics.record(DiagnosticEvent::AOS_SATURATION, AoS_deg);
+        AoS_deg = boost::algorithm::clamp(AoS_deg, -90.0, +90.0);
+    }
+    double airspeedSquared = airspeed.squaredNorm();
+    double airspeedMod = sqrt(airspeedSquared);
+    if(airspeedMod > 40){
+        _diagnostics.record(DiagnosticEvent::AERO_TABLE_EXTRAPOLATION, airspeedMod);
+    }
+    double airspeedModClamped = boost::algorithm::clamp(airspeedMod, 5, 40);
+    double momentFactor = _params.derived.aeroMomentFactor * airspeedSquared;
+
+    AeroCoefficients coeffs;
+    calculateAeroCoefficients(airspeedModClamped, AoA_deg, AoS_deg, servos, coeffs);
+
     Eigen::Vector3d FL;
     Eigen::Vector3d FS;
     Eigen::Vector3d FD;
+    calculateAeroForceAndMoment(airspeed, coeffs, servos, FL, FS, FD, Faero, Maero);
+
+
+    _state.forces.lift << momentFactor * FL;
+    _state.forces.drug << momentFactor * FD;
+    _state.forces.side << momentFactor * FS;
+    _state.moments.steer << coeffs.CmxAileron * servos[AILERONS_INDEX],
+                            coeffs.CmyElevator * servos[ELEVATORS_INDEX],
+                            coeffs.CmzRudder * servos[RUDDERS_INDEX];
+    _state.moments.steer *= momentFactor;
+    _state.moments.airspeed << coeffs.Cmx, coeffs.Cmy, coeffs.Cmz;
+    _state.moments.airspeed *= momentFactor;
+}
+
+void VtolDynamics::calculateAeroCoefficients(double airspeedModClamped,
+                                             double AoA_deg,
+                                             double AoS_deg,
+                                             const std::array<double, 3>& servos,
+                                             AeroCoefficients& coeffs){
+    auto& memo = _aeroMemo;
+    if(!memo.isEnabled){
+        evaluateAeroCoefficients(airspeedModClamped, AoA_deg, AoS_deg, servos, coeffs, _cursors);
+        return;
+    }
 
-    calculateCLPolynomial(airspeedModClamped, polynomialCoeffs);
-    double CL = Math::polyval(polynomialCoeffs, AoA_deg);
-    FL = (Eigen::Vector3d(0, 1, 0).cross(airspeed.normalized())) * CL;
+    const std::array<double, AeroMemo::INPUTS_AMOUNT> inputs{airspeedModClamped, AoA_deg, AoS_deg,
+                                                             servos[0], servos[1], servos[2]};
+    std::array<int64_t, AeroMemo::INPUTS_AMOUNT> cell;
+    for(size_t idx = 0; idx < AeroMemo::INPUTS_AMOUNT; idx++){
+        cell[idx] = static_cast<int64_t>(std::floor(inputs[idx] * memo.stepsInv[idx]));
+    }
+
+    if(memo.isValid && cell == memo.cell){
+        memo.hits++;
+    }else{
+        memo.misses++;
+        evaluateAeroCoefficients(airspeedModClamped, AoA_deg, AoS_deg, servos, memo.coeffs, _cursors);
+        memo.cell = cell;
+        memo.isValid = true;
+    }
+    coeffs = memo.coeffs;
+}
 
-    calculateCSPolynomial(airspeedModClamped, polynomialCoeffs);
-    double CS = Math::polyval(polynomialCoeffs, AoA_deg);
-    double CS_rudder = calculateCSRudder(servos[RUDDERS_INDEX], airspeedModClamped);
-    double CS_beta = calculateCSBeta(AoS_deg, airspeedModClamped);
-    FS = airspeed.cross(Eigen::Vector3d(0, 1, 0).cross(airspeed.normalized())) * (CS + CS_rudder + CS_beta);
+void VtolDynamics::evaluateAeroCoefficients(double airspeedModClamped,
+                                            double AoA_deg,
+                                            double AoS_deg,
+                                            const std::array<double, 3>& servos,
+                                            AeroCoefficients& coeffs,
+                                            TableCursors& cursors) const{
+    evaluateAeroCoefficientsT(airspeedModClamped, AoA_deg, AoS_deg, servos, coeffs, cursors);
+}
 
-    calculateCDPolynomial(airspeedModClamped, polynomialCoeffs);
-    double CD = Math::polyval(polynomialCoeffs.block<5, 1>(0, 0), AoA_deg);
-    FD = (-1 * airspeed).normalized() * CD;
+/**
+ * @brief Same segment as Math::findPrevRowIdxInMonotonicSequence() gives for the prop table:
+ * commands outside of the table are linearly extrapolated by the first or the last segment.
+ * A uniform grid is resolved in O(1), otherwise the inner breakpoints below the command are
+ * counted without branches, so the loop is easily vectorized by the compiler.
+ */
+size_t PropSegments::findSegmentIdx(double actuator) const{
+    if(isUniform){
+        double position = (actuator - control[0]) * controlStepInv;
+        position = boost::algorithm::clamp(position, 0.0, AMOUNT - 1.0);
+        return static_cast<size_t>(position);
+    }
 
-    Faero = 0.5 * dynamicPressure * (FL + FS + FD);
+    size_t segment_idx = 0;
+    for(size_t idx = 1; idx < AMOUNT; idx++){
+        segment_idx += static_cast<size_t>(control[idx] < actuator);
+    }
+    return segment_idx;
+}
 
-    // 2. Calculate aero moment
-    calculateCmxPolynomial(airspeedModClamped, polynomialCoeffs);
-    auto Cmx = Math::polyval(polynomialCoeffs, AoA_deg);
+size_t PropSegments::findSegmentIdx(double actuator, size_t& cursor) const{
+    if(isUniform){
+        cursor = findSegmentIdx(actuator);
+        return cursor;
+    }
+    auto point = [this](size_t idx){ return control[idx]; };
+    return Math::huntSegmentIdx(point, AMOUNT + 1, actuator, cursor);
+}
 
-    calculateCmyPolynomial(airspeedModClamped, polynomialCoeffs);
-    auto Cmy = Math::polyval(polynomialCoeffs, AoA_deg);
+/**
+ * @param[in, out] inflowValue - it is clamped to the table range
+ */
+size_t PropInflowCells::findInflowIdx(double& inflowValue) const{
+    inflowValue = boost::algorithm::clamp(inflowValue, inflow.front(), inflow.back());
+    size_t segment_idx = 0;
+    for(size_t idx = 1; idx < inflow.size() - 1; idx++){
+        segment_idx += static_cast<size_t>(inflow[idx] < inflowValue);
+    }
+    return segment_idx;
+}
+size_t PropInflowCells::findInflowIdx(double& inflowValue, size_t& cursor) const{
+    inflowValue = boost::algorithm::clamp(inflowValue, inflow.front(), inflow.back());
+    auto point = [this](size_t idx){ return inflow[idx]; };
+    return Math::huntSegmentIdx(point, inflow.size(), inflowValue, cursor);
+}
 
-    calculateCmzPolynomial(airspeedModClamped, polynomialCoeffs);
-    auto Cmz = -Math::polyval(polynomialCoeffs, AoA_deg);
+void VtolDynamics::thruster(double actuator,
+                            double& thrust, double& torque, double& rpm) const{
+    thrusterT(actuator, thrust, torque, rpm);
+}
 
-    double Cmx_aileron = calculateCmxAileron(servos[AILERONS_INDEX], airspeedModClamped);
-    /**
-     * @note InnoDynamics from octave has some mistake in elevator logic
-     * It always generate non positive moment in both positive and negative position
-     * Temporary decision is to create positive moment in positive position and
-     * negative moment in negative position
-     */
-    double Cmy_elevator = calculateCmyElevator(abs(servos[ELEVATORS_INDEX]), airspeedModClamped);
-    double Cmz_rudder = calculateCmzRudder(servos[RUDDERS_INDEX], airspeedModClamped);
+void VtolDynamics::thrusters(const std::vector<double>& actuators,
+                             std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                             std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                             std::array<double, MOTORS_MAX_AMOUNT>& rpm) const{
+    TableCursors cursors;
+    thrustersN<0>(actuators, thrust, torque, rpm, cursors);
+}
 
-    auto Mx = Cmx + Cmx_aileron * servos[AILERONS_INDEX];
-    auto My = Cmy + Cmy_elevator * servos[ELEVATORS_INDEX];
-    auto Mz = Cmz + Cmz_rudder * servos[RUDDERS_INDEX];
+void VtolDynamics::thrusters(const std::vector<double>& actuators,
+                             std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                             std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                             std::array<double, MOTORS_MAX_AMOUNT>& rpm,
+                             TableCursors& cursors) const{
+    thrustersN<0>(actuators, thrust, torque, rpm, cursors);
+}
 
-    Maero = 0.5 * dynamicPressure * _params.characteristicLength * Eigen::Vector3d(Mx, My, Mz);
+template<size_t MotorsAmount>
+void VtolDynamics::thrustersN(const std::vector<double>& actuators,
+                              std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                              std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                              std::array<double, MOTORS_MAX_AMOUNT>& rpm,
+                              TableCursors& cursors) const{
+    static_assert(MotorsAmount <= MOTORS_MAX_AMOUNT);
+    assert(actuators.size() <= MOTORS_MAX_AMOUNT);
+    assert(MotorsAmount == 0 || actuators.size() == MotorsAmount);
+    const auto& segments = _tables.propSegments;
+    const size_t motorsAmount = MotorsAmount != 0 ? MotorsAmount : actuators.size();
+
+    std::array<size_t, MOTORS_MAX_AMOUNT> segmentIdx;
+    for(size_t motor_idx = 0; motor_idx < motorsAmount; motor_idx++){
+        segmentIdx[motor_idx] = segments.findSegmentIdx(actuators[motor_idx], cursors.prop[motor_idx]);
+    }
 
+    for(size_t motor_idx = 0; motor_idx < motorsAmount; motor_idx++){
+        const size_t idx = segmentIdx[motor_idx];
+        const double delta = actuators[motor_idx] - segments.control[idx];
+        thrust[motor_idx] = segments.thrust[idx] + delta * segments.thrustSlope[idx];
+        torque[motor_idx] = segments.torque[idx] + delta * segments.torqueSlope[idx];
+        rpm[motor_idx] = segments.rpm[idx] + delta * segments.rpmSlope[idx];
+    }
+}
 
-    _state.forces.lift << 0.5 * dynamicPressure * _params.characteristicLength * FL;
-    _state.forces.drug << 0.5 * dynamicPressure * _params.characteristicLength * FD;
-    _state.forces.side << 0.5 * dynamicPressure * _params.characteristicLength * FS;
-    _state.moments.steer << Cmx_aileron * servos[AILERONS_INDEX],
-                            Cmy_elevator * servos[ELEVATORS_INDEX],
-                            Cmz_rudder * servos[RUDDERS_INDEX];
-    _state.moments.steer *= 0.5 * dynamicPressure * _params.characteristicLength;
-    _state.moments.airspeed << Cmx, Cmy, Cmz;
-    _state.moments.airspeed *= 0.5 * dynamicPressure * _params.characteristicLength;
+void VtolDynamics::thrusters(const std::vector<double>& actuators,
+                             const std::array<double, MOTORS_MAX_AMOUNT>& inflow,
+                             std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                             std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                             std::array<double, MOTORS_MAX_AMOUNT>& rpm) const{
+    TableCursors cursors;
+    thrusters(actuators, inflow, thrust, torque, rpm, cursors);
 }
 
-void VtolDynamics::thruster(double actuator,
-                            double& thrust, double& torque, double& rpm) const{
-    constexpr size_t CONTROL_IDX = 0;
-    constexpr size_t THRUST_IDX = 1;
-    constexpr size_t TORQUE_IDX = 2;
-    constexpr size_t RPM_IDX = 4;
+void VtolDynamics::thrusters(const std::vector<double>& actuators,
+                             const std::array<double, MOTORS_MAX_AMOUNT>& inflow,
+                             std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                             std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                             std::array<double, MOTORS_MAX_AMOUNT>& rpm,
+                             TableCursors& cursors) const{
+    const auto& propInflow = _tables.propInflow;
+    if(!propInflow.isEnabled){
+        thrusters(actuators, thrust, torque, rpm, cursors);
+        return;
+    }
 
-    size_t prev_idx = Math::findPrevRowIdxInMonotonicSequence(_tables.prop, actuator);
-    size_t next_idx = prev_idx + 1;
-    if(next_idx < _tables.prop.rows()){
-        auto prev_row = _tables.prop.row(prev_idx);
-        auto next_row = _tables.prop.row(next_idx);
-        auto t = (actuator - prev_row(CONTROL_IDX)) / (next_row(CONTROL_IDX) - prev_row(CONTROL_IDX));
-        thrust = Math::lerp(prev_row(THRUST_IDX), next_row(THRUST_IDX), t);
-        torque = Math::lerp(prev_row(TORQUE_IDX), next_row(TORQUE_IDX), t);
-        rpm = Math::lerp(prev_row(RPM_IDX), next_row(RPM_IDX), t);
+    const auto& segments = _tables.propSegments;
+    const size_t inflowSegmentsAmount = propInflow.inflow.size() - 1;
+    for(size_t motor_idx = 0; motor_idx < actuators.size(); motor_idx++){
+        if(!propInflow.motors[motor_idx]){
+            thruster(actuators[motor_idx], thrust[motor_idx], torque[motor_idx], rpm[motor_idx]);
+            continue;
+        }
+        double inflowValue = inflow[motor_idx];
+        if(inflowValue < propInflow.inflow.front() || inflowValue > propInflow.inflow.back()){
+            _diagnostics.record(DiagnosticEvent::PROP_TABLE_EXTRAPOLATION, inflowValue);
+        }
+        const size_t inflowIdx = propInflow.findInflowIdx(inflowValue, cursors.propInflow[motor_idx]);
+        const size_t cmdIdx = segments.findSegmentIdx(actuators[motor_idx], cursors.prop[motor_idx]);
+        const auto& cell = propInflow.cells[cmdIdx * inflowSegmentsAmount + inflowIdx];
+        const double du = actuators[motor_idx] - segments.control[cmdIdx];
+        const double dv = inflowValue - propInflow.inflow[inflowIdx];
+
+        std::array<double, PropInflowCells::OUTPUTS_AMOUNT> out;
+        for(size_t out_idx = 0; out_idx < PropInflowCells::OUTPUTS_AMOUNT; out_idx++){
+            out[out_idx] = cell.value[out_idx] + du * cell.commandSlope[out_idx] +
+                           dv * (cell.inflowSlope[out_idx] + du * cell.crossSlope[out_idx]);
+        }
+        thrust[motor_idx] = out[0];
+        torque[motor_idx] = out[1];
+        rpm[motor_idx] = out[2];
     }
 }
 
-void VtolDynamics::calculateNewState(const Eigen::Vector3d& Maero,
-                                     const Eigen::Vector3d& Faero,
-                                     const std::vector<double>& motors,
-                                     double dt_sec){
+void VtolDynamics::calculateMotorsForcesAndMoments(const std::vector<double>& motors,
+                                                   Eigen::Vector3d& Fmotors,
+                                                   Eigen::Vector3d& Mmotors){
+    if(_motorsForcesAndMoments != nullptr && motors.size() == _params.geometry.size()){
+        (this->*_motorsForcesAndMoments)(motors, Fmotors, Mmotors);
+    }else{
+        calculateMotorsForcesAndMomentsN<0>(motors, Fmotors, Mmotors);
+    }
+}
+
+/**
+ * @note With the 2-D prop table the axial inflow of each motor is taken from the last calculated
+ * airspeed, it is held constant during the step like the motors commands
+ */
+template<size_t MotorsAmount>
+void VtolDynamics::calculateMotorsForcesAndMomentsN(const std::vector<double>& motors,
+                                                    Eigen::Vector3d& Fmotors,
+                                                    Eigen::Vector3d& Mmotors){
     assert(motors.size() >= MOTORS_MIN_AMOUNT && motors.size() <= _motorsSpeed.size());
-    for(size_t idx = 0; idx < motors.size(); idx++){
-        double thrust;
-        double torque;
-        thruster(motors[idx], thrust, torque, _state.motorsRpm[idx]);
-        _state.forces.motors[idx] = _params.geometry[idx].axis * thrust;
+    assert(MotorsAmount == 0 || motors.size() == MotorsAmount);
+    const size_t motorsAmount = MotorsAmount != 0 ? MotorsAmount : motors.size();
+    std::array<double, MOTORS_MAX_AMOUNT> thrusts;
+    std::array<double, MOTORS_MAX_AMOUNT> torques;
+    if(_tables.propInflow.isEnabled){
+        std::array<double, MOTORS_MAX_AMOUNT> inflow;
+        for(size_t idx = 0; idx < motorsAmount; idx++){
+            inflow[idx] = _state.airspeedFrd.dot(_params.geometry[idx].axis);
+        }
+        thrusters(motors, inflow, thrusts, torques, _state.motorsRpm, _cursors);
+    }else{
+        thrustersN<MotorsAmount>(motors, thrusts, torques, _state.motorsRpm, _cursors);
+    }
+    if(_faults.isActive()){
+        const auto& propFactor = _faults.getEffects().propFactor;
+        for(size_t idx = 0; idx < motorsAmount; idx++){
+            thrusts[idx] *= propFactor[idx];
+            torques[idx] *= propFactor[idx];
+        }
+    }
+
+    Fmotors.setZero();
+    Mmotors.setZero();
+    for(size_t idx = 0; idx < motorsAmount; idx++){
+        _state.forces.motors[idx] = _params.geometry[idx].axis * thrusts[idx];
 
         // Cunterclockwise rotation means positive torque, clockwise - negative
         double ccw = _params.geometry[idx].directionCCW ? 1.0 : -1.0;
-        Eigen::Vector3d motorTorquesInBodyCS = _params.geometry[idx].axis * (-1.0) * ccw * torque;
+        Eigen::Vector3d motorTorquesInBodyCS = _params.geometry[idx].axis * (-1.0) * ccw * torques[idx];
 
         Eigen::Vector3d MdueToArmOfForceInBodyCS = _params.geometry[idx].position.cross(_state.forces.motors[idx]);
         _state.moments.motors[idx] = motorTorquesInBodyCS + MdueToArmOfForceInBodyCS;
+
+        Fmotors += _state.forces.motors[idx];
+        Mmotors += _state.moments.motors[idx];
     }
+}
 
-    auto MtotalInBodyCS = std::accumulate(&_state.moments.motors[0], &_state.moments.motors[motors.size()], Maero);
-    _state.angularAccel = calculateAngularAccel(_params.inertia, MtotalInBodyCS, _state.angularVel);
+/**
+ * @brief Legacy integration scheme with forces given at the beginning of the step:
+ * angular velocity is updated first and used for the attitude, then the velocity is updated
+ * in the new attitude and used for the position.
+ */
+void VtolDynamics::calculateNewState(const Eigen::Vector3d& Maero,
+                                     const Eigen::Vector3d& Faero,
+                                     const std::vector<double>& motors,
+                                     double dt_sec){
+    Eigen::Vector3d Fmotors;
+    Eigen::Vector3d Mmotors;
+    calculateMotorsForcesAndMoments(motors, Fmotors, Mmotors);
+
+    Eigen::Vector3d MtotalInBodyCS = Maero + Mmotors;
+    _state.angularAccel = calculateAngularAccel(MtotalInBodyCS, _state.angularVel);
     _state.angularVel += _state.angularAccel * dt_sec;
-    Eigen::Quaterniond quaternion(0, _state.angularVel(0), _state.angularVel(1), _state.angularVel(2));
-    Eigen::Quaterniond attitudeDelta = _state.attitude * quaternion;
-    _state.attitude.coeffs() += attitudeDelta.coeffs() * 0.5 * dt_sec;
-    _state.attitude.normalize();
+    _state.attitude = Math::integrateAttitude(_state.attitude, _state.angularVel, dt_sec);
 
     Eigen::Matrix3d rotationMatrix = calculateRotationMatrix();
-    auto& Fmotors = _state.forces.motors;
-    Eigen::Vector3d Fspecific = std::accumulate(&Fmotors[0], &Fmotors[motors.size()], Faero) / _params.mass;
+    Eigen::Vector3d Fspecific = (Faero + Fmotors) / _params.mass;
     Eigen::Vector3d Ftotal = (Fspecific + rotationMatrix * Eigen::Vector3d(0, 0, _environment.gravity)) * _params.mass;
 
     _state.forces.total = Ftotal;
     _state.moments.total = MtotalInBodyCS;
 
-    _state.linearAccel = rotationMatrix.inverse() * Ftotal / _params.mass;
+    _state.linearAccel = rotationMatrix.transpose() * Ftotal / _params.mass;
     _state.linearVelNed += _state.linearAccel * dt_sec;
     _state.position += _state.linearVelNed * dt_sec;
 
-    if(_state.position[2] >= 0){
-        land();
+    proceedGround(Fspecific, dt_sec);
+
+    _state.bodylinearVel = calculateRotationMatrix() * _state.linearVelNed;
+}
+
+void VtolDynamics::proceedState(const Eigen::Vector3d& windNed,
+                                const std::vector<double>& motors,
+                                const std::array<double, 3>& servos,
+                                double dtSecs){
+    RigidBodyState body{_state.position, _state.linearVelNed, _state.attitude, _state.angularVel};
+    if(_integrationMethod == IntegrationMethod::EULER){
+        calculateMultiRateAeroForces(body, windNed, servos, _state.airspeedFrd,
+                                     _state.forces.aero, _state.moments.aero);
+        calculateNewState(_state.moments.aero, _state.forces.aero, motors, dtSecs);
+        return;
+    }
+
+    StepInputs inputs{windNed, servos, Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero()};
+    calculateMotorsForcesAndMoments(motors, inputs.Fmotors, inputs.Mmotors);
+
+    if(_integrationMethod == IntegrationMethod::SEMI_IMPLICIT_EULER){
+        calculateMultiRateAeroForces(body, windNed, servos, _state.airspeedFrd,
+                                     _state.forces.aero, _state.moments.aero);
     }else{
-        _state.forces.specific = Fspecific;
+        calculateAeroForces(body, windNed, servos, _state.airspeedFrd, _state.forces.aero, _state.moments.aero);
+    }
+    Eigen::Vector3d Fbody = _state.forces.aero + inputs.Fmotors;
+    Eigen::Vector3d Mbody = _state.moments.aero + inputs.Mmotors;
+    RigidBodyDerivative k1 = calculateRigidBodyDerivative(body, Fbody, Mbody);
+
+    // Intermediate stages overwrite the aerodynamics details, but we report the initial ones
+    Forces forces = _state.forces;
+    Moments moments = _state.moments;
+    switch(_integrationMethod){
+        case IntegrationMethod::SEMI_IMPLICIT_EULER:
+            body = integrateSemiImplicitEuler(body, k1, Fbody, dtSecs);
+            break;
+        case IntegrationMethod::RK4:
+            body = integrateRK4(body, k1, inputs, dtSecs);
+            break;
+        case IntegrationMethod::RK45:
+            body = integrateRK45(body, k1, inputs, dtSecs);
+            break;
+        default:
+            break;
+    }
+    _state.forces = forces;
+    _state.moments = moments;
+
+    Eigen::Matrix3d rotationMatrix = calculateRotationMatrix();
+    Eigen::Vector3d Fspecific = Fbody / _params.mass;
+    _state.forces.total = Fbody + rotationMatrix * Eigen::Vector3d(0, 0, _environment.gravity) * _params.mass;
+    _state.moments.total = Mbody;
+    _state.linearAccel = k1.linearAccel;
+    _state.angularAccel = k1.angularAccel;
+
+    _state.position = body.position;
+    _state.linearVelNed = body.linearVelNed;
+    _state.attitude = body.attitude;
+    _state.angularVel = body.angularVel;
+
+    proceedGround(Fspecific, dtSecs);
+
+    _state.bodylinearVel = calculateRotationMatrix() * _state.linearVelNed;
+}
+
+void VtolDynamics::calculateAeroForces(const RigidBodyState& body,
+                                       const Eigen::Vector3d& windNed,
+                                       const std::array<double, 3>& servos,
+                                       Eigen::Vector3d& airspeedFrd,
+                                       Eigen::Vector3d& Faero,
+                                       Eigen::Vector3d& Maero){
+    Eigen::Matrix3d rotationMatrix = body.attitude.toRotationMatrix().transpose();
+    airspeedFrd = calculateAirSpeed(rotationMatrix, body.linearVelNed, windNed);
+    double AoA = calculateAnglesOfAtack(airspeedFrd);
+    double AoS = calculateAnglesOfSideslip(airspeedFrd);
+    calculateAerodynamics(airspeedFrd, AoA, AoS, servos, Faero, Maero);
+    if(_faults.isActive()){
+        Maero -= _faults.getEffects().cgOffset.cross(Faero);
+    }
+}
+
+void VtolDynamics::calculateMultiRateAeroForces(const RigidBodyState& body,
+                                                const Eigen::Vector3d& windNed,
+                                                const std::array<double, 3>& servos,
+                                                Eigen::Vector3d& airspeedFrd,
+                                                Eigen::Vector3d& Faero,
+                                                Eigen::Vector3d& Maero){
+    auto& rate = _aeroMultiRate;
+    if(rate.samplesAmount == 0 || rate.stepsSinceUpdate >= rate.period){
+        calculateAeroForces(body, windNed, servos, airspeedFrd, Faero, Maero);
+        rate.prevFaero = rate.Faero;
+        rate.prevMaero = rate.Maero;
+        rate.Faero = Faero;
+        rate.Maero = Maero;
+        rate.samplesAmount = std::min<size_t>(rate.samplesAmount + 1, 2);
+        rate.stepsSinceUpdate = 1;
+        return;
+    }
+
+    Eigen::Matrix3d rotationMatrix = body.attitude.toRotationMatrix().transpose();
+    airspeedFrd = calculateAirSpeed(rotationMatrix, body.linearVelNed, windNed);
+    double extrapolation = 0.0;
+    if(rate.isExtrapolated && rate.samplesAmount == 2){
+        extrapolation = static_cast<double>(rate.stepsSinceUpdate) / static_cast<double>(rate.period);
+    }
+    Faero = rate.Faero + (rate.Faero - rate.prevFaero) * extrapolation;
+    Maero = rate.Maero + (rate.Maero - rate.prevMaero) * extrapolation;
+    rate.stepsSinceUpdate++;
+}
+
+/**
+ * @param[in] Fbody - sum of the aerodynamic and motors forces in FRD, without gravity
+ * @param[in] Mbody - sum of the aerodynamic and motors moments in FRD
+ */
+RigidBodyDerivative VtolDynamics::calculateRigidBodyDerivative(const RigidBodyState& body,
+                                                               const Eigen::Vector3d& Fbody,
+                                                               const Eigen::Vector3d& Mbody) const{
+    RigidBodyDerivative derivative;
+    derivative.linearVelNed = body.linearVelNed;
+    derivative.linearAccel = body.attitude * Fbody / _params.mass + Eigen::Vector3d(0, 0, _environment.gravity);
+    Eigen::Quaterniond quaternion(0, body.angularVel(0), body.angularVel(1), body.angularVel(2));
+    derivative.attitude = (body.attitude * quaternion).coeffs() * 0.5;
+    derivative.angularAccel = calculateAngularAccel(Mbody, body.angularVel);
+    return derivative;
+}
+
+static RigidBodyDerivative operator+(const RigidBodyDerivative& lhs, const RigidBodyDerivative& rhs){
+    return {lhs.linearVelNed + rhs.linearVelNed,
+            lhs.linearAccel + rhs.linearAccel,
+            lhs.attitude + rhs.attitude,
+            lhs.angularAccel + rhs.angularAccel};
+}
+
+static RigidBodyDerivative operator*(double factor, const RigidBodyDerivative& derivative){
+    return {factor * derivative.linearVelNed,
+            factor * derivative.linearAccel,
+            factor * derivative.attitude,
+            factor * derivative.angularAccel};
+}
+
+/**
+ * @return body + derivative * dt with normalized attitude
+ */
+static RigidBodyState proceedRigidBody(const RigidBodyState& body,
+                                       const RigidBodyDerivative& derivative,
+                                       double dtSecs){
+    RigidBodyState next;
+    next.position = body.position + derivative.linearVelNed * dtSecs;
+    next.linearVelNed = body.linearVelNed + derivative.linearAccel * dtSecs;
+    next.attitude.coeffs() = body.attitude.coeffs() + derivative.attitude * dtSecs;
+    next.attitude.normalize();
+    next.angularVel = body.angularVel + derivative.angularAccel * dtSecs;
+    return next;
+}
+
+RigidBodyDerivative VtolDynamics::evaluateStage(const RigidBodyState& body, const StepInputs& inputs){
+    Eigen::Vector3d airspeedFrd;
+    Eigen::Vector3d Faero;
+    Eigen::Vector3d Maero;
+    calculateAeroForces(body, inputs.windNed, inputs.servos, airspeedFrd, Faero, Maero);
+    return calculateRigidBodyDerivative(body, Faero + inputs.Fmotors, Maero + inputs.Mmotors);
+}
+
+static Eigen::Matrix3d skew(const Eigen::Vector3d& vec){
+    Eigen::Matrix3d matrix;
+    matrix <<       0, -vec[2],  vec[1],
+               vec[2],       0, -vec[0],
+              -vec[1],  vec[0],       0;
+    return matrix;
+}
+
+/**
+ * @brief Angular velocity is linearly implicit in the gyroscopic term w x (I * w),
+ * the attitude uses the new angular velocity, the velocity is updated in the new attitude
+ * and the position uses the new velocity. Aerodynamics is taken from the beginning of the step.
+ */
+RigidBodyState VtolDynamics::integrateSemiImplicitEuler(const RigidBodyState& body,
+                                                        const RigidBodyDerivative& k1,
+                                                        const Eigen::Vector3d& Fbody,
+                                                        double dtSecs) const{
+    const auto& inertia = _params.inertia;
+    const Eigen::Vector3d& angVel = body.angularVel;
+    Eigen::Matrix3d jacobian = _params.derived.inertiaInv * (skew(inertia * angVel) - skew(angVel) * inertia);
+    Eigen::Matrix3d system = Eigen::Matrix3d::Identity() - dtSecs * jacobian;
+
+    RigidBodyState next;
+    next.angularVel = angVel + system.partialPivLu().solve(k1.angularAccel * dtSecs);
+
+    next.attitude = Math::integrateAttitude(body.attitude, next.angularVel, dtSecs);
+
+    Eigen::Vector3d linearAccel = next.attitude * Fbody / _params.mass + Eigen::Vector3d(0, 0, _environment.gravity);
+    next.linearVelNed = body.linearVelNed + linearAccel * dtSecs;
+    next.position = body.position + next.linearVelNed * dtSecs;
+    return next;
+}
+
+RigidBodyState VtolDynamics::integrateRK4(const RigidBodyState& body,
+                                          const RigidBodyDerivative& k1,
+                                          const StepInputs& inputs,
+                                          double dtSecs){
+    RigidBodyDerivative k2 = evaluateStage(proceedRigidBody(body, k1, 0.5 * dtSecs), inputs);
+    RigidBodyDerivative k3 = evaluateStage(proceedRigidBody(body, k2, 0.5 * dtSecs), inputs);
+    RigidBodyDerivative k4 = evaluateStage(proceedRigidBody(body, k3, dtSecs), inputs);
+    return proceedRigidBody(body, (1.0 / 6.0) * (k1 + 2.0 * k2 + 2.0 * k3 + k4), dtSecs);
+}
+
+static double calculateErrorRatio(const RigidBodyDerivative& error,
+                                  const RigidBodyState& prev,
+                                  const RigidBodyState& next,
+                                  double dtSecs,
+                                  double absTolerance,
+                                  double relTolerance){
+    auto ratio = [&](const auto& err, const auto& prevValue, const auto& nextValue){
+        auto scale = (absTolerance + relTolerance * prevValue.cwiseAbs().cwiseMax(nextValue.cwiseAbs()).array()).eval();
+        return (err.cwiseAbs().array() * dtSecs / scale).maxCoeff();
+    };
+    return std::max({ratio(error.linearVelNed, prev.position, next.position),
+                     ratio(error.linearAccel, prev.linearVelNed, next.linearVelNed),
+                     ratio(error.attitude, prev.attitude.coeffs(), next.attitude.coeffs()),
+                     ratio(error.angularAccel, prev.angularVel, next.angularVel)});
+}
+
+/**
+ * @brief Dormand-Prince 5(4) with local error control. The step is split into substeps
+ * until the whole dtSecs is covered, the last accepted substep is reused on the next call.
+ */
+RigidBodyState VtolDynamics::integrateRK45(const RigidBodyState& body,
+                                           const RigidBodyDerivative& k1,
+                                           const StepInputs& inputs,
+                                           double dtSecs){
+    constexpr double MIN_SUBSTEP_SECS = 1e-6;
+    constexpr size_t MAX_SUBSTEPS = 100;
+    constexpr double SAFETY = 0.9;
+    constexpr double MIN_SCALE = 0.2;
+    constexpr double MAX_SCALE = 5.0;
+
+    RigidBodyState crnt = body;
+    RigidBodyDerivative k1Crnt = k1;
+    double remainingSecs = dtSecs;
+    double substepSecs = (_adaptiveStepSecs > 0.0) ? _adaptiveStepSecs : dtSecs;
+
+    for(size_t substep = 0; substep < MAX_SUBSTEPS && remainingSecs > 0.0; substep++){
+        const bool isLastAllowed = (substep + 1 == MAX_SUBSTEPS);
+        const bool isFinal = isLastAllowed || substepSecs >= remainingSecs * (1.0 - 1e-9);
+        const double h = isFinal ? remainingSecs : substepSecs;
+
+        auto k2 = evaluateStage(proceedRigidBody(crnt, (1.0 / 5.0) * k1Crnt, h), inputs);
+        auto k3 = evaluateStage(proceedRigidBody(crnt, (3.0 / 40.0) * k1Crnt + (9.0 / 40.0) * k2, h), inputs);
+        auto k4 = evaluateStage(proceedRigidBody(crnt, (44.0 / 45.0) * k1Crnt + (-56.0 / 15.0) * k2 +
+                                                       (32.0 / 9.0) * k3, h), inputs);
+        auto k5 = evaluateStage(proceedRigidBody(crnt, (19372.0 / 6561.0) * k1Crnt + (-25360.0 / 2187.0) * k2 +
+                                                       (64448.0 / 6561.0) * k3 + (-212.0 / 729.0) * k4, h), inputs);
+        auto k6 = evaluateStage(proceedRigidBody(crnt, (9017.0 / 3168.0) * k1Crnt + (-355.0 / 33.0) * k2 +
+                                                       (46732.0 / 5247.0) * k3 + (49.0 / 176.0) * k4 +
+                                                       (-5103.0 / 18656.0) * k5, h), inputs);
+        auto increment = (35.0 / 384.0) * k1Crnt + (500.0 / 1113.0) * k3 + (125.0 / 192.0) * k4 +
+                         (-2187.0 / 6784.0) * k5 + (11.0 / 84.0) * k6;
+        auto next = proceedRigidBody(crnt, increment, h);
+        auto k7 = evaluateStage(next, inputs);
+
+        auto error = (71.0 / 57600.0) * k1Crnt + (-71.0 / 16695.0) * k3 + (71.0 / 1920.0) * k4 +
+                     (-17253.0 / 339200.0) * k5 + (22.0 / 525.0) * k6 + (-1.0 / 40.0) * k7;
+        double errorRatio = calculateErrorRatio(error, crnt, next, h,
+                                                _adaptiveAbsTolerance, _adaptiveRelTolerance);
+
+        double scale = (errorRatio > 0.0) ? SAFETY * std::pow(errorRatio, -0.2) : MAX_SCALE;
+        scale = boost::algorithm::clamp(scale, MIN_SCALE, MAX_SCALE);
+        const double proposalSecs = std::max(h * scale, MIN_SUBSTEP_SECS);
+
+        const bool isAccepted = errorRatio <= 1.0 || h <= MIN_SUBSTEP_SECS || isLastAllowed;
+        if(isAccepted){
+            crnt = next;
+            k1Crnt = k7;
+            remainingSecs = isFinal ? 0.0 : remainingSecs - h;
+        }
+
+        // A substep shortened by the end of the step should not shrink the next proposal
+        substepSecs = (isAccepted && h < substepSecs) ? std::max(substepSecs, proposalSecs) : proposalSecs;
     }
 
-    _state.bodylinearVel = rotationMatrix * _state.linearVelNed;
+    _adaptiveStepSecs = substepSecs;
+    return crnt;
 }
 
 Eigen::Vector3d VtolDynamics::calculateNormalForceWithoutMass() const{
@@ -577,50 +1702,49 @@ Eigen::Vector3d VtolDynamics::calculateNormalForceWithoutMass() const{
 }
 
 void VtolDynamics::calculateCLPolynomial(double airSpeedMod,
-                                                Eigen::VectorXd& polynomialCoeffs) const{
-    Math::calculatePolynomial(_tables.CLPolynomial, airSpeedMod, polynomialCoeffs);
+                                                Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const{
+    _tables.grids.CLPolynomial.evaluate(airSpeedMod, polynomialCoeffs);
 }
 void VtolDynamics::calculateCSPolynomial(double airSpeedMod,
-                                                Eigen::VectorXd& polynomialCoeffs) const{
-    Math::calculatePolynomial(_tables.CSPolynomial, airSpeedMod, polynomialCoeffs);
+                                                Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const{
+    _tables.grids.CSPolynomial.evaluate(airSpeedMod, polynomialCoeffs);
 }
 void VtolDynamics::calculateCDPolynomial(double airSpeedMod,
-                                                Eigen::VectorXd& polynomialCoeffs) const{
-    Math::calculatePolynomial(_tables.CDPolynomial, airSpeedMod, polynomialCoeffs);
+                                                Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const{
+    _tables.grids.CDPolynomial.evaluate(airSpeedMod, polynomialCoeffs);
 }
 void VtolDynamics::calculateCmxPolynomial(double airSpeedMod,
-                                                 Eigen::VectorXd& polynomialCoeffs) const{
-    Math::calculatePolynomial(_tables.CmxPolynomial, airSpeedMod, polynomialCoeffs);
+                                                 Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const{
+    _tables.grids.CmxPolynomial.evaluate(airSpeedMod, polynomialCoeffs);
 }
 void VtolDynamics::calculateCmyPolynomial(double airSpeedMod,
-                                                 Eigen::VectorXd& polynomialCoeffs) const{
-    Math::calculatePolynomial(_tables.CmyPolynomial, airSpeedMod, polynomialCoeffs);
+                                                 Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const{
+    _tables.grids.CmyPolynomial.evaluate(airSpeedMod, polynomialCoeffs);
 }
 void VtolDynamics::calculateCmzPolynomial(double airSpeedMod,
-                                                 Eigen::VectorXd& polynomialCoeffs) const{
-    Math::calculatePolynomial(_tables.CmzPolynomial, airSpeedMod, polynomialCoeffs);
+                                                 Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const{
+    _tables.grids.CmzPolynomial.evaluate(airSpeedMod, polynomialCoeffs);
 }
 double VtolDynamics::calculateCSRudder(double rudder_pos, double airspeed) const{
-    return Math::griddata(-_tables.actuator, _tables.airspeed, _tables.CS_rudder, rudder_pos, airspeed);
+    return _tables.grids.CS_rudder.evaluate<double>({airspeed, rudder_pos});
 }
 double VtolDynamics::calculateCSBeta(double AoS_deg, double airspeed) const{
-    return Math::griddata(-_tables.AoS, _tables.airspeed, _tables.CS_beta, AoS_deg, airspeed);
+    return _tables.grids.CS_beta.evaluate<double>({airspeed, AoS_deg});
 }
 double VtolDynamics::calculateCmxAileron(double aileron_pos, double airspeed) const{
-    return Math::griddata(_tables.actuator, _tables.airspeed, _tables.CmxAileron, aileron_pos, airspeed);
+    return _tables.grids.CmxAileron.evaluate<double>({airspeed, aileron_pos});
 }
 double VtolDynamics::calculateCmyElevator(double elevator_pos, double airspeed) const{
-    return Math::griddata(_tables.actuator, _tables.airspeed, _tables.CmyElevator, elevator_pos, airspeed);
+    return _tables.grids.CmyElevator.evaluate<double>({airspeed, elevator_pos});
 }
 double VtolDynamics::calculateCmzRudder(double rudder_pos, double airspeed) const{
-    return Math::griddata(_tables.actuator, _tables.airspeed, _tables.CmzRudder, rudder_pos, airspeed);
+    return _tables.grids.CmzRudder.evaluate<double>({airspeed, rudder_pos});
 }
 
 // Motion dynamics equation
-Eigen::Vector3d VtolDynamics::calculateAngularAccel(const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>& inertia,
-                                                           const Eigen::Vector3d& moment,
-                                                           const Eigen::Vector3d& prevAngVel) const{
-    return inertia.inverse() * (moment - prevAngVel.cross(inertia * prevAngVel));
+Eigen::Vector3d VtolDynamics::calculateAngularAccel(const Eigen::Vector3d& moment,
+                                                   const Eigen::Vector3d& prevAngVel) const{
+    return calculateAngularAccelT(moment, prevAngVel);
 }
 
 /**
@@ -651,12 +1775,14 @@ Eigen::Vector3d VtolDynamics::getVehicleAngularVelocity() const{
  */
 void VtolDynamics::getIMUMeasurement(Eigen::Vector3d& accOutFrd,
                                             Eigen::Vector3d& gyroOutFrd){
-    Eigen::Vector3d accNoise(sqrt(_params.accVariance) * _distribution(_generator),
-                             sqrt(_params.accVariance) * _distribution(_generator),
-                             sqrt(_params.accVariance) * _distribution(_generator));
-    Eigen::Vector3d gyroNoise(sqrt(_params.gyroVariance) * _distribution(_generator),
-                             sqrt(_params.gyroVariance) * _distribution(_generator),
-                             sqrt(_params.gyroVariance) * _distribution(_generator));
+    const double accStdDev = _params.derived.accStdDev;
+    const double gyroStdDev = _params.derived.gyroStdDev;
+    Eigen::Vector3d accNoise(accStdDev * _distribution(_generator),
+                             accStdDev * _distribution(_generator),
+                             accStdDev * _distribution(_generator));
+    Eigen::Vector3d gyroNoise(gyroStdDev * _distribution(_generator),
+                             gyroStdDev * _distribution(_generator),
+                             gyroStdDev * _distribution(_generator));
 
     Eigen::Vector3d specificForce(_state.forces.specific);
     Eigen::Vector3d angularVelocity(_state.angularVel);
@@ -672,6 +1798,145 @@ void VtolDynamics::setWindParameter(Eigen::Vector3d windMeanVelocityNED,
                                        double windVariance){
     _environment.windNED = windMeanVelocityNED;
     _environment.windVariance = windVariance;
+    _params.derived.windStdDev = sqrt(windVariance);
+}
+void VtolDynamics::setGroundContact(const GroundContact& contact){
+    assert(contact.gearsAmount <= GroundContact::GEARS_MAX_AMOUNT);
+    _params.groundContact = contact;
+}
+void VtolDynamics::setGustParameter(const Eigen::Vector3d& gustVelocityNED, double gustVariance){
+    _environment.gustVelocityNED = gustVelocityNED;
+    _environment.gustVariance = gustVariance;
+    _turbulence.dtSecs = -1.0;
+}
+void VtolDynamics::setTurbulenceSeed(uint64_t seed){
+    _turbulence.generator.seed(seed);
+    _turbulence.distribution.reset();
+    _turbulence.velocityFrd.setZero();
+}
+void VtolDynamics::setIntegrationMethod(IntegrationMethod method){
+    _integrationMethod = method;
+    _adaptiveStepSecs = 0.0;
+}
+void VtolDynamics::setAdaptiveStepTolerance(double absTolerance, double relTolerance){
+    _adaptiveAbsTolerance = absTolerance;
+    _adaptiveRelTolerance = relTolerance;
+}
+void VtolDynamics::setActuatorsLimits(const std::vector<double>& rateLimits,
+                                      const std::vector<double>& deadbands){
+    const size_t channelsAmount = _tables.actuatorTimeConstants.size();
+    if((!rateLimits.empty() && rateLimits.size() != channelsAmount) ||
+            (!deadbands.empty() && deadbands.size() != channelsAmount)){
+        throw std::invalid_argument("Wrong actuators limits size");
+    }
+    _params.actuatorRateLimits.fill(0.0);
+    _params.actuatorDeadbands.fill(0.0);
+    std::copy(rateLimits.begin(), rateLimits.end(), _params.actuatorRateLimits.begin());
+    std::copy(deadbands.begin(), deadbands.end(), _params.actuatorDeadbands.begin());
+    _params.derived.actuatorsDtSecs = -1.0;
+}
+const std::vector<double>& VtolDynamics::getActuators() const{
+    return _state.crntActuators;
+}
+void VtolDynamics::setAeroMemoTolerances(const AeroMemoTolerances& tolerances){
+    auto& memo = _aeroMemo;
+    memo.tolerances = tolerances;
+    memo.isEnabled = tolerances.airspeed > 0 && tolerances.AoA_deg > 0 &&
+                     tolerances.AoS_deg > 0 && tolerances.servos > 0;
+    memo.stepsInv = {1.0 / tolerances.airspeed, 1.0 / tolerances.AoA_deg, 1.0 / tolerances.AoS_deg,
+                     1.0 / tolerances.servos, 1.0 / tolerances.servos, 1.0 / tolerances.servos};
+    memo.isValid = false;
+    memo.hits = 0;
+    memo.misses = 0;
+}
+uint64_t VtolDynamics::getAeroMemoHits() const{
+    return _aeroMemo.hits;
+}
+uint64_t VtolDynamics::getAeroMemoMisses() const{
+    return _aeroMemo.misses;
+}
+void VtolDynamics::setAeroUpdatePeriod(size_t period, bool isExtrapolated){
+    _aeroMultiRate.period = std::max<size_t>(period, 1);
+    _aeroMultiRate.isExtrapolated = isExtrapolated;
+    _aeroMultiRate.stepsSinceUpdate = 0;
+    _aeroMultiRate.samplesAmount = 0;
+}
+
+/**
+ * @note The motors thrust uses the 2-D prop table with the inflow of this airspeed, if it is enabled
+ */
+void VtolDynamics::calculateSteadyAccelerations(const RigidBodyState& body,
+                                                const Eigen::Vector3d& windNed,
+                                                const std::vector<double>& unitlessSetpoint,
+                                                Eigen::Vector3d& linearAccel,
+                                                Eigen::Vector3d& angularAccel){
+    std::vector<double> motors(_motorsSpeed.size());
+    std::array<double, 3> servos;
+    mapUnitlessSetpoint(unitlessSetpoint, motors, servos);
+
+    Eigen::Vector3d Faero;
+    Eigen::Vector3d Maero;
+    calculateAeroForces(body, windNed, servos, _state.airspeedFrd, Faero, Maero);
+    Eigen::Vector3d Fmotors;
+    Eigen::Vector3d Mmotors;
+    calculateMotorsForcesAndMoments(motors, Fmotors, Mmotors);
+
+    auto derivative = calculateRigidBodyDerivative(body, Faero + Fmotors, Maero + Mmotors);
+    linearAccel = derivative.linearAccel;
+    angularAccel = derivative.angularAccel;
+}
+
+VtolTrimModel::VtolTrimModel(const VtolDynamics& dynamics) : _dynamics(dynamics){
+    _dynamics.setAeroMemoTolerances(AeroMemoTolerances());
+}
+std::unique_ptr<TrimModel> VtolTrimModel::clone() const{
+    return std::make_unique<VtolTrimModel>(*this);
+}
+size_t VtolTrimModel::getSetpointsAmount() const{
+    return _dynamics.getParameters().geometry.size() + SERVOS_AMOUNT;
+}
+void VtolTrimModel::getSetpointLimits(Eigen::VectorXd& lower, Eigen::VectorXd& upper) const{
+    const size_t motorsAmount = _dynamics.getParameters().geometry.size();
+    lower.setConstant(motorsAmount + SERVOS_AMOUNT, -1.0);
+    upper.setConstant(motorsAmount + SERVOS_AMOUNT, +1.0);
+    lower.head(motorsAmount).setZero();
+}
+void VtolTrimModel::calculateAccelerations(const Eigen::Vector3d& linearVelNed,
+                                           const Eigen::Quaterniond& attitude,
+                                           const Eigen::Vector3d& angularVel,
+                                           const std::vector<double>& setpoint,
+                                           Eigen::Vector3d& linearAccel,
+                                           Eigen::Vector3d& angularAccel){
+    RigidBodyState body{Eigen::Vector3d::Zero(), linearVelNed, attitude, angularVel};
+    _dynamics.calculateSteadyAccelerations(body, Eigen::Vector3d::Zero(), setpoint, linearAccel, angularAccel);
+}
+const VtolParameters& VtolDynamics::getParameters() const{
+    return _params;
+}
+const TablesWithCoeffs& VtolDynamics::getTables() const{
+    return _tables;
+}
+const Environment& VtolDynamics::getEnvironment() const{
+    return _environment;
+}
+void VtolDynamics::setAeroTables(const TablesWithCoeffs& tables){
+    _tables.CS_rudder = tables.CS_rudder;
+    _tables.CS_beta = tables.CS_beta;
+    _tables.AoA = tables.AoA;
+    _tables.AoS = tables.AoS;
+    _tables.actuator = tables.actuator;
+    _tables.airspeed = tables.airspeed;
+    _tables.CLPolynomial = tables.CLPolynomial;
+    _tables.CSPolynomial = tables.CSPolynomial;
+    _tables.CDPolynomial = tables.CDPolynomial;
+    _tables.CmxPolynomial = tables.CmxPolynomial;
+    _tables.CmyPolynomial = tables.CmyPolynomial;
+    _tables.CmzPolynomial = tables.CmzPolynomial;
+    _tables.CmxAileron = tables.CmxAileron;
+    _tables.CmyElevator = tables.CmyElevator;
+    _tables.CmzRudder = tables.CmzRudder;
+    calculateAeroGrids();
+    _aeroMemo.isValid = false;
 }
 Eigen::Vector3d VtolDynamics::getAngularAcceleration() const{
     return _state.angularAccel;
@@ -691,9 +1956,6 @@ Eigen::Vector3d VtolDynamics::getBodyLinearVelocity() const{
 }
 
 bool VtolDynamics::getMotorsRpm(std::vector<double>& motorsRpm) {
-    for (auto motor_rpm : _state.motorsRpm) {
-        motorsRpm.push_back(motor_rpm);
-    }
-
+    motorsRpm.assign(_state.motorsRpm.begin(), _state.motorsRpm.end());
     return true;
 }
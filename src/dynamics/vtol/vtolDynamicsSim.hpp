@@ -24,10 +24,25 @@
 #include <vector>
 #include <array>
 #include <random>
+#include <algorithm>
 #include "uavDynamicsSimBase.hpp"
+#include "trimSolver.hpp"
+#include "common_math.hpp"
+#include "grid_interpolator.hpp"
+#include "stagedUpdate.hpp"
 
 inline constexpr size_t MOTORS_MIN_AMOUNT = 5;
 inline constexpr size_t MOTORS_MAX_AMOUNT = 9;
+inline constexpr size_t PROP_TABLE_SIZE = 40;
+inline constexpr size_t ACTUATORS_CHANNELS_MAX_AMOUNT = MOTORS_MAX_AMOUNT + 3;   // motors and servos
+
+inline constexpr size_t AILERONS_INDEX = 0;
+inline constexpr size_t ELEVATORS_INDEX = 1;
+inline constexpr size_t RUDDERS_INDEX = 2;
+inline constexpr size_t SERVOS_AMOUNT = 3;
+
+template<typename Scalar>
+using Vector3T = Eigen::Matrix<Scalar, 3, 1>;
 
 struct Geometry {
     Eigen::Vector3d position;                       // Meters
@@ -35,6 +50,42 @@ struct Geometry {
     bool directionCCW;                              // True for CCW, False for CW
 };
 
+/**
+ * @brief Values that depend only on parameters. They are computed once by
+ * VtolDynamics::updateDerivedConstants() instead of on each step.
+ */
+struct DerivedConstants{
+    Eigen::Matrix3d inertiaInv{Eigen::Matrix3d::Identity()};  // 1/(kg*m^2)
+    double accStdDev{0.0};
+    double gyroStdDev{0.0};
+    double windStdDev{0.0};                         // m/sec
+    double aeroForceFactor{0.0};                    // 0.5 * rho * S, N/(m/sec)^2
+    double aeroMomentFactor{0.0};                   // 0.5 * rho * S * L, N*m/(m/sec)^2
+
+    /**
+     * @note Actuators coefficients depend on dt, so they are recomputed when dt changes
+     */
+    double actuatorsDtSecs{-1.0};                   // negative means invalid
+    std::array<double, ACTUATORS_CHANNELS_MAX_AMOUNT> actuatorsGain;        // 1 - exp(-dt / tau)
+    std::array<double, ACTUATORS_CHANNELS_MAX_AMOUNT> actuatorsMaxDelta;    // rate limit * dt
+};
+
+/**
+ * @brief Spring-damper contact of the landing gear points with the flat ground z = 0 (NED),
+ * with Coulomb friction. It is integrated implicitly, see VtolDynamics::applyGroundContact().
+ * @note If it is disabled, the vehicle is teleported to the ground by VtolDynamics::land()
+ */
+struct GroundContact{
+    static constexpr size_t GEARS_MAX_AMOUNT = 8;
+
+    bool isEnabled{false};
+    size_t gearsAmount{0};
+    std::array<Eigen::Vector3d, GEARS_MAX_AMOUNT> positions;  // FRD, meters
+    double stiffness{0.0};                          // N/m, per gear
+    double damping{0.0};                            // N*sec/m, per gear
+    double friction{0.0};                           // Coulomb friction coefficient
+};
+
 struct VtolParameters{
     double mass;                                    // kg
     double wingArea;                                // m^2
@@ -46,6 +97,13 @@ struct VtolParameters{
 
     std::vector<double> motorMaxSpeed;              // rad/sec
     std::vector<double> servoRange;
+
+    /**
+     * @brief Optional per channel limits of the actuators dynamics, motors first, then servos.
+     * Zero rate limit means unlimited, zero deadband means disabled.
+     */
+    std::array<double, ACTUATORS_CHANNELS_MAX_AMOUNT> actuatorRateLimits{};  // units/sec
+    std::array<double, ACTUATORS_CHANNELS_MAX_AMOUNT> actuatorDeadbands{};   // units
     std::vector<Geometry> geometry;
 
     double accVariance;
@@ -59,6 +117,10 @@ struct VtolParameters{
 
     Eigen::Vector3d accelBias;
     Eigen::Vector3d gyroBias;
+
+    GroundContact groundContact;
+
+    DerivedConstants derived;
 };
 
 struct Forces{
@@ -102,19 +164,243 @@ struct State{
 
     std::array<double, MOTORS_MAX_AMOUNT> motorsRpm;  // rpm
     Eigen::Vector3d bodylinearVel;                  // m/sec (just for debug only)
-    std::vector<double> prevActuators;              // rad/sec
-    std::vector<double> crntActuators;              // rad/sec
+    std::vector<double> prevActuators;              // motors in rad/sec, then servos
+    std::vector<double> crntActuators;              // motors in rad/sec, then servos
+};
+
+/**
+ * @brief The part of the State that is integrated by the numerical integrators
+ */
+struct RigidBodyState{
+    Eigen::Vector3d position;                       // NED, meters
+    Eigen::Vector3d linearVelNed;                   // NED, m/sec
+    Eigen::Quaterniond attitude;                    // FRD to NED
+    Eigen::Vector3d angularVel;                     // FRD, rad/sec
+};
+
+struct RigidBodyDerivative{
+    Eigen::Vector3d linearVelNed;                   // m/sec
+    Eigen::Vector3d linearAccel;                    // m/sec^2
+    Eigen::Vector4d attitude;                       // quaternion coeffs (x, y, z, w) per sec
+    Eigen::Vector3d angularAccel;                   // rad/sec^2
+};
+
+/**
+ * @brief Inputs that are held constant during one integration step
+ */
+struct StepInputs{
+    Eigen::Vector3d windNed;                        // m/sec
+    std::array<double, 3> servos;                   // aileron, elevator, rudder
+    Eigen::Vector3d Fmotors;                        // FRD, N
+    Eigen::Vector3d Mmotors;                        // FRD, N*m
+};
+
+enum class IntegrationMethod{
+    EULER = 0,                                      // legacy scheme, see calculateNewState()
+    SEMI_IMPLICIT_EULER,
+    RK4,
+    RK45,                                           // Dormand-Prince with adaptive substeps
 };
 
 struct Environment{
     double windVariance;
     Eigen::Vector3d windNED;                        // m/sec^2
-    Eigen::Vector3d gustVelocityNED;                // m/sec^2
-    double gustVariance;
+    Eigen::Vector3d gustVelocityNED;                // m/sec^2, constant part of the gust
+    double gustVariance;                            // (m/sec)^2, vertical Dryden turbulence intensity
     double gravity;                                 // n/sec^2
     double atmoRho;                                 // air density (kg/m^3)
 };
 
+/**
+ * @brief Dryden turbulence (MIL-F-8785C) as first order shaping filters per body axis u, v, w:
+ * x[k+1] = a * x[k] + b * n[k], a = exp(-V * dt / L), b = sigma * sqrt(1 - a^2),
+ * where n is a unit normal sample, L and sigma are the length scale and the intensity of the axis.
+ * The coefficients depend on dt, the airspeed V and the altitude, so they are recomputed only
+ * when dt changes or the airspeed or the altitude leaves its band.
+ */
+struct DrydenTurbulence{
+    static constexpr double AIRSPEED_BAND = 1.0;    // m/sec
+    static constexpr double ALTITUDE_BAND = 10.0;   // m
+
+    double dtSecs{-1.0};                            // negative means invalid
+    int64_t airspeedBand{0};
+    int64_t altitudeBand{0};
+    Eigen::Vector3d a{Eigen::Vector3d::Zero()};
+    Eigen::Vector3d b{Eigen::Vector3d::Zero()};
+    Eigen::Vector3d velocityFrd{Eigen::Vector3d::Zero()};  // m/sec, filters state
+
+    std::default_random_engine generator;
+    std::normal_distribution<double> distribution{0.0, 1.0};
+};
+
+/**
+ * @brief Table lookups and polynomials of calculateAerodynamics()
+ */
+template<typename Scalar>
+struct AeroCoefficientsT{
+    Scalar CL;
+    Scalar CS;                                      // polynomial, rudder and beta parts together
+    Scalar CD;
+    Scalar Cmx;
+    Scalar Cmy;
+    Scalar Cmz;
+    Scalar CmxAileron;
+    Scalar CmyElevator;
+    Scalar CmzRudder;
+};
+using AeroCoefficients = AeroCoefficientsT<double>;
+
+/**
+ * @brief Memoization of AeroCoefficients between steps.
+ * Inputs are quantized with the tolerances into cells and the coefficients are reused
+ * while all inputs stay in the cell of the last evaluation.
+ * @note It is enabled only if all tolerances are positive
+ */
+struct AeroMemoTolerances{
+    double airspeed{0.0};                           // m/sec
+    double AoA_deg{0.0};                            // deg
+    double AoS_deg{0.0};                            // deg
+    double servos{0.0};                             // same units as VtolParameters::servoRange
+};
+
+struct AeroMemo{
+    static constexpr size_t INPUTS_AMOUNT = 6;      // airspeed, AoA, AoS, 3 servos
+
+    AeroMemoTolerances tolerances;
+    std::array<double, INPUTS_AMOUNT> stepsInv;     // 1 / tolerance of each input
+    bool isEnabled{false};
+    bool isValid{false};                            // false until the first evaluation
+    std::array<int64_t, INPUTS_AMOUNT> cell;
+    AeroCoefficients coeffs;
+
+    uint64_t hits{0};
+    uint64_t misses{0};
+};
+
+/**
+ * @brief Parameters modified by the faults, they are restored when the faults end
+ */
+struct FaultNominalParams{
+    bool isSaved{false};
+    double mass{0.0};                               // kg
+    std::vector<double> motorMaxSpeed;              // rad/sec
+    std::vector<Eigen::Vector3d> motorsPosition;    // FRD, meters
+};
+
+/**
+ * @brief Multi-rate aerodynamics: the aerodynamic forces and moments are evaluated every period
+ * steps and are held or linearly extrapolated from the last two evaluations in between, while the
+ * airspeed, the motors and the rigid body are updated every step.
+ * @note It is used by the EULER and SEMI_IMPLICIT_EULER methods, period = 1 means single rate
+ */
+struct AeroMultiRate{
+    size_t period{1};
+    bool isExtrapolated{false};
+
+    size_t stepsSinceUpdate{0};
+    size_t samplesAmount{0};                        // valid evaluations, up to 2
+    Eigen::Vector3d Faero;
+    Eigen::Vector3d Maero;
+    Eigen::Vector3d prevFaero;
+    Eigen::Vector3d prevMaero;
+};
+
+/**
+ * @brief Piecewise linear representation of the prop table.
+ * Each segment keeps its start point and the slopes of thrust, torque and rpm
+ * with respect to the actuator command, so a lookup is a single multiply-add.
+ * @note It is derived from TablesWithCoeffs::prop once in loadTables()
+ */
+struct PropSegments{
+    static constexpr size_t AMOUNT = PROP_TABLE_SIZE - 1;
+
+    std::array<double, AMOUNT> control;
+    std::array<double, AMOUNT> thrust;
+    std::array<double, AMOUNT> torque;
+    std::array<double, AMOUNT> rpm;
+
+    std::array<double, AMOUNT> thrustSlope;
+    std::array<double, AMOUNT> torqueSlope;
+    std::array<double, AMOUNT> rpmSlope;
+
+    bool isUniform{false};                          // true if all segments have equal width
+    double controlStepInv{0.0};                     // 1 / segment width, valid if isUniform
+
+    size_t findSegmentIdx(double actuator) const;
+    size_t findSegmentIdx(double actuator, size_t& cursor) const;
+};
+
+/**
+ * @brief Optional 2-D prop table: thrust, torque and rpm by the command and the axial inflow.
+ * The command axis is the one of the 1-D prop table, so PropSegments::findSegmentIdx() is reused.
+ * Each cell keeps the bilinear form f = value + du * commandSlope + dv * (inflowSlope + du * crossSlope),
+ * where du and dv are offsets from the cell origin, so a lookup costs a few multiply-adds more
+ * than PropSegments.
+ * @note The inflow is clamped to the table range, the command is extrapolated as in PropSegments
+ */
+struct PropInflowCells{
+    static constexpr size_t OUTPUTS_AMOUNT = 3;     // thrust, torque, rpm
+
+    struct Cell{
+        std::array<double, OUTPUTS_AMOUNT> value;
+        std::array<double, OUTPUTS_AMOUNT> commandSlope;
+        std::array<double, OUTPUTS_AMOUNT> inflowSlope;
+        std::array<double, OUTPUTS_AMOUNT> crossSlope;
+    };
+
+    bool isEnabled{false};
+    std::array<bool, MOTORS_MAX_AMOUNT> motors;     // true if the motor uses this table
+    std::vector<double> inflow;                     // m/sec, strictly increasing
+    std::vector<Cell> cells;                        // (command segment, inflow segment), row major
+
+    size_t findInflowIdx(double& inflowValue) const;
+    size_t findInflowIdx(double& inflowValue, size_t& cursor) const;
+};
+
+/**
+ * @brief Interpolators of the 2-D aerodynamic tables: the rows are along the airspeed,
+ * the columns are along the servo position or AoS
+ * @note It is derived from TablesWithCoeffs once in loadTables() and setAeroTables()
+ */
+struct AeroGrids{
+    using AirspeedAxis = Math::GridAxis<8, Math::UniformSearch>;
+    using ActuatorGrid = Math::GridInterpolator<AirspeedAxis, Math::GridAxis<20>>;
+    using AoSGrid = Math::GridInterpolator<AirspeedAxis, Math::GridAxis<90, Math::BinarySearch>>;
+    using Polynomial = Math::RowInterpolator<AirspeedAxis, 7>;
+    using DragPolynomial = Math::RowInterpolator<AirspeedAxis, 5>;
+
+    Polynomial CLPolynomial;
+    Polynomial CSPolynomial;
+    DragPolynomial CDPolynomial;
+    Polynomial CmxPolynomial;
+    Polynomial CmyPolynomial;
+    Polynomial CmzPolynomial;
+    ActuatorGrid CS_rudder;
+    AoSGrid CS_beta;
+    ActuatorGrid CmxAileron;
+    ActuatorGrid CmyElevator;
+    ActuatorGrid CmzRudder;
+};
+
+/**
+ * @brief Segments found by the previous table lookups of a vehicle, the next lookups hunt from them,
+ * see Math::huntSegmentIdx(). The airspeed, the servos and the motors commands change little
+ * during a step, so a lookup is mostly two comparisons. The cursors don't change the results.
+ * The lookups take them as an argument, the step passes the ones kept by the vehicle.
+ */
+struct TableCursors{
+    static constexpr size_t POLYNOMIALS_AMOUNT = 6;
+
+    std::array<size_t, POLYNOMIALS_AMOUNT> polynomials{};   // CL, CS, CD, Cmx, Cmy, Cmz
+    AeroGrids::ActuatorGrid::Cursor CS_rudder{};
+    AeroGrids::AoSGrid::Cursor CS_beta{};
+    AeroGrids::ActuatorGrid::Cursor CmxAileron{};
+    AeroGrids::ActuatorGrid::Cursor CmyElevator{};
+    AeroGrids::ActuatorGrid::Cursor CmzRudder{};
+    std::array<size_t, MOTORS_MAX_AMOUNT> prop{};
+    std::array<size_t, MOTORS_MAX_AMOUNT> propInflow{};
+};
+
 struct TablesWithCoeffs{
     Eigen::Matrix<double, 8, 20, Eigen::RowMajor> CS_rudder;
     Eigen::Matrix<double, 8, 90, Eigen::RowMajor> CS_beta;
@@ -136,7 +422,10 @@ struct TablesWithCoeffs{
     Eigen::Matrix<double, 8, 20, Eigen::RowMajor> CmyElevator;
     Eigen::Matrix<double, 8, 20, Eigen::RowMajor> CmzRudder;
 
-    Eigen::Matrix<double, 40, 5, Eigen::RowMajor> prop;
+    Eigen::Matrix<double, PROP_TABLE_SIZE, 5, Eigen::RowMajor> prop;
+    PropSegments propSegments;
+    PropInflowCells propInflow;
+    AeroGrids grids;
 
     std::vector<double> actuatorTimeConstants;
 };
@@ -183,17 +472,92 @@ class VtolDynamics : public UavDynamicsSimBase{
          * think about making test as friend
          */
         Eigen::Vector3d calculateNormalForceWithoutMass() const;
-        Eigen::Vector3d calculateWind();
+        /**
+         * @brief Mean wind with the white noise of windVariance, the constant gust and
+         * the Dryden turbulence propagated over dtSecs (it is disabled if gustVariance is zero)
+         */
+        Eigen::Vector3d calculateWind(double dtSecs);
         Eigen::Matrix3d calculateRotationMatrix() const;
         double calculateDynamicPressure(double airSpeedMod) const;
         double calculateAnglesOfAtack(const Eigen::Vector3d& airSpeed) const;
         double calculateAnglesOfSideslip(const Eigen::Vector3d& airSpeed) const;
         void thruster(double actuator, double& thrust, double& torque, double& rpm) const;
+
+        /**
+         * @brief Batched version of thruster() for all motors at once
+         * @param[in] actuators - motors commands, the size should not exceed MOTORS_MAX_AMOUNT
+         * @param[out] thrust, torque, rpm - only first actuators.size() elements are modified
+         */
+        void thrusters(const std::vector<double>& actuators,
+                       std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                       std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                       std::array<double, MOTORS_MAX_AMOUNT>& rpm) const;
+
+        /**
+         * @brief thrusters() that hunts the prop segments from the cursors of the previous call
+         */
+        void thrusters(const std::vector<double>& actuators,
+                       std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                       std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                       std::array<double, MOTORS_MAX_AMOUNT>& rpm,
+                       TableCursors& cursors) const;
+
+        /**
+         * @brief Same as thrusters(), but the motors enabled in PropInflowCells use the 2-D prop table
+         * @param[in] inflow - axial inflow of each motor, m/sec
+         */
+        void thrusters(const std::vector<double>& actuators,
+                       const std::array<double, MOTORS_MAX_AMOUNT>& inflow,
+                       std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                       std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                       std::array<double, MOTORS_MAX_AMOUNT>& rpm) const;
+        void thrusters(const std::vector<double>& actuators,
+                       const std::array<double, MOTORS_MAX_AMOUNT>& inflow,
+                       std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                       std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                       std::array<double, MOTORS_MAX_AMOUNT>& rpm,
+                       TableCursors& cursors) const;
+
+        /**
+         * @brief Enable the 2-D prop table, see PropInflowCells
+         * @param[in] inflow - axial inflow points, m/sec, strictly increasing
+         * @param[in] thrust, torque, rpm - PROP_TABLE_SIZE rows that correspond to the 1-D prop table
+         * commands and a column per inflow point
+         * @param[in] motors - true for the motors that should use the table
+         */
+        void setPropInflowTable(const std::vector<double>& inflow,
+                                const Eigen::MatrixXd& thrust,
+                                const Eigen::MatrixXd& torque,
+                                const Eigen::MatrixXd& rpm,
+                                const std::vector<bool>& motors);
+
         void calculateNewState(const Eigen::Vector3d& Maero,
                                const Eigen::Vector3d& Faero,
                                const std::vector<double>& motors,
                                double dt_sec);
 
+        /**
+         * @brief Integrate the state over dtSecs with the selected integration method.
+         * Motors, servos and wind are held constant, aerodynamics is re-evaluated on each stage.
+         */
+        void proceedState(const Eigen::Vector3d& windNed,
+                          const std::vector<double>& motors,
+                          const std::array<double, 3>& servos,
+                          double dtSecs);
+
+        /**
+         * @brief Per stage force evaluation used by the integrators
+         */
+        void calculateAeroForces(const RigidBodyState& body,
+                                 const Eigen::Vector3d& windNed,
+                                 const std::array<double, 3>& servos,
+                                 Eigen::Vector3d& airspeedFrd,
+                                 Eigen::Vector3d& Faero,
+                                 Eigen::Vector3d& Maero);
+        RigidBodyDerivative calculateRigidBodyDerivative(const RigidBodyState& body,
+                                                         const Eigen::Vector3d& Fbody,
+                                                         const Eigen::Vector3d& Mbody) const;
+
         void calculateAerodynamics(const Eigen::Vector3d& airspeed,
                                    double AoA,
                                    double AoS,
@@ -201,12 +565,22 @@ class VtolDynamics : public UavDynamicsSimBase{
                                    Eigen::Vector3d& Faero,
                                    Eigen::Vector3d& Maero);
 
-        void calculateCLPolynomial(double airSpeedMod, Eigen::VectorXd& polynomialCoeffs) const;
-        void calculateCSPolynomial(double airSpeedMod, Eigen::VectorXd& polynomialCoeffs) const;
-        void calculateCDPolynomial(double airSpeedMod, Eigen::VectorXd& polynomialCoeffs) const;
-        void calculateCmxPolynomial(double airSpeedMod, Eigen::VectorXd& polynomialCoeffs) const;
-        void calculateCmyPolynomial(double airSpeedMod, Eigen::VectorXd& polynomialCoeffs) const;
-        void calculateCmzPolynomial(double airSpeedMod, Eigen::VectorXd& polynomialCoeffs) const;
+        /**
+         * @brief Evaluate all aerodynamic coefficients, the memoized ones if it is enabled
+         * @param[in] airspeedModClamped - m/sec, AoA_deg and AoS_deg - clamped angles in degrees
+         */
+        void calculateAeroCoefficients(double airspeedModClamped,
+                                       double AoA_deg,
+                                       double AoS_deg,
+                                       const std::array<double, 3>& servos,
+                                       AeroCoefficients& coeffs);
+
+        void calculateCLPolynomial(double airSpeedMod, Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const;
+        void calculateCSPolynomial(double airSpeedMod, Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const;
+        void calculateCDPolynomial(double airSpeedMod, Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const;
+        void calculateCmxPolynomial(double airSpeedMod, Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const;
+        void calculateCmyPolynomial(double airSpeedMod, Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const;
+        void calculateCmzPolynomial(double airSpeedMod, Eigen::Ref<Eigen::VectorXd> polynomialCoeffs) const;
 
         double calculateCSRudder(double rudder_pos, double airspeed) const;
         double calculateCSBeta(double AoS_deg, double airspeed) const;
@@ -214,20 +588,234 @@ class VtolDynamics : public UavDynamicsSimBase{
         double calculateCmyElevator(double elevator_pos, double airspeed) const;
         double calculateCmzRudder(double rudder_pos, double airspeed) const;
 
-        Eigen::Vector3d calculateAngularAccel(const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>& inertia,
-                                              const Eigen::Vector3d& moment,
+        Eigen::Vector3d calculateAngularAccel(const Eigen::Vector3d& moment,
                                               const Eigen::Vector3d& prevAngVel) const;
 
         void setWindParameter(Eigen::Vector3d windMeanVelocityNED, double wind_velocityVariance) override;
+        /**
+         * @brief Enable the ground contact model instead of land(), if contact.isEnabled
+         */
+        void setGroundContact(const GroundContact& contact);
+
+        /**
+         * @brief Motor loss and partial thrust limit the motors max speed and the mass shift changes
+         * the mass and the motors positions when the faults change. Prop damage, servo and CG faults
+         * are injected into the step behind one branch on FaultInjector::isActive().
+         */
+        void setFaults(const std::vector<Fault>& faults) override;
+        const FaultInjector& getFaults() const;
+
+        /**
+         * @brief Load the vehicle parameters and the tables into another instance on the calling
+         * thread and stage them with stageVehicle()
+         */
+        int8_t reloadParams() override;
+
+        /**
+         * @return true if the model is compiled with UAV_DYNAMICS_BAKED_VEHICLE, it isn't reloadable then
+         */
+        static bool isBaked();
+
+        /**
+         * @brief Validate the parameters and the tables of a loaded instance and hand a copy of them
+         * to the next process(), which swaps them in before the step. The state, the environment,
+         * the sim settings and the fault schedule are kept.
+         * @return -1 if they don't match this vehicle, e.g. the motors amount differs
+         */
+        int8_t stageVehicle(const VtolDynamics& loaded);
+
+        void setGustParameter(const Eigen::Vector3d& gustVelocityNED, double gustVariance);
+        void setTurbulenceSeed(uint64_t seed);
         void setInitialVelocity(const Eigen::Vector3d& linearVelocity,
                                 const Eigen::Vector3d& angularVelocity);
 
+        /**
+         * @brief Recompute DerivedConstants and invalidate the dt dependent ones.
+         * It is called by loadParams(), but must be also called after any other modification
+         * of the parameters, the tables or the environment.
+         */
+        void updateDerivedConstants();
+
+        void setIntegrationMethod(IntegrationMethod method);
+        void setAdaptiveStepTolerance(double absTolerance, double relTolerance);
+
+        /**
+         * @brief Per channel rate limits (units/sec) and deadbands of the actuators dynamics,
+         * motors first, then servos. An empty vector disables the corresponding limit.
+         */
+        void setActuatorsLimits(const std::vector<double>& rateLimits, const std::vector<double>& deadbands);
+
+        /**
+         * @return Filtered actuators: motors in rad/sec, then aileron, elevator and rudder
+         */
+        const std::vector<double>& getActuators() const;
+
+        /**
+         * @brief Enable memoization of the aerodynamic coefficients, non positive tolerances disable it.
+         * The memoized value and the counters are reset.
+         */
+        void setAeroMemoTolerances(const AeroMemoTolerances& tolerances);
+        uint64_t getAeroMemoHits() const;
+        uint64_t getAeroMemoMisses() const;
+
+        /**
+         * @brief Evaluate the aerodynamics every period steps, see AeroMultiRate.
+         * Zero period is treated as 1. The held values are reset.
+         */
+        void setAeroUpdatePeriod(size_t period, bool isExtrapolated);
+
+        /**
+         * @brief The force and moment model generic over the scalar type, so a forward-mode AD type
+         * (e.g. Eigen::AutoDiffScalar) gives exact Jacobians in one pass. The double methods above
+         * use them, but these ones don't memoize, don't record diagnostics and don't write the state.
+         * @note The tables are piecewise, so the derivatives are the ones of the active segment
+         */
+        template<typename Scalar>
+        Scalar calculateAnglesOfAtackT(const Vector3T<Scalar>& airspeed) const;
+        template<typename Scalar>
+        Scalar calculateAnglesOfSideslipT(const Vector3T<Scalar>& airspeed) const;
+        template<typename Scalar>
+        void calculateAerodynamicsT(const Vector3T<Scalar>& airspeed,
+                                    const Scalar& AoA,
+                                    const Scalar& AoS,
+                                    const std::array<Scalar, 3>& servos,
+                                    Vector3T<Scalar>& Faero,
+                                    Vector3T<Scalar>& Maero) const;
+        template<typename Scalar>
+        void thrusterT(const Scalar& actuator, Scalar& thrust, Scalar& torque, Scalar& rpm) const;
+        template<typename Scalar>
+        Vector3T<Scalar> calculateAngularAccelT(const Vector3T<Scalar>& moment,
+                                                const Vector3T<Scalar>& prevAngVel) const;
+
+        /**
+         * @brief Accelerations with the actuators held at the unitless setpoint of process(),
+         * i.e. without the actuators lag, the wind noise and the ground. It is the model of VtolTrimModel.
+         * @param[out] linearAccel - NED, m/sec^2, angularAccel - FRD, rad/sec^2
+         */
+        void calculateSteadyAccelerations(const RigidBodyState& body,
+                                          const Eigen::Vector3d& windNed,
+                                          const std::vector<double>& unitlessSetpoint,
+                                          Eigen::Vector3d& linearAccel,
+                                          Eigen::Vector3d& angularAccel);
+
+        /**
+         * @note Read-only access to the loaded model, e.g. for VtolFleet
+         */
+        const VtolParameters& getParameters() const;
+        const TablesWithCoeffs& getTables() const;
+        const Environment& getEnvironment() const;
+
+        /**
+         * @brief Replace the aerodynamic tables, e.g. with the ones of VtolAeroIdentification.
+         * The prop table and the actuators time constants are kept.
+         */
+        void setAeroTables(const TablesWithCoeffs& tables);
+
+        /**
+         * @brief Unitless setpoint of process() to the motors speed, rad/sec, and the servos, deg
+         */
+        void mapUnitlessSetpoint(const std::vector<double>& cmd,
+                                 std::vector<double>& motors,
+                                 std::array<double, 3>& servos) const;
+
     private:
+        int8_t loadVehicleWithCache(const std::string& cachePath, const std::vector<std::string>& sources);
         void loadTables(const std::string& path);
         void loadParams(const std::string& path);
         void loadMotorsGeometry(const std::string& path);
+        void loadGroundContact(const std::string& path);
+        void calculatePropSegments();
+        void calculateAeroGrids();
+        void loadPropInflowTable(const std::string& path);
+        void evaluateAeroCoefficients(double airspeedModClamped,
+                                      double AoA_deg,
+                                      double AoS_deg,
+                                      const std::array<double, 3>& servos,
+                                      AeroCoefficients& coeffs,
+                                      TableCursors& cursors) const;
+        template<typename Scalar>
+        void evaluateAeroCoefficientsT(const Scalar& airspeedModClamped,
+                                       const Scalar& AoA_deg,
+                                       const Scalar& AoS_deg,
+                                       const std::array<Scalar, 3>& servos,
+                                       AeroCoefficientsT<Scalar>& coeffs,
+                                       TableCursors& cursors) const;
+
+        /**
+         * @brief Aerodynamic force and moment by the coefficients
+         * @param[out] FL, FS, FD - lift, side and drag directions scaled by their coefficients
+         */
+        template<typename Scalar>
+        void calculateAeroForceAndMoment(const Vector3T<Scalar>& airspeed,
+                                         const AeroCoefficientsT<Scalar>& coeffs,
+                                         const std::array<Scalar, 3>& servos,
+                                         Vector3T<Scalar>& FL,
+                                         Vector3T<Scalar>& FS,
+                                         Vector3T<Scalar>& FD,
+                                         Vector3T<Scalar>& Faero,
+                                         Vector3T<Scalar>& Maero) const;
+        void updateActuatorsGain(double dtSecs);
         void _mapUnitlessSetpointToInternal(const std::vector<double>& cmd);
         void updateActuators(double dtSecs);
+        void applyFaults(const FaultEffects& effects);
+        void injectServoFaults();
+        void saveFaultNominalParams();
+        void updateTurbulenceCoefficients(double dtSecs);
+
+        /**
+         * @brief calculateAeroForces() on the steps of the AeroMultiRate period,
+         * held or extrapolated aerodynamics with the actual airspeed otherwise
+         */
+        void calculateMultiRateAeroForces(const RigidBodyState& body,
+                                          const Eigen::Vector3d& windNed,
+                                          const std::array<double, 3>& servos,
+                                          Eigen::Vector3d& airspeedFrd,
+                                          Eigen::Vector3d& Faero,
+                                          Eigen::Vector3d& Maero);
+
+        /**
+         * @brief Either the ground contact or land() after the flight integration step
+         * @param[in] Fspecific - FRD, specific force of the step without the ground reaction
+         */
+        void proceedGround(const Eigen::Vector3d& Fspecific, double dtSecs);
+
+        /**
+         * @brief Update the velocities, the position and the attitude with the contact impulses
+         * @param positionGain - share of the velocity change applied to the position of this step
+         * @return The ground reaction force, NED, N
+         */
+        Eigen::Vector3d applyGroundContact(double dtSecs, double positionGain);
+        void calculateMotorsForcesAndMoments(const std::vector<double>& motors,
+                                             Eigen::Vector3d& Fmotors,
+                                             Eigen::Vector3d& Mmotors);
+
+        /**
+         * @brief calculateMotorsForcesAndMoments() and thrusters() with the motors amount known
+         * at compile time, so the loops are unrolled. MotorsAmount = 0 means the size of motors.
+         */
+        template<size_t MotorsAmount>
+        void calculateMotorsForcesAndMomentsN(const std::vector<double>& motors,
+                                              Eigen::Vector3d& Fmotors,
+                                              Eigen::Vector3d& Mmotors);
+        template<size_t MotorsAmount>
+        void thrustersN(const std::vector<double>& actuators,
+                        std::array<double, MOTORS_MAX_AMOUNT>& thrust,
+                        std::array<double, MOTORS_MAX_AMOUNT>& torque,
+                        std::array<double, MOTORS_MAX_AMOUNT>& rpm,
+                        TableCursors& cursors) const;
+        RigidBodyDerivative evaluateStage(const RigidBodyState& body, const StepInputs& inputs);
+        RigidBodyState integrateSemiImplicitEuler(const RigidBodyState& body,
+                                                  const RigidBodyDerivative& k1,
+                                                  const Eigen::Vector3d& Fbody,
+                                                  double dtSecs) const;
+        RigidBodyState integrateRK4(const RigidBodyState& body,
+                                    const RigidBodyDerivative& k1,
+                                    const StepInputs& inputs,
+                                    double dtSecs);
+        RigidBodyState integrateRK45(const RigidBodyState& body,
+                                     const RigidBodyDerivative& k1,
+                                     const StepInputs& inputs,
+                                     double dtSecs);
         Eigen::Vector3d calculateAirSpeed(const Eigen::Matrix3d& rotationMatrix,
                                           const Eigen::Vector3d& estimatedVelocity,
                                           const Eigen::Vector3d& windSpeed) const;
@@ -235,13 +823,206 @@ class VtolDynamics : public UavDynamicsSimBase{
         std::vector<double> _motorsSpeed;
         std::array<double, 3> _servosValues{0.0, 0.0, 0.0};
 
+        using MotorsForcesAndMomentsFn = void (VtolDynamics::*)(const std::vector<double>&,
+                                                               Eigen::Vector3d&,
+                                                               Eigen::Vector3d&);
+        MotorsForcesAndMomentsFn _motorsForcesAndMoments{nullptr};  // picked by loadMotorsGeometry()
+
+        struct StagedVehicle{
+            VtolParameters params;
+            TablesWithCoeffs tables;
+            MotorsForcesAndMomentsFn motorsForcesAndMoments;
+        };
+        void applyStagedVehicle(StagedVehicle& staged);
+
         VtolParameters _params;
         State _state;
         TablesWithCoeffs _tables;
         Environment _environment;
 
+        IntegrationMethod _integrationMethod{IntegrationMethod::EULER};
+        double _adaptiveStepSecs{0.0};              // last accepted RK45 substep, 0 if unknown
+        double _adaptiveAbsTolerance{1e-6};
+        double _adaptiveRelTolerance{1e-6};
+
+        AeroMemo _aeroMemo;
+        TableCursors _cursors;                      // of the step, the const lookups take their own
+        AeroMultiRate _aeroMultiRate;
+        DrydenTurbulence _turbulence;
+        FaultInjector _faults;
+        FaultNominalParams _faultNominal;
+        StagedUpdate<StagedVehicle> _stagedVehicle;  // posted by stageVehicle(), taken by process()
+
         std::default_random_engine _generator;
         std::normal_distribution<double> _distribution{0.0, 1.0};
 };
 
+template<typename Scalar>
+Scalar VtolDynamics::calculateAnglesOfAtackT(const Vector3T<Scalar>& airspeed_frd) const{
+    using std::sqrt;
+    using std::asin;
+    Scalar A = sqrt(airspeed_frd[0] * airspeed_frd[0] + airspeed_frd[2] * airspeed_frd[2]);
+    if(A < 0.001){
+        return Scalar(0);
+    }
+    A = airspeed_frd[2] / A;
+    A = std::clamp(A, Scalar(-1.0), Scalar(+1.0));
+    if(airspeed_frd[0] > 0){
+        A = asin(A);
+    }else{
+        A = 3.1415 - asin(A);
+    }
+    if(A > 3.1415){
+        A = A - 2 * 3.1415;
+    }
+    return A;
+}
+
+template<typename Scalar>
+Scalar VtolDynamics::calculateAnglesOfSideslipT(const Vector3T<Scalar>& airspeed_frd) const{
+    using std::asin;
+    Scalar B = airspeed_frd.norm();
+    if(B < 0.001){
+        return Scalar(0);
+    }
+    B = airspeed_frd[1] / B;
+    B = std::clamp(B, Scalar(-1.0), Scalar(+1.0));
+    return asin(B);
+}
+
+template<typename Scalar>
+void VtolDynamics::calculateAerodynamicsT(const Vector3T<Scalar>& airspeed,
+                                          const Scalar& AoA,
+                                          const Scalar& AoS,
+                                          const std::array<Scalar, 3>& servos,
+                                          Vector3T<Scalar>& Faero,
+                                          Vector3T<Scalar>& Maero) const{
+    using std::sqrt;
+    Scalar AoA_deg = std::clamp(Scalar(AoA * 180 / 3.1415), Scalar(-45.0), Scalar(+45.0));
+    Scalar AoS_deg = std::clamp(Scalar(AoS * 180 / 3.1415), Scalar(-90.0), Scalar(+90.0));
+    Scalar airspeedModClamped = std::clamp(Scalar(sqrt(airspeed.squaredNorm())), Scalar(5.0), Scalar(40.0));
+
+    AeroCoefficientsT<Scalar> coeffs;
+    TableCursors cursors;
+    evaluateAeroCoefficientsT(airspeedModClamped, AoA_deg, AoS_deg, servos, coeffs, cursors);
+
+    Vector3T<Scalar> FL;
+    Vector3T<Scalar> FS;
+    Vector3T<Scalar> FD;
+    calculateAeroForceAndMoment(airspeed, coeffs, servos, FL, FS, FD, Faero, Maero);
+}
+
+template<typename Scalar>
+void VtolDynamics::evaluateAeroCoefficientsT(const Scalar& airspeedModClamped,
+                                             const Scalar& AoA_deg,
+                                             const Scalar& AoS_deg,
+                                             const std::array<Scalar, 3>& servos,
+                                             AeroCoefficientsT<Scalar>& coeffs,
+                                             TableCursors& cursors) const{
+    using std::abs;
+    const auto& grids = _tables.grids;
+    Eigen::Matrix<Scalar, 7, 1> polynomialCoeffs;
+
+    grids.CLPolynomial.evaluate(airspeedModClamped, polynomialCoeffs, cursors.polynomials[0]);
+    coeffs.CL = Math::polyval(polynomialCoeffs, AoA_deg);
+
+    grids.CSPolynomial.evaluate(airspeedModClamped, polynomialCoeffs, cursors.polynomials[1]);
+    coeffs.CS = Math::polyval(polynomialCoeffs, AoA_deg) +
+                grids.CS_rudder.evaluate<Scalar>({airspeedModClamped, servos[RUDDERS_INDEX]}, cursors.CS_rudder) +
+                grids.CS_beta.evaluate<Scalar>({airspeedModClamped, AoS_deg}, cursors.CS_beta);
+
+    grids.CDPolynomial.evaluate(airspeedModClamped, polynomialCoeffs, cursors.polynomials[2]);
+    coeffs.CD = Math::polyval(polynomialCoeffs.template block<5, 1>(0, 0), AoA_deg);
+
+    grids.CmxPolynomial.evaluate(airspeedModClamped, polynomialCoeffs, cursors.polynomials[3]);
+    coeffs.Cmx = Math::polyval(polynomialCoeffs, AoA_deg);
+
+    grids.CmyPolynomial.evaluate(airspeedModClamped, polynomialCoeffs, cursors.polynomials[4]);
+    coeffs.Cmy = Math::polyval(polynomialCoeffs, AoA_deg);
+
+    grids.CmzPolynomial.evaluate(airspeedModClamped, polynomialCoeffs, cursors.polynomials[5]);
+    coeffs.Cmz = -Math::polyval(polynomialCoeffs, AoA_deg);
+
+    coeffs.CmxAileron = grids.CmxAileron.evaluate<Scalar>({airspeedModClamped, servos[AILERONS_INDEX]},
+                                                          cursors.CmxAileron);
+    /**
+     * @note InnoDynamics from octave has some mistake in elevator logic
+     * It always generate non positive moment in both positive and negative position
+     * Temporary decision is to create positive moment in positive position and
+     * negative moment in negative position
+     */
+    coeffs.CmyElevator = grids.CmyElevator.evaluate<Scalar>({airspeedModClamped, Scalar(abs(servos[ELEVATORS_INDEX]))},
+                                                            cursors.CmyElevator);
+    coeffs.CmzRudder = grids.CmzRudder.evaluate<Scalar>({airspeedModClamped, servos[RUDDERS_INDEX]},
+                                                        cursors.CmzRudder);
+}
+
+template<typename Scalar>
+void VtolDynamics::calculateAeroForceAndMoment(const Vector3T<Scalar>& airspeed,
+                                               const AeroCoefficientsT<Scalar>& coeffs,
+                                               const std::array<Scalar, 3>& servos,
+                                               Vector3T<Scalar>& FL,
+                                               Vector3T<Scalar>& FS,
+                                               Vector3T<Scalar>& FD,
+                                               Vector3T<Scalar>& Faero,
+                                               Vector3T<Scalar>& Maero) const{
+    const Scalar airspeedSquared = airspeed.squaredNorm();
+    const Scalar forceFactor = _params.derived.aeroForceFactor * airspeedSquared;
+    const Scalar momentFactor = _params.derived.aeroMomentFactor * airspeedSquared;
+    const Vector3T<Scalar> pitchAxis(Scalar(0), Scalar(1), Scalar(0));
+
+    // 1. Calculate aero force
+    FL = (pitchAxis.cross(airspeed.normalized())) * coeffs.CL;
+    FS = airspeed.cross(pitchAxis.cross(airspeed.normalized())) * coeffs.CS;
+    FD = (-1 * airspeed).normalized() * coeffs.CD;
+    Faero = forceFactor * (FL + FS + FD);
+
+    // 2. Calculate aero moment
+    Scalar Mx = coeffs.Cmx + coeffs.CmxAileron * servos[AILERONS_INDEX];
+    Scalar My = coeffs.Cmy + coeffs.CmyElevator * servos[ELEVATORS_INDEX];
+    Scalar Mz = coeffs.Cmz + coeffs.CmzRudder * servos[RUDDERS_INDEX];
+
+    Maero = momentFactor * Vector3T<Scalar>(Mx, My, Mz);
+}
+
+template<typename Scalar>
+void VtolDynamics::thrusterT(const Scalar& actuator, Scalar& thrust, Scalar& torque, Scalar& rpm) const{
+    const auto& segments = _tables.propSegments;
+    size_t idx = segments.findSegmentIdx(Math::getValue(actuator));
+    Scalar delta = actuator - segments.control[idx];
+    thrust = segments.thrust[idx] + delta * segments.thrustSlope[idx];
+    torque = segments.torque[idx] + delta * segments.torqueSlope[idx];
+    rpm = segments.rpm[idx] + delta * segments.rpmSlope[idx];
+}
+
+template<typename Scalar>
+Vector3T<Scalar> VtolDynamics::calculateAngularAccelT(const Vector3T<Scalar>& moment,
+                                                      const Vector3T<Scalar>& prevAngVel) const{
+    const Eigen::Matrix<Scalar, 3, 3> inertia = _params.inertia.template cast<Scalar>();
+    const Eigen::Matrix<Scalar, 3, 3> inertiaInv = _params.derived.inertiaInv.template cast<Scalar>();
+    return inertiaInv * (moment - prevAngVel.cross(inertia * prevAngVel));
+}
+
+/**
+ * @brief TrimSolver model of a copy of VtolDynamics, the aerodynamic memoization is disabled
+ * because it would quantize the finite differences
+ */
+class VtolTrimModel : public TrimModel{
+    public:
+        explicit VtolTrimModel(const VtolDynamics& dynamics);
+
+        std::unique_ptr<TrimModel> clone() const override;
+        size_t getSetpointsAmount() const override;
+        void getSetpointLimits(Eigen::VectorXd& lower, Eigen::VectorXd& upper) const override;
+        void calculateAccelerations(const Eigen::Vector3d& linearVelNed,
+                                    const Eigen::Quaterniond& attitude,
+                                    const Eigen::Vector3d& angularVel,
+                                    const std::vector<double>& setpoint,
+                                    Eigen::Vector3d& linearAccel,
+                                    Eigen::Vector3d& angularAccel) override;
+
+    private:
+        VtolDynamics _dynamics;
+};
+
 #endif  // VTOL_DYNAMICS_SIM_H
@@ -0,0 +1,482 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#include "vtolFleet.hpp"
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+static constexpr size_t CL_POLYNOMIAL_IDX = 0;
+static constexpr size_t CS_POLYNOMIAL_IDX = 1;
+static constexpr size_t CD_POLYNOMIAL_IDX = 2;
+static constexpr size_t CMX_POLYNOMIAL_IDX = 3;
+static constexpr size_t CMY_POLYNOMIAL_IDX = 4;
+static constexpr size_t CMZ_POLYNOMIAL_IDX = 5;
+
+template<typename Scalar>
+VtolFleetT<Scalar>::VtolFleetT(const VtolDynamics& prototype, size_t vehiclesAmount) :
+        _vehiclesAmount(vehiclesAmount){
+    const auto& params = prototype.getParameters();
+    const auto& tables = prototype.getTables();
+    const auto& environment = prototype.getEnvironment();
+
+    _motorsAmount = params.geometry.size();
+    _mass = params.mass;
+    _gravity = environment.gravity;
+    _inertia = params.inertia.cast<Scalar>();
+    _inertiaInv = params.derived.inertiaInv.cast<Scalar>();
+    _aeroForceFactor = params.derived.aeroForceFactor;
+    _aeroMomentFactor = params.derived.aeroMomentFactor;
+    _motorMaxSpeed.assign(params.motorMaxSpeed.begin(), params.motorMaxSpeed.end());
+    std::copy_n(params.servoRange.begin(), SERVOS_AMOUNT, _servoRange.begin());
+    _actuatorTimeConstants = tables.actuatorTimeConstants;
+    _actuatorRateLimits.assign(params.actuatorRateLimits.begin(),
+                               params.actuatorRateLimits.begin() + _actuatorTimeConstants.size());
+    _actuatorDeadbands.assign(params.actuatorDeadbands.begin(),
+                              params.actuatorDeadbands.begin() + _actuatorTimeConstants.size());
+    _actuatorsGain.resize(_actuatorTimeConstants.size());
+    _actuatorsMaxDelta.resize(_actuatorTimeConstants.size());
+
+    _forceAxis.resize(3, _motorsAmount);
+    _thrustMomentArm.resize(3, _motorsAmount);
+    _torqueAxis.resize(3, _motorsAmount);
+    for(size_t motor_idx = 0; motor_idx < _motorsAmount; motor_idx++){
+        const auto& geometry = params.geometry[motor_idx];
+        double ccw = geometry.directionCCW ? 1.0 : -1.0;
+        _forceAxis.col(motor_idx) = geometry.axis.cast<Scalar>();
+        _thrustMomentArm.col(motor_idx) = geometry.position.cross(geometry.axis).cast<Scalar>();
+        _torqueAxis.col(motor_idx) = (geometry.axis * (-1.0) * ccw).cast<Scalar>();
+    }
+
+    _propSegments = tables.propSegments;
+    _grids = tables.grids;
+    _cursors.resize(vehiclesAmount);
+
+    for(auto row : {&_state.positionX, &_state.positionY, &_state.positionZ,
+                    &_state.linearVelX, &_state.linearVelY, &_state.linearVelZ,
+                    &_state.attitudeX, &_state.attitudeY, &_state.attitudeZ,
+                    &_state.angularVelX, &_state.angularVelY, &_state.angularVelZ,
+                    &_state.airspeedX, &_state.airspeedY, &_state.airspeedZ,
+                    &_windX, &_windY, &_windZ}){
+        row->setZero(vehiclesAmount);
+    }
+    _state.attitudeW.setOnes(vehiclesAmount);
+    _state.motorsSpeed.setZero(_motorsAmount, vehiclesAmount);
+    _state.motorsRpm.setZero(_motorsAmount, vehiclesAmount);
+    _state.servos.setZero(SERVOS_AMOUNT, vehiclesAmount);
+
+    _actuatorsCmd.setZero(_motorsAmount + SERVOS_AMOUNT, vehiclesAmount);
+    _thrust.setZero(_motorsAmount, vehiclesAmount);
+    _torque.setZero(_motorsAmount, vehiclesAmount);
+    _rotation.setZero(9, vehiclesAmount);
+    _attitudeDelta.setZero(6, vehiclesAmount);
+    for(auto row : {&_FmotorsX, &_FmotorsY, &_FmotorsZ, &_MmotorsX, &_MmotorsY, &_MmotorsZ,
+                    &_FaeroX, &_FaeroY, &_FaeroZ, &_MaeroX, &_MaeroY, &_MaeroZ,
+                    &_AoADeg, &_AoSDeg, &_airspeedMod, &_airspeedSquared, &_CL, &_CS, &_CD}){
+        row->setZero(vehiclesAmount);
+    }
+}
+
+template<typename Scalar>
+size_t VtolFleetT<Scalar>::getVehiclesAmount() const{
+    return _vehiclesAmount;
+}
+template<typename Scalar>
+size_t VtolFleetT<Scalar>::getMotorsAmount() const{
+    return _motorsAmount;
+}
+
+template<typename Scalar>
+void VtolFleetT<Scalar>::setVehicleState(size_t vehicleIdx,
+                                         const Eigen::Vector3d& position,
+                                         const Eigen::Quaterniond& attitude,
+                                         const Eigen::Vector3d& linearVelocity,
+                                         const Eigen::Vector3d& angularVelocity){
+    assert(vehicleIdx < _vehiclesAmount);
+    _state.positionX[vehicleIdx] = position[0];
+    _state.positionY[vehicleIdx] = position[1];
+    _state.positionZ[vehicleIdx] = position[2];
+    _state.attitudeW[vehicleIdx] = attitude.w();
+    _state.attitudeX[vehicleIdx] = attitude.x();
+    _state.attitudeY[vehicleIdx] = attitude.y();
+    _state.attitudeZ[vehicleIdx] = attitude.z();
+    _state.linearVelX[vehicleIdx] = linearVelocity[0];
+    _state.linearVelY[vehicleIdx] = linearVelocity[1];
+    _state.linearVelZ[vehicleIdx] = linearVelocity[2];
+    _state.angularVelX[vehicleIdx] = angularVelocity[0];
+    _state.angularVelY[vehicleIdx] = angularVelocity[1];
+    _state.angularVelZ[vehicleIdx] = angularVelocity[2];
+}
+
+template<typename Scalar>
+void VtolFleetT<Scalar>::setWind(size_t vehicleIdx, const Eigen::Vector3d& windNed){
+    assert(vehicleIdx < _vehiclesAmount);
+    _windX[vehicleIdx] = windNed[0];
+    _windY[vehicleIdx] = windNed[1];
+    _windZ[vehicleIdx] = windNed[2];
+}
+
+template<typename Scalar>
+void VtolFleetT<Scalar>::process(double dtSecs, const FleetArray& setpoints){
+    assert(static_cast<size_t>(setpoints.cols()) == _vehiclesAmount);
+    updateActuators(dtSecs, setpoints);
+    calculateMotorsForcesAndMoments();
+    calculateRotationMatrices();
+    calculateAirspeed();
+    calculateAerodynamics();
+    calculateNewState(dtSecs);
+}
+
+/**
+ * @brief Same coefficients as VtolDynamics::updateActuatorsGain()
+ */
+template<typename Scalar>
+void VtolFleetT<Scalar>::updateActuatorsGain(double dtSecs){
+    for(size_t idx = 0; idx < _actuatorTimeConstants.size(); idx++){
+        _actuatorsGain[idx] = static_cast<Scalar>(1 - std::exp(-dtSecs / _actuatorTimeConstants[idx]));
+        const double rateLimit = _actuatorRateLimits[idx];
+        _actuatorsMaxDelta[idx] = rateLimit > 0 ? rateLimit * static_cast<Scalar>(dtSecs) :
+                                                  std::numeric_limits<Scalar>::max();
+    }
+    _actuatorsDtSecs = dtSecs;
+}
+
+/**
+ * @brief Setpoints are mapped as in VtolDynamics::_mapUnitlessSetpointToInternal(),
+ * missing rows follow the Implicit Zero Extension rule. Then all channels are filtered
+ * as in VtolDynamics::updateActuators().
+ */
+template<typename Scalar>
+void VtolFleetT<Scalar>::updateActuators(double dtSecs, const FleetArray& setpoints){
+    if(dtSecs != _actuatorsDtSecs){
+        updateActuatorsGain(dtSecs);
+    }
+
+    const size_t setpointsAmount = setpoints.rows();
+    for(size_t motor_idx = 0; motor_idx < _motorsAmount; motor_idx++){
+        if(motor_idx < setpointsAmount){
+            _actuatorsCmd.row(motor_idx) = setpoints.row(motor_idx).max(0.0).min(1.0) * _motorMaxSpeed[motor_idx];
+        }else{
+            _actuatorsCmd.row(motor_idx).setZero();
+        }
+    }
+    for(size_t servo_idx = 0; servo_idx < SERVOS_AMOUNT; servo_idx++){
+        const size_t setpoint_idx = _motorsAmount + servo_idx;
+        if(setpoint_idx < setpointsAmount){
+            _actuatorsCmd.row(setpoint_idx) = setpoints.row(setpoint_idx).max(-1.0).min(1.0) * _servoRange[servo_idx];
+        }else{
+            _actuatorsCmd.row(setpoint_idx).setZero();
+        }
+    }
+    _actuatorsCmd.row(_motorsAmount + ELEVATORS_INDEX) *= -1;  // elevator is inverted
+
+    for(size_t channel_idx = 0; channel_idx < _actuatorsGain.size(); channel_idx++){
+        auto output = channel_idx < _motorsAmount ? _state.motorsSpeed.row(channel_idx) :
+                                                    _state.servos.row(channel_idx - _motorsAmount);
+        auto delta = _actuatorsCmd.row(channel_idx);
+        delta -= output;
+        delta = (delta.abs() > _actuatorDeadbands[channel_idx]).select(delta, 0.0);
+        output += (delta * _actuatorsGain[channel_idx]).max(-_actuatorsMaxDelta[channel_idx])
+                                                       .min(_actuatorsMaxDelta[channel_idx]);
+    }
+}
+
+template<typename Scalar>
+void VtolFleetT<Scalar>::calculateMotorsForcesAndMoments(){
+    const auto& segments = _propSegments;
+    for(size_t motor_idx = 0; motor_idx < _motorsAmount; motor_idx++){
+        for(size_t vehicle_idx = 0; vehicle_idx < _vehiclesAmount; vehicle_idx++){
+            const double actuator = _state.motorsSpeed(motor_idx, vehicle_idx);
+            const size_t idx = segments.findSegmentIdx(actuator);
+            const double delta = actuator - segments.control[idx];
+            _thrust(motor_idx, vehicle_idx) = segments.thrust[idx] + delta * segments.thrustSlope[idx];
+            _torque(motor_idx, vehicle_idx) = segments.torque[idx] + delta * segments.torqueSlope[idx];
+            _state.motorsRpm(motor_idx, vehicle_idx) = segments.rpm[idx] + delta * segments.rpmSlope[idx];
+        }
+    }
+
+    _FmotorsX.setZero();
+    _FmotorsY.setZero();
+    _FmotorsZ.setZero();
+    _MmotorsX.setZero();
+    _MmotorsY.setZero();
+    _MmotorsZ.setZero();
+    for(size_t motor_idx = 0; motor_idx < _motorsAmount; motor_idx++){
+        const auto thrust = _thrust.row(motor_idx);
+        const auto torque = _torque.row(motor_idx);
+        _FmotorsX += _forceAxis(0, motor_idx) * thrust;
+        _FmotorsY += _forceAxis(1, motor_idx) * thrust;
+        _FmotorsZ += _forceAxis(2, motor_idx) * thrust;
+        _MmotorsX += _thrustMomentArm(0, motor_idx) * thrust + _torqueAxis(0, motor_idx) * torque;
+        _MmotorsY += _thrustMomentArm(1, motor_idx) * thrust + _torqueAxis(1, motor_idx) * torque;
+        _MmotorsZ += _thrustMomentArm(2, motor_idx) * thrust + _torqueAxis(2, motor_idx) * torque;
+    }
+}
+
+/**
+ * @brief Same as Eigen::Quaterniond::toRotationMatrix() for each vehicle
+ */
+template<typename Scalar>
+void VtolFleetT<Scalar>::calculateRotationMatrices(){
+    const auto& w = _state.attitudeW;
+    const auto& x = _state.attitudeX;
+    const auto& y = _state.attitudeY;
+    const auto& z = _state.attitudeZ;
+    _rotation.row(0) = 1.0 - 2.0 * (y * y + z * z);
+    _rotation.row(1) = 2.0 * (x * y - z * w);
+    _rotation.row(2) = 2.0 * (x * z + y * w);
+    _rotation.row(3) = 2.0 * (x * y + z * w);
+    _rotation.row(4) = 1.0 - 2.0 * (x * x + z * z);
+    _rotation.row(5) = 2.0 * (y * z - x * w);
+    _rotation.row(6) = 2.0 * (x * z - y * w);
+    _rotation.row(7) = 2.0 * (y * z + x * w);
+    _rotation.row(8) = 1.0 - 2.0 * (x * x + y * y);
+}
+
+/**
+ * @brief Airspeed in FRD, AoA and AoS in degrees as in VtolDynamics::calculateAeroForces()
+ */
+template<typename Scalar>
+void VtolFleetT<Scalar>::calculateAirspeed(){
+    constexpr double PI = 3.1415;
+    constexpr double AIRSPEED_LIMIT = 40.0;
+    const auto velX = _state.linearVelX + _windX;
+    const auto velY = _state.linearVelY + _windY;
+    const auto velZ = _state.linearVelZ + _windZ;
+    auto& airspeedX = _state.airspeedX;
+    auto& airspeedY = _state.airspeedY;
+    auto& airspeedZ = _state.airspeedZ;
+    airspeedX = (_rotation.row(0) * velX + _rotation.row(3) * velY + _rotation.row(6) * velZ)
+                .max(-AIRSPEED_LIMIT).min(AIRSPEED_LIMIT);
+    airspeedY = (_rotation.row(1) * velX + _rotation.row(4) * velY + _rotation.row(7) * velZ)
+                .max(-AIRSPEED_LIMIT).min(AIRSPEED_LIMIT);
+    airspeedZ = (_rotation.row(2) * velX + _rotation.row(5) * velY + _rotation.row(8) * velZ)
+                .max(-AIRSPEED_LIMIT).min(AIRSPEED_LIMIT);
+
+    _airspeedSquared = airspeedX.square() + airspeedY.square() + airspeedZ.square();
+    _airspeedMod = _airspeedSquared.sqrt().max(5.0).min(40.0);
+
+    const auto xzMod = (airspeedX.square() + airspeedZ.square()).sqrt();
+    const auto AoASin = (airspeedZ / xzMod).max(-1.0).min(1.0).asin();
+    _AoADeg = (airspeedX > 0).select(AoASin, PI - AoASin);
+    _AoADeg = (_AoADeg > PI).select(_AoADeg - 2 * PI, _AoADeg);
+    _AoADeg = (xzMod < 0.001).select(0.0, _AoADeg * 180 / PI).max(-45.0).min(45.0);
+
+    const auto mod = _airspeedSquared.sqrt();
+    const auto AoS = (airspeedY / mod).max(-1.0).min(1.0).asin();
+    _AoSDeg = (mod < 0.001).select(0.0, AoS * 180 / PI).max(-90.0).min(90.0);
+}
+
+/**
+ * @brief The coefficients are interpolated by the airspeed as in VtolDynamics::evaluateAeroCoefficients(),
+ * then the polynomial is evaluated by the Horner scheme
+ */
+template<typename Scalar>
+template<typename Polynomial>
+Scalar VtolFleetT<Scalar>::evaluatePolynomial(const Polynomial& polynomial,
+                                              Scalar airspeed,
+                                              Scalar AoA_deg,
+                                              size_t& cursor){
+    Eigen::Matrix<Scalar, Polynomial::COLS, 1> coeffs;
+    polynomial.evaluate(airspeed, coeffs, cursor);
+
+    Scalar result = 0;
+    for(size_t coeff_idx = 0; coeff_idx < Polynomial::COLS; coeff_idx++){
+        result = result * AoA_deg + coeffs[coeff_idx];
+    }
+    return result;
+}
+
+/**
+ * @brief Same model as VtolDynamics::calculateAerodynamics(). The table lookups are done
+ * per vehicle with its own cursors, the remaining arithmetic over all vehicles at once.
+ */
+template<typename Scalar>
+void VtolFleetT<Scalar>::calculateAerodynamics(){
+    const auto& grids = _grids;
+    for(size_t vehicle_idx = 0; vehicle_idx < _vehiclesAmount; vehicle_idx++){
+        auto& cursors = _cursors[vehicle_idx];
+        const Scalar airspeed = _airspeedMod[vehicle_idx];
+        const Scalar AoA_deg = _AoADeg[vehicle_idx];
+        const Scalar aileron = _state.servos(AILERONS_INDEX, vehicle_idx);
+        const Scalar elevator = _state.servos(ELEVATORS_INDEX, vehicle_idx);
+        const Scalar rudder = _state.servos(RUDDERS_INDEX, vehicle_idx);
+
+        const Scalar CL = evaluatePolynomial(grids.CLPolynomial, airspeed, AoA_deg,
+                                             cursors.polynomials[CL_POLYNOMIAL_IDX]);
+        const Scalar CS = evaluatePolynomial(grids.CSPolynomial, airspeed, AoA_deg,
+                                             cursors.polynomials[CS_POLYNOMIAL_IDX]) +
+                          grids.CS_rudder.evaluate<Scalar>({airspeed, rudder}, cursors.CS_rudder) +
+                          grids.CS_beta.evaluate<Scalar>({airspeed, _AoSDeg[vehicle_idx]}, cursors.CS_beta);
+        const Scalar CD = evaluatePolynomial(grids.CDPolynomial, airspeed, AoA_deg,
+                                             cursors.polynomials[CD_POLYNOMIAL_IDX]);
+
+        const Scalar Cmx = evaluatePolynomial(grids.CmxPolynomial, airspeed, AoA_deg,
+                                              cursors.polynomials[CMX_POLYNOMIAL_IDX]);
+        const Scalar Cmy = evaluatePolynomial(grids.CmyPolynomial, airspeed, AoA_deg,
+                                              cursors.polynomials[CMY_POLYNOMIAL_IDX]);
+        const Scalar Cmz = -evaluatePolynomial(grids.CmzPolynomial, airspeed, AoA_deg,
+                                               cursors.polynomials[CMZ_POLYNOMIAL_IDX]);
+        const Scalar Cmx_aileron = grids.CmxAileron.evaluate<Scalar>({airspeed, aileron}, cursors.CmxAileron);
+        const Scalar Cmy_elevator = grids.CmyElevator.evaluate<Scalar>({airspeed, std::abs(elevator)},
+                                                                       cursors.CmyElevator);
+        const Scalar Cmz_rudder = grids.CmzRudder.evaluate<Scalar>({airspeed, rudder}, cursors.CmzRudder);
+
+        _CL[vehicle_idx] = CL;
+        _CS[vehicle_idx] = CS;
+        _CD[vehicle_idx] = CD;
+        _MaeroX[vehicle_idx] = Cmx + Cmx_aileron * aileron;
+        _MaeroY[vehicle_idx] = Cmy + Cmy_elevator * elevator;
+        _MaeroZ[vehicle_idx] = Cmz + Cmz_rudder * rudder;
+    }
+
+    // FL = (e_y x n) * CL, FS = a x (e_y x n) * CS, FD = -n * CD, where n is the normalized airspeed a
+    const auto& airspeedX = _state.airspeedX;
+    const auto& airspeedY = _state.airspeedY;
+    const auto& airspeedZ = _state.airspeedZ;
+    const auto normInv = (_airspeedSquared > 0).select(_airspeedSquared.rsqrt(), 1.0);
+    const auto nX = airspeedX * normInv;
+    const auto nY = airspeedY * normInv;
+    const auto nZ = airspeedZ * normInv;
+    const auto forceFactor = _aeroForceFactor * _airspeedSquared;
+    const auto momentFactor = _aeroMomentFactor * _airspeedSquared;
+    _FaeroX = forceFactor * (nZ * _CL - airspeedY * nX * _CS - nX * _CD);
+    _FaeroY = forceFactor * ((airspeedZ * nZ + airspeedX * nX) * _CS - nY * _CD);
+    _FaeroZ = forceFactor * (-nX * _CL - airspeedY * nZ * _CS - nZ * _CD);
+    _MaeroX *= momentFactor;
+    _MaeroY *= momentFactor;
+    _MaeroZ *= momentFactor;
+}
+
+/**
+ * @brief Same scheme as VtolDynamics::calculateNewState()
+ */
+template<typename Scalar>
+void VtolFleetT<Scalar>::calculateNewState(double dtSecs){
+    auto& angVelX = _state.angularVelX;
+    auto& angVelY = _state.angularVelY;
+    auto& angVelZ = _state.angularVelZ;
+    const auto& I = _inertia;
+    const auto& Iinv = _inertiaInv;
+
+    // M - w x (I * w), stored in the aero moment rows
+    const auto IwX = I(0, 0) * angVelX + I(0, 1) * angVelY + I(0, 2) * angVelZ;
+    const auto IwY = I(1, 0) * angVelX + I(1, 1) * angVelY + I(1, 2) * angVelZ;
+    const auto IwZ = I(2, 0) * angVelX + I(2, 1) * angVelY + I(2, 2) * angVelZ;
+    _MaeroX += _MmotorsX - (angVelY * IwZ - angVelZ * IwY);
+    _MaeroY += _MmotorsY - (angVelZ * IwX - angVelX * IwZ);
+    _MaeroZ += _MmotorsZ - (angVelX * IwY - angVelY * IwX);
+    angVelX += (Iinv(0, 0) * _MaeroX + Iinv(0, 1) * _MaeroY + Iinv(0, 2) * _MaeroZ) * dtSecs;
+    angVelY += (Iinv(1, 0) * _MaeroX + Iinv(1, 1) * _MaeroY + Iinv(1, 2) * _MaeroZ) * dtSecs;
+    angVelZ += (Iinv(2, 0) * _MaeroX + Iinv(2, 1) * _MaeroY + Iinv(2, 2) * _MaeroZ) * dtSecs;
+
+    // Exponential map, see Math::integrateAttitude(): q = q * cos(|w| dt / 2) + q * (0, w) * sin(|w| dt / 2) / |w|
+    auto& qW = _state.attitudeW;
+    auto& qX = _state.attitudeX;
+    auto& qY = _state.attitudeY;
+    auto& qZ = _state.attitudeZ;
+    _attitudeDelta.row(4) = (angVelX.square() + angVelY.square() + angVelZ.square()).sqrt();
+    _attitudeDelta.row(5) = _attitudeDelta.row(4) * (0.5 * dtSecs);
+    _attitudeDelta.row(4) = (_attitudeDelta.row(5) < 1e-8).select(0.5 * dtSecs,
+                                                                 _attitudeDelta.row(5).sin() / _attitudeDelta.row(4));
+    _attitudeDelta.row(5) = _attitudeDelta.row(5).cos();
+    _attitudeDelta.row(0) = -(qX * angVelX + qY * angVelY + qZ * angVelZ);
+    _attitudeDelta.row(1) = qW * angVelX + qY * angVelZ - qZ * angVelY;
+    _attitudeDelta.row(2) = qW * angVelY + qZ * angVelX - qX * angVelZ;
+    _attitudeDelta.row(3) = qW * angVelZ + qX * angVelY - qY * angVelX;
+    qW = qW * _attitudeDelta.row(5) + _attitudeDelta.row(0) * _attitudeDelta.row(4);
+    qX = qX * _attitudeDelta.row(5) + _attitudeDelta.row(1) * _attitudeDelta.row(4);
+    qY = qY * _attitudeDelta.row(5) + _attitudeDelta.row(2) * _attitudeDelta.row(4);
+    qZ = qZ * _attitudeDelta.row(5) + _attitudeDelta.row(3) * _attitudeDelta.row(4);
+
+    // Specific force is rotated to NED with the new attitude
+    calculateRotationMatrices();
+    const double massInv = 1.0 / _mass;
+    const auto FspecificX = (_FaeroX + _FmotorsX) * massInv;
+    const auto FspecificY = (_FaeroY + _FmotorsY) * massInv;
+    const auto FspecificZ = (_FaeroZ + _FmotorsZ) * massInv;
+    _state.linearVelX += (_rotation.row(0) * FspecificX + _rotation.row(1) * FspecificY +
+                          _rotation.row(2) * FspecificZ) * dtSecs;
+    _state.linearVelY += (_rotation.row(3) * FspecificX + _rotation.row(4) * FspecificY +
+                          _rotation.row(5) * FspecificZ) * dtSecs;
+    _state.linearVelZ += (_rotation.row(6) * FspecificX + _rotation.row(7) * FspecificY +
+                          _rotation.row(8) * FspecificZ + _gravity) * dtSecs;
+    _state.positionX += _state.linearVelX * dtSecs;
+    _state.positionY += _state.linearVelY * dtSecs;
+    _state.positionZ += _state.linearVelZ * dtSecs;
+
+    for(size_t vehicle_idx = 0; vehicle_idx < _vehiclesAmount; vehicle_idx++){
+        if(_state.positionZ[vehicle_idx] >= 0){
+            land(vehicle_idx);
+        }
+    }
+}
+
+/**
+ * @brief Same as VtolDynamics::land()
+ */
+template<typename Scalar>
+void VtolFleetT<Scalar>::land(size_t vehicleIdx){
+    _state.linearVelX[vehicleIdx] = 0;
+    _state.linearVelY[vehicleIdx] = 0;
+    _state.linearVelZ[vehicleIdx] = 0;
+    _state.positionZ[vehicleIdx] = 0;
+
+    // Keep previous yaw, but set roll and pitch to 0.0
+    _state.attitudeX[vehicleIdx] = 0;
+    _state.attitudeY[vehicleIdx] = 0;
+    const Scalar norm = std::hypot(_state.attitudeW[vehicleIdx], _state.attitudeZ[vehicleIdx]);
+    _state.attitudeW[vehicleIdx] /= norm;
+    _state.attitudeZ[vehicleIdx] /= norm;
+
+    _state.angularVelX[vehicleIdx] = 0;
+    _state.angularVelY[vehicleIdx] = 0;
+    _state.angularVelZ[vehicleIdx] = 0;
+
+    _state.motorsRpm.col(vehicleIdx).setZero();
+}
+
+template<typename Scalar>
+const FleetStateT<Scalar>& VtolFleetT<Scalar>::getState() const{
+    return _state;
+}
+template<typename Scalar>
+Eigen::Vector3d VtolFleetT<Scalar>::getVehiclePosition(size_t vehicleIdx) const{
+    return {_state.positionX[vehicleIdx], _state.positionY[vehicleIdx], _state.positionZ[vehicleIdx]};
+}
+template<typename Scalar>
+Eigen::Quaterniond VtolFleetT<Scalar>::getVehicleAttitude(size_t vehicleIdx) const{
+    return {_state.attitudeW[vehicleIdx], _state.attitudeX[vehicleIdx],
+            _state.attitudeY[vehicleIdx], _state.attitudeZ[vehicleIdx]};
+}
+template<typename Scalar>
+Eigen::Vector3d VtolFleetT<Scalar>::getVehicleVelocity(size_t vehicleIdx) const{
+    return {_state.linearVelX[vehicleIdx], _state.linearVelY[vehicleIdx], _state.linearVelZ[vehicleIdx]};
+}
+template<typename Scalar>
+Eigen::Vector3d VtolFleetT<Scalar>::getVehicleAirspeed(size_t vehicleIdx) const{
+    return {_state.airspeedX[vehicleIdx], _state.airspeedY[vehicleIdx], _state.airspeedZ[vehicleIdx]};
+}
+template<typename Scalar>
+Eigen::Vector3d VtolFleetT<Scalar>::getVehicleAngularVelocity(size_t vehicleIdx) const{
+    return {_state.angularVelX[vehicleIdx], _state.angularVelY[vehicleIdx], _state.angularVelZ[vehicleIdx]};
+}
+
+template class VtolFleetT<double>;
+template class VtolFleetT<float>;
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+
+#ifndef VTOL_FLEET_HPP
+#define VTOL_FLEET_HPP
+
+#include <Eigen/Geometry>
+#include <vector>
+#include <array>
+#include "vtolDynamicsSim.hpp"
+
+/**
+ * @brief One value per vehicle
+ */
+template<typename Scalar>
+using FleetRowT = Eigen::Array<Scalar, 1, Eigen::Dynamic>;
+
+/**
+ * @brief Rows are channels (e.g. motors), columns are vehicles, so each channel is contiguous
+ */
+template<typename Scalar>
+using FleetArrayT = Eigen::Array<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+/**
+ * @brief Structure-of-arrays state of the fleet
+ */
+template<typename Scalar>
+struct FleetStateT{
+    using FleetRow = FleetRowT<Scalar>;
+    using FleetArray = FleetArrayT<Scalar>;
+
+    FleetRow positionX, positionY, positionZ;                   // NED, meters
+    FleetRow linearVelX, linearVelY, linearVelZ;                // NED, m/sec
+    FleetRow attitudeW, attitudeX, attitudeY, attitudeZ;        // FRD to NED
+    FleetRow angularVelX, angularVelY, angularVelZ;             // FRD, rad/sec
+    FleetRow airspeedX, airspeedY, airspeedZ;                   // FRD, m/sec
+
+    FleetArray motorsSpeed;                                     // rad/sec, filtered
+    FleetArray servos;                                          // aileron, elevator, rudder, filtered
+    FleetArray motorsRpm;                                       // rpm
+};
+
+using FleetRow = FleetRowT<double>;
+using FleetArray = FleetArrayT<double>;
+using FleetState = FleetStateT<double>;
+
+/**
+ * @brief Steps many VTOL vehicles of the same airframe at once.
+ * The model is equal to VtolDynamics::process() with the EULER integration method,
+ * but each stage runs over all vehicles with Eigen array expressions, so the arithmetic
+ * is vectorized and the table lookups share the AeroGrids of the prototype.
+ * @note Differences from VtolDynamics:
+ * - wind is a constant per vehicle, see setWind(), no random component is added,
+ * - forces and moments details (Forces, Moments) and IMU are not calculated,
+ * - only the 1-D prop table is used, the optional 2-D prop inflow table is ignored,
+ * - the vehicle lands at z = 0, the optional gear ground contact is ignored.
+ * @tparam Scalar - double or float. The float fleet doubles the SIMD width and halves the memory
+ * traffic of the state, the tables, the interface and the prototype stay in double.
+ */
+template<typename Scalar>
+class VtolFleetT{
+    public:
+        using FleetRow = FleetRowT<Scalar>;
+        using FleetArray = FleetArrayT<Scalar>;
+        using FleetState = FleetStateT<Scalar>;
+
+        /**
+         * @param[in] prototype - initialized VtolDynamics, its parameters and tables are copied
+         * @param[in] vehiclesAmount - all vehicles start at the origin with zero velocity
+         */
+        VtolFleetT(const VtolDynamics& prototype, size_t vehiclesAmount);
+
+        size_t getVehiclesAmount() const;
+        size_t getMotorsAmount() const;
+
+        void setVehicleState(size_t vehicleIdx,
+                             const Eigen::Vector3d& position,
+                             const Eigen::Quaterniond& attitude,
+                             const Eigen::Vector3d& linearVelocity,
+                             const Eigen::Vector3d& angularVelocity);
+        void setWind(size_t vehicleIdx, const Eigen::Vector3d& windNed);
+
+        /**
+         * @param[in] setpoints - unitless setpoints with (motors amount + 3) rows and a column per
+         * vehicle, the mapping is the same as in VtolDynamics::process()
+         */
+        void process(double dtSecs, const FleetArray& setpoints);
+
+        const FleetState& getState() const;
+        Eigen::Vector3d getVehiclePosition(size_t vehicleIdx) const;
+        Eigen::Quaterniond getVehicleAttitude(size_t vehicleIdx) const;
+        Eigen::Vector3d getVehicleVelocity(size_t vehicleIdx) const;
+        Eigen::Vector3d getVehicleAirspeed(size_t vehicleIdx) const;
+        Eigen::Vector3d getVehicleAngularVelocity(size_t vehicleIdx) const;
+
+    private:
+        void updateActuatorsGain(double dtSecs);
+        void updateActuators(double dtSecs, const FleetArray& setpoints);
+        void calculateMotorsForcesAndMoments();
+        void calculateRotationMatrices();
+        void calculateAirspeed();
+        void calculateAerodynamics();
+        void calculateNewState(double dtSecs);
+        void land(size_t vehicleIdx);
+
+        template<typename Polynomial>
+        static Scalar evaluatePolynomial(const Polynomial& polynomial, Scalar airspeed, Scalar AoA_deg, size_t& cursor);
+
+        size_t _vehiclesAmount;
+        size_t _motorsAmount;
+
+        Scalar _mass;
+        Scalar _gravity;
+        Eigen::Matrix<Scalar, 3, 3> _inertia;
+        Eigen::Matrix<Scalar, 3, 3> _inertiaInv;
+        Scalar _aeroForceFactor;
+        Scalar _aeroMomentFactor;
+        std::vector<Scalar> _motorMaxSpeed;
+        std::array<Scalar, 3> _servoRange;
+        std::vector<double> _actuatorTimeConstants;
+        std::vector<Scalar> _actuatorRateLimits;
+        std::vector<Scalar> _actuatorDeadbands;
+
+        /**
+         * @brief Motors geometry folded into the thrust and torque coefficients:
+         * F = thrust * forceAxis, M = thrust * thrustMomentArm + torque * torqueAxis
+         */
+        Eigen::Matrix<Scalar, 3, Eigen::Dynamic> _forceAxis;
+        Eigen::Matrix<Scalar, 3, Eigen::Dynamic> _thrustMomentArm;
+        Eigen::Matrix<Scalar, 3, Eigen::Dynamic> _torqueAxis;
+
+        PropSegments _propSegments;
+        AeroGrids _grids;
+        std::vector<TableCursors> _cursors;         // per vehicle
+
+        double _actuatorsDtSecs{-1.0};
+        std::vector<Scalar> _actuatorsGain;
+        std::vector<Scalar> _actuatorsMaxDelta;
+
+        FleetState _state;
+        FleetRow _windX, _windY, _windZ;
+
+        /**
+         * @brief Intermediate values of one step, preallocated for all vehicles
+         */
+        FleetArray _actuatorsCmd;                   // motors, then servos
+        FleetArray _thrust;
+        FleetArray _torque;
+        FleetArray _rotation;                       // FRD to NED matrix, row major elements
+        FleetArray _attitudeDelta;                  // q * (0, w): w, x, y, z, then sin gain and cos
+        FleetRow _FmotorsX, _FmotorsY, _FmotorsZ;
+        FleetRow _MmotorsX, _MmotorsY, _MmotorsZ;
+        FleetRow _FaeroX, _FaeroY, _FaeroZ;
+        FleetRow _MaeroX, _MaeroY, _MaeroZ;
+        FleetRow _AoADeg, _AoSDeg, _airspeedMod, _airspeedSquared;
+        FleetRow _CL, _CS, _CD;                     // lift, side and drag coefficients
+};
+
+extern template class VtolFleetT<double>;
+extern template class VtolFleetT<float>;
+
+using VtolFleet = VtolFleetT<double>;
+using VtolFleetF = VtolFleetT<float>;
+
+#endif  // VTOL_FLEET_HPP
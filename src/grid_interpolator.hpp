@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#ifndef GRID_INTERPOLATOR_HPP
+#define GRID_INTERPOLATOR_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "common_math.hpp"
+
+namespace Math
+{
+    /**
+     * @brief Axis search policies. Each of them returns the same segment as
+     * findPrevRowIdxInMonotonicSequence() for an increasing axis: the amount of the inner points below the key.
+     */
+
+    /**
+     * @brief Branchless count of the inner points, the loop is easily vectorized, the best for short axes
+     */
+    struct LinearSearch{
+        template<size_t Size>
+        static size_t find(const std::array<double, Size>& points, double, double key){
+            size_t segmentIdx = 0;
+            for(size_t idx = 1; idx + 1 < Size; idx++){
+                segmentIdx += static_cast<size_t>(points[idx] < key);
+            }
+            return segmentIdx;
+        }
+    };
+
+    /**
+     * @brief O(log n) for long axes
+     */
+    struct BinarySearch{
+        template<size_t Size>
+        static size_t find(const std::array<double, Size>& points, double, double key){
+            return std::lower_bound(points.begin() + 1, points.end() - 1, key) - (points.begin() + 1);
+        }
+    };
+
+    /**
+     * @brief O(1) on a uniform axis, on a non uniform one it falls back to LinearSearch
+     */
+    struct UniformSearch{
+        template<size_t Size>
+        static size_t find(const std::array<double, Size>& points, double uniformStepInv, double key){
+            if(uniformStepInv == 0.0){
+                return LinearSearch::find(points, uniformStepInv, key);
+            }
+            double position = (key - points[0]) * uniformStepInv;
+            position = position > 0.0 ? position : 0.0;
+            return std::min(static_cast<size_t>(position), Size - 2);
+        }
+    };
+
+    /**
+     * @brief Breakpoints of one axis with the precomputed reciprocal spacings.
+     * A decreasing axis is stored reversed and isReversed() tells the owner to reorder its values
+     * the same way, so the search policies and the lookups deal with increasing axes only.
+     */
+    template<size_t Size, typename Search = LinearSearch>
+    class GridAxis{
+    public:
+        static_assert(Size >= 2, "An axis should have at least 2 points");
+        static constexpr size_t SIZE = Size;
+
+        /**
+         * @param[in] points - strictly increasing or decreasing vector
+         * @return false if the size is wrong or the points are not strictly monotonic
+         */
+        template<typename Derived>
+        bool setPoints(const Eigen::MatrixBase<Derived>& points){
+            if(static_cast<size_t>(points.size()) != Size){
+                return false;
+            }
+            _isReversed = points(Size - 1) < points(0);
+            for(size_t idx = 0; idx < Size; idx++){
+                _points[idx] = points(_isReversed ? Size - 1 - idx : idx);
+            }
+
+            const double firstStep = _points[1] - _points[0];
+            bool isUniform = true;
+            for(size_t idx = 0; idx < Size - 1; idx++){
+                const double step = _points[idx + 1] - _points[idx];
+                if(!(step > 0.0)){
+                    return false;
+                }
+                _stepsInv[idx] = 1.0 / step;
+                isUniform = isUniform && std::abs(step - firstStep) <= 1e-9 * firstStep;
+            }
+            _uniformStepInv = isUniform ? 1.0 / firstStep : 0.0;
+            return true;
+        }
+
+        /**
+         * @param[out] fraction - position of the key in the segment, keys outside of the axis are
+         * linearly extrapolated by the first or the last segment
+         * @return index of the first point of the segment along the increasing axis
+         */
+        template<typename Scalar>
+        size_t findSegment(const Scalar& key, Scalar& fraction) const{
+            const size_t segmentIdx = Search::find(_points, _uniformStepInv, getValue(key));
+            fraction = (key - _points[segmentIdx]) * _stepsInv[segmentIdx];
+            return segmentIdx;
+        }
+
+        /**
+         * @brief findSegment() that starts from the segment of the previous call, see huntSegmentIdx().
+         * A uniform axis with UniformSearch is already O(1), so the cursor is just updated.
+         */
+        template<typename Scalar>
+        size_t findSegment(const Scalar& key, Scalar& fraction, size_t& cursor) const{
+            size_t segmentIdx;
+            if(std::is_same_v<Search, UniformSearch> && _uniformStepInv != 0.0){
+                segmentIdx = Search::find(_points, _uniformStepInv, getValue(key));
+                cursor = segmentIdx;
+            }else{
+                auto point = [this](size_t idx){ return _points[idx]; };
+                segmentIdx = huntSegmentIdx(point, Size, getValue(key), cursor);
+            }
+            fraction = (key - _points[segmentIdx]) * _stepsInv[segmentIdx];
+            return segmentIdx;
+        }
+
+        bool isUniform() const{ return _uniformStepInv != 0.0; }
+        bool isReversed() const{ return _isReversed; }
+
+    private:
+        std::array<double, Size> _points{};
+        std::array<double, Size - 1> _stepsInv{};
+        double _uniformStepInv{0.0};                    // 1 / step, 0 if the axis is not uniform
+        bool _isReversed{false};                        // the points were given in decreasing order
+    };
+
+    /**
+     * @brief Multilinear interpolation over a fixed-size grid, e.g.
+     * GridInterpolator<GridAxis<8, UniformSearch>, GridAxis<20>> for a table 8x20.
+     * The values are stored row-major with compile-time strides: the last axis is the fastest one.
+     * It gives the same result as griddata() in 2-D and extrapolates in the same way.
+     * The keys and the result are generic over the scalar type as in the other Math functions.
+     */
+    template<typename... Axes>
+    class GridInterpolator{
+    public:
+        static constexpr size_t DIMENSIONS = sizeof...(Axes);
+        static constexpr size_t VALUES_AMOUNT = (Axes::SIZE * ...);
+        static constexpr size_t CORNERS_AMOUNT = static_cast<size_t>(1) << DIMENSIONS;
+        static_assert(DIMENSIONS >= 1, "A grid should have at least 1 axis");
+
+        using Cursor = std::array<size_t, DIMENSIONS>;  // segments of the previous call per axis
+
+        /**
+         * @param[in] points - a vector per axis
+         * @return false if any of the axes is wrong, see GridAxis::setPoints()
+         */
+        template<typename... Derived>
+        bool setAxes(const Eigen::MatrixBase<Derived>&... points){
+            static_assert(sizeof...(Derived) == DIMENSIONS, "Wrong amount of axes");
+            return setAxesImpl(std::index_sequence_for<Axes...>{}, points...);
+        }
+
+        /**
+         * @param[in] values - read row-major as values(row, col): a vector along the single axis,
+         * a table with the rows along the first axis and the columns along the second one, for more
+         * axes the last ones are flattened into the columns
+         * @return false if the amount of the values is wrong
+         * @note The axes are set first, the values along the reversed ones are reordered here once
+         */
+        template<typename Derived>
+        bool setValues(const Eigen::MatrixBase<Derived>& values){
+            if(static_cast<size_t>(values.size()) != VALUES_AMOUNT){
+                return false;
+            }
+            const std::array<bool, DIMENSIONS> reversed = getReversedAxes(std::index_sequence_for<Axes...>{});
+            const size_t colsAmount = values.cols();
+            for(size_t sourceIdx = 0; sourceIdx < VALUES_AMOUNT; sourceIdx++){
+                size_t rest = sourceIdx;
+                size_t valueIdx = 0;
+                for(size_t dim = 0; dim < DIMENSIONS; dim++){
+                    const size_t pointIdx = rest / STRIDES[dim];
+                    rest %= STRIDES[dim];
+                    valueIdx += (reversed[dim] ? SIZES[dim] - 1 - pointIdx : pointIdx) * STRIDES[dim];
+                }
+                _values[valueIdx] = values(sourceIdx / colsAmount, sourceIdx % colsAmount);
+            }
+            return true;
+        }
+
+        /**
+         * @param[in] keys - a key per axis in the order of the axes
+         */
+        template<typename Scalar>
+        Scalar evaluate(const std::array<Scalar, DIMENSIONS>& keys) const{
+            std::array<Scalar, DIMENSIONS> fractions;
+            const size_t origin = findCell(keys, fractions, std::index_sequence_for<Axes...>{});
+            return interpolate(origin, fractions);
+        }
+
+        /**
+         * @brief evaluate() that hunts from the cell of the previous call, the result is the same
+         * @param[in, out] cursor - a cursor per caller, e.g. per vehicle, any value is valid
+         */
+        template<typename Scalar>
+        Scalar evaluate(const std::array<Scalar, DIMENSIONS>& keys, Cursor& cursor) const{
+            std::array<Scalar, DIMENSIONS> fractions;
+            const size_t origin = huntCell(keys, fractions, cursor, std::index_sequence_for<Axes...>{});
+            return interpolate(origin, fractions);
+        }
+
+        template<size_t Dim>
+        const auto& getAxis() const{ return std::get<Dim>(_axes); }
+
+    private:
+        template<typename Scalar>
+        Scalar interpolate(size_t origin, const std::array<Scalar, DIMENSIONS>& fractions) const{
+            std::array<Scalar, CORNERS_AMOUNT> corners;
+            for(size_t corner = 0; corner < CORNERS_AMOUNT; corner++){
+                corners[corner] = Scalar(_values[origin + CORNER_OFFSETS[corner]]);
+            }
+
+            // Bit d of a corner is the step along the axis d, the last axis is reduced first
+            for(size_t dim = DIMENSIONS; dim-- > 0;){
+                const size_t half = static_cast<size_t>(1) << dim;
+                for(size_t corner = 0; corner < half; corner++){
+                    corners[corner] += fractions[dim] * (corners[corner + half] - corners[corner]);
+                }
+            }
+            return corners[0];
+        }
+
+        static constexpr std::array<size_t, DIMENSIONS> SIZES{Axes::SIZE...};
+
+        static constexpr std::array<size_t, DIMENSIONS> calculateStrides(){
+            std::array<size_t, DIMENSIONS> strides{};
+            size_t stride = 1;
+            for(size_t dim = DIMENSIONS; dim-- > 0;){
+                strides[dim] = stride;
+                stride *= SIZES[dim];
+            }
+            return strides;
+        }
+        static constexpr std::array<size_t, DIMENSIONS> STRIDES = calculateStrides();
+
+        static constexpr std::array<size_t, CORNERS_AMOUNT> calculateCornerOffsets(){
+            std::array<size_t, CORNERS_AMOUNT> offsets{};
+            for(size_t corner = 0; corner < CORNERS_AMOUNT; corner++){
+                for(size_t dim = 0; dim < DIMENSIONS; dim++){
+                    offsets[corner] += ((corner >> dim) & 1) * STRIDES[dim];
+                }
+            }
+            return offsets;
+        }
+        static constexpr std::array<size_t, CORNERS_AMOUNT> CORNER_OFFSETS = calculateCornerOffsets();
+
+        template<size_t... Dims>
+        std::array<bool, DIMENSIONS> getReversedAxes(std::index_sequence<Dims...>) const{
+            return {std::get<Dims>(_axes).isReversed()...};
+        }
+
+        template<size_t... Dims, typename... Derived>
+        bool setAxesImpl(std::index_sequence<Dims...>, const Eigen::MatrixBase<Derived>&... points){
+            return (std::get<Dims>(_axes).setPoints(points) && ...);
+        }
+
+        template<typename Scalar, size_t... Dims>
+        size_t findCell(const std::array<Scalar, DIMENSIONS>& keys,
+                        std::array<Scalar, DIMENSIONS>& fractions,
+                        std::index_sequence<Dims...>) const{
+            return ((std::get<Dims>(_axes).findSegment(keys[Dims], fractions[Dims]) * STRIDES[Dims]) + ...);
+        }
+
+        template<typename Scalar, size_t... Dims>
+        size_t huntCell(const std::array<Scalar, DIMENSIONS>& keys,
+                        std::array<Scalar, DIMENSIONS>& fractions,
+                        Cursor& cursor,
+                        std::index_sequence<Dims...>) const{
+            return ((std::get<Dims>(_axes).findSegment(keys[Dims], fractions[Dims], cursor[Dims]) * STRIDES[Dims]) +
+                    ...);
+        }
+
+        std::tuple<Axes...> _axes;
+        std::array<double, VALUES_AMOUNT> _values{};
+    };
+
+    /**
+     * @brief Linear interpolation of the rows of a table along its first column, e.g. of the
+     * polynomial coefficients along the airspeed. It is the interpolation of calculatePolynomial(),
+     * but the rows are reordered along the increasing axis once in setTable().
+     */
+    template<typename Axis, size_t Cols>
+    class RowInterpolator{
+    public:
+        static constexpr size_t ROWS = Axis::SIZE;
+        static constexpr size_t COLS = Cols;
+
+        /**
+         * @param[in] table - the axis in the first column and at least Cols values in the next ones,
+         * the extra columns are ignored
+         * @return false if the size is wrong or the axis is not strictly monotonic
+         */
+        template<typename Derived>
+        bool setTable(const Eigen::MatrixBase<Derived>& table){
+            if(static_cast<size_t>(table.rows()) != ROWS || static_cast<size_t>(table.cols()) < Cols + 1 ||
+                    !_axis.setPoints(table.col(0))){
+                return false;
+            }
+            for(size_t row = 0; row < ROWS; row++){
+                const size_t sourceRow = _axis.isReversed() ? ROWS - 1 - row : row;
+                for(size_t col = 0; col < Cols; col++){
+                    _rows[row][col] = table(sourceRow, col + 1);
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @param[out] result - the first Cols values are written
+         */
+        template<typename Scalar, typename Derived>
+        void evaluate(const Scalar& key, Eigen::MatrixBase<Derived>& result) const{
+            Scalar fraction;
+            interpolate(_axis.findSegment(key, fraction), fraction, result);
+        }
+
+        /**
+         * @brief evaluate() that hunts from the segment of the previous call, see GridAxis::findSegment()
+         */
+        template<typename Scalar, typename Derived>
+        void evaluate(const Scalar& key, Eigen::MatrixBase<Derived>& result, size_t& cursor) const{
+            Scalar fraction;
+            interpolate(_axis.findSegment(key, fraction, cursor), fraction, result);
+        }
+
+    private:
+        template<typename Scalar, typename Derived>
+        void interpolate(size_t row, const Scalar& fraction, Eigen::MatrixBase<Derived>& result) const{
+            const auto& prev = _rows[row];
+            const auto& next = _rows[row + 1];
+            for(size_t col = 0; col < Cols; col++){
+                result[col] = lerp(prev[col], next[col], fraction);
+            }
+        }
+
+        Axis _axis;
+        std::array<std::array<double, Cols>, ROWS> _rows{};
+    };
+}  // namespace Math
+
+#endif  // GRID_INTERPOLATOR_HPP
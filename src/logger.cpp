@@ -134,6 +134,27 @@ void StateLogger::createStringStream(std::stringstream& logStream,
                 << enuPosition[2] << "].";
 }
 
+void StateLogger::addDiagnostics(std::stringstream& logStream, const DynamicsDiagnostics& diagnostics) {
+    bool isFirst = true;
+    for (size_t idx = 0; idx < DynamicsDiagnostics::EVENTS_AMOUNT; idx++) {
+        auto event = static_cast<DiagnosticEvent>(idx);
+        uint64_t counter = diagnostics.getCounter(event);
+        uint64_t newEvents = counter - _reportedDiagnostics[idx];
+        _reportedDiagnostics[idx] = counter;
+        if (newEvents == 0) {
+            continue;
+        }
+
+        logStream << (isFirst ? "\n" : ", ");
+        isFirst = false;
+        std::stringstream eventStream;
+        eventStream << DynamicsDiagnostics::getName(event) << "=" << newEvents
+                    << std::setprecision(1) << std::fixed
+                    << " (last " << diagnostics.getLastValue(event) << ")";
+        addWarnColor(logStream, eventStream.str());
+    }
+}
+
 void StateLogger::addErrColor(std::stringstream& logStream, bool is_ok, const std::string& newData) {
     if(!is_ok){
         logStream << COLOR_RED << newData << COLOR_TAIL;
@@ -22,6 +22,7 @@
 #include "actuators.hpp"
 #include "sensors.hpp"
 #include "dynamics.hpp"
+#include "diagnostics.hpp"
 
 struct StateLogger {
     StateLogger(Actuators& actuators, Sensors& sensors, DynamicsInfo& info) :
@@ -33,6 +34,11 @@ struct StateLogger {
                             double rosPubCounter,
                             double periodSec);
 
+    /**
+     * @brief Append the physics events recorded since the previous call, nothing if there are none
+     */
+    void addDiagnostics(std::stringstream& logStream, const DynamicsDiagnostics& diagnostics);
+
 private:
     static void addErrColor(std::stringstream& logStream, bool is_ok, const std::string& newData);
     static void addWarnColor(std::stringstream& logStream, const std::string& newData);
@@ -44,6 +50,8 @@ private:
 
     double _clockScale;
     double _dt_secs;
+
+    std::array<uint64_t, DynamicsDiagnostics::EVENTS_AMOUNT> _reportedDiagnostics{};
 };
 
 #endif  // UAV_DYNAMICS_LOGER_HPP
@@ -51,7 +51,7 @@ Uav_Dynamics::Uav_Dynamics(ros::NodeHandle nh) :
     _node(nh),
     _sensors(&nh),
     _rviz_visualizator(_node),
-    _scenarioManager(_node, _actuators, _sensors),
+    _scenarioManager(_node, _sensors),
     _logger(_actuators, _sensors, info){
 }
 
@@ -68,6 +68,8 @@ int8_t Uav_Dynamics::init(){
         return -1;
     }else if(initCalibration() == -1){
         return -1;
+    }else if(initParamsReload() == -1){
+        return -1;
     }else if(_rviz_visualizator.init(uavDynamicsSim_) == -1){
         return -1;
     }else if(startClockAndThreads() == -1){
@@ -145,6 +147,14 @@ int8_t Uav_Dynamics::initCalibration(){
     return 0;
 }
 
+/**
+ * @brief Publish to /uav/reload_params after rosparam load of the changed yaml files
+ */
+int8_t Uav_Dynamics::initParamsReload(){
+    paramsReloadSub_ = _node.subscribe("/uav/reload_params", 1, &Uav_Dynamics::paramsReloadCallback, this);
+    return 0;
+}
+
 int8_t Uav_Dynamics::startClockAndThreads(){
     ros::Duration(0.1).sleep();
     if(useSimTime_){
@@ -200,6 +210,7 @@ void Uav_Dynamics::performLogging(double periodSec){
         std::stringstream logStream;
         auto pose = uavDynamicsSim_->getVehiclePosition();
         _logger.createStringStream(logStream, pose, dynamicsCounter_, rosPubCounter_, periodSec);
+        _logger.addDiagnostics(logStream, uavDynamicsSim_->getDiagnostics());
         dynamicsCounter_ = 0;
         rosPubCounter_ = 0;
 
@@ -243,6 +254,9 @@ void Uav_Dynamics::proceedDynamics(double periodSec){
                 time_dif_sec = MAX_TIME_DIFF_SEC;
             }
 
+            if (auto faults = _scenarioManager.takeFaults()) {
+                uavDynamicsSim_->setFaults(*faults);
+            }
             uavDynamicsSim_->process(time_dif_sec, _actuators.actuators);
         }else{
             uavDynamicsSim_->land();
@@ -281,3 +295,11 @@ void Uav_Dynamics::calibrationCallback(std_msgs::UInt8 msg){
     }
     calibrationType_ = static_cast<UavDynamicsSimBase::SimMode_t>(msg.data);
 }
+
+void Uav_Dynamics::paramsReloadCallback(const std_msgs::Empty&){
+    if(uavDynamicsSim_->reloadParams() == -1){
+        ROS_ERROR("Dynamics: the parameters are not reloaded, the previous ones are kept.");
+    }else{
+        ROS_INFO("Dynamics: the reloaded parameters are applied from the next step.");
+    }
+}
@@ -26,6 +26,7 @@
 #include <ros/ros.h>
 #include <ros/time.h>
 
+#include <std_msgs/Empty.h>
 #include <std_msgs/UInt8.h>
 
 #include "uavDynamicsSimBase.hpp"
@@ -50,6 +51,7 @@ class Uav_Dynamics {
         int8_t initDynamicsSimulator();
         int8_t initSensors();
         int8_t initCalibration();
+        int8_t initParamsReload();
         int8_t startClockAndThreads();
 
         // Simulator
@@ -78,6 +80,10 @@ class Uav_Dynamics {
         UavDynamicsSimBase::SimMode_t calibrationType_{UavDynamicsSimBase::SimMode_t::NORMAL};
         void calibrationCallback(std_msgs::UInt8 msg);
 
+        // Parameters reload
+        ros::Subscriber paramsReloadSub_;
+        void paramsReloadCallback(const std_msgs::Empty& msg);
+
         // Diagnostic
         uint64_t dynamicsCounter_;
         uint64_t rosPubCounter_;
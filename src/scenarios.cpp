@@ -18,8 +18,24 @@
 
 #include "scenarios.hpp"
 
+// The last motor of the 8 motors VTOL, the setpoint index of the motor failure scenario
+static constexpr size_t FAILED_MOTOR_IDX = 7;
+
 void ScenarioManager::init() {
+    std::vector<double> faults;
+    if (ros::param::get("/uav/sim_params/faults", faults)) {
+        if (FaultInjector::parseSchedule(faults, _faults)) {
+            postFaults();
+        } else {
+            ROS_ERROR("Scenarios: wrong /uav/sim_params/faults, the faults are not set.");
+        }
+    }
     _scenarioSub = _node.subscribe("/uav/scenario", 1, &ScenarioManager::scenarioCallback, this);
+    _faultsSub = _node.subscribe("/uav/faults", 1, &ScenarioManager::faultsCallback, this);
+}
+
+std::unique_ptr<std::vector<Fault>> ScenarioManager::takeFaults() {
+    return _stagedFaults.take();
 }
 
 void ScenarioManager::scenarioCallback(std_msgs::UInt8 msg){
@@ -41,11 +57,9 @@ void ScenarioManager::scenarioCallback(std_msgs::UInt8 msg){
             break;
 
         case Scenario::ICE_STOP_STALL_EMULATION:
-            _actuators._scenarioType = msg.data;
             _sensors.iceStatusSensor.stop_stall_emulation();
             break;
         case Scenario::ICE_START_STALL_EMULATION:
-            _actuators._scenarioType = msg.data;
             _sensors.iceStatusSensor.start_stall_emulation();
             break;
 
@@ -70,7 +84,36 @@ void ScenarioManager::scenarioCallback(std_msgs::UInt8 msg){
             _sensors.escStatusSensor.enable();
             break;
 
+        case Scenario::MOTOR_FAILURE_START:
+            _isMotorFailed = true;
+            postFaults();
+            break;
+        case Scenario::MOTOR_FAILURE_STOP:
+            _isMotorFailed = false;
+            postFaults();
+            break;
+
         default:
             break;
     }
 }
+
+void ScenarioManager::faultsCallback(const std_msgs::Float64MultiArray& msg) {
+    if (!FaultInjector::parseSchedule(msg.data, _faults)) {
+        ROS_ERROR("Scenarios: wrong /uav/faults, the previous faults are kept.");
+        return;
+    }
+    postFaults();
+}
+
+void ScenarioManager::postFaults() {
+    auto faults = std::make_unique<std::vector<Fault>>(_faults);
+    if (_isMotorFailed) {
+        Fault motorLoss;
+        motorLoss.type = FaultType::MOTOR_THRUST;
+        motorLoss.index = FAILED_MOTOR_IDX;
+        motorLoss.value = 0.0;
+        faults->push_back(motorLoss);
+    }
+    _stagedFaults.post(std::move(faults));
+}
@@ -20,9 +20,13 @@
 #define UAV_DYNAMICS_SCENARIOS_HPP
 
 #include <ros/ros.h>
+#include <std_msgs/Float64MultiArray.h>
 #include <std_msgs/UInt8.h>
-#include <actuators.hpp>
+#include <memory>
+#include <vector>
 #include <sensors.hpp>
+#include "faults.hpp"
+#include "stagedUpdate.hpp"
 
 enum class Scenario {
     BARO_DISABLE = 0,
@@ -42,19 +46,39 @@ enum class Scenario {
 
     ESC_FEEDBACK_DISABLE,
     ESC_FEEDBACK_ENABLE,
+
+    MOTOR_FAILURE_START,
+    MOTOR_FAILURE_STOP,
 };
 
+/**
+ * @brief The scenarios and the fault schedule of the dynamics. The schedule is read from the
+ * optional /uav/sim_params/faults parameter and replaced by the /uav/faults topic, both are
+ * FaultInjector::parseSchedule() arrays. The motor failure scenario adds a motor loss to it.
+ * Any change restarts the schedule time.
+ */
 struct ScenarioManager {
-    ScenarioManager(ros::NodeHandle& node, Actuators& actuators, Sensors& sensors) :
-        _node(node), _actuators(actuators), _sensors(sensors) {}
+    ScenarioManager(ros::NodeHandle& node, Sensors& sensors) : _node(node), _sensors(sensors) {}
     void init();
+
+    /**
+     * @brief It is called by the dynamics thread before the step
+     * @return the schedule changed since the previous call or nullptr
+     */
+    std::unique_ptr<std::vector<Fault>> takeFaults();
 private:
     ros::Subscriber _scenarioSub;
+    ros::Subscriber _faultsSub;
     ros::NodeHandle& _node;
-    Actuators& _actuators;
     Sensors& _sensors;
 
+    std::vector<Fault> _faults;
+    bool _isMotorFailed{false};
+    StagedUpdate<std::vector<Fault>> _stagedFaults;
+
     void scenarioCallback(std_msgs::UInt8 msg);
+    void faultsCallback(const std_msgs::Float64MultiArray& msg);
+    void postFaults();
 };
 
 #endif  // UAV_DYNAMICS_SCENARIOS_HPP
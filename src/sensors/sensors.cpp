@@ -149,17 +149,16 @@ void Sensors::publishStateToCommunicator(uint8_t dynamicsNotation) {
     temperatureSensor.publish(temperatureKelvin);
     gpsSensor.publish(gpsPosition);
 
-    std::vector<double> motorsRpm;
-    if(_uavDynamicsSim->getMotorsRpm(motorsRpm)){
-        escStatusSensor.publish(motorsRpm);
-        if(motorsRpm.size() >= 5){
-            iceStatusSensor.publish(motorsRpm[4]);
+    if(_uavDynamicsSim->getMotorsRpm(_motorsRpm)){
+        escStatusSensor.publish(_motorsRpm);
+        if(_motorsRpm.size() >= 5){
+            iceStatusSensor.publish(_motorsRpm[4]);
         }
     }
 
     static double trueFuelLevelPct = 80.0;
-    if(motorsRpm[4] > 0.0) {
-        trueFuelLevelPct -= 0.0000002 * motorsRpm[4];
+    if(_motorsRpm[4] > 0.0) {
+        trueFuelLevelPct -= 0.0000002 * _motorsRpm[4];
         if(trueFuelLevelPct < 0) {
             trueFuelLevelPct = 0;
         }
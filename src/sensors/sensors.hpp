@@ -56,6 +56,7 @@ struct Sensors {
 private:
     CoordinateConverter geodeticConverter;
     std::shared_ptr<UavDynamicsSimBase> _uavDynamicsSim;
+    std::vector<double> _motorsRpm;                 // reused between steps to avoid reallocation
 };
 
 #endif  // SRC_SENSORS_SENSORS_HPP_
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "quadcopter.hpp"
+
+
+/**
+ * @brief The PX4 motor 1 (front right, clockwise) is the last internal motor. Without its thrust
+ * the vehicle rolls to the right and pitches up, in FLU it is +x and +y, and without its reaction
+ * torque it yaws to the left, +z.
+ */
+TEST(QuadcopterDynamics, motorLossFault){
+    constexpr double DT_SECS = 1.0 / 500;
+    const std::vector<double> setpoint{0.7, 0.7, 0.7, 0.7};
+
+    QuadcopterDynamics nominal;
+    QuadcopterDynamics faulty;
+    for(auto vehicle : {&nominal, &faulty}){
+        ASSERT_EQ(vehicle->init(), 0);
+        vehicle->setInitialPosition(Eigen::Vector3d(0, 0, 100), Eigen::Quaterniond(1, 0, 0, 0));
+    }
+    nominal.setFaults({});
+
+    Fault motorLoss;
+    motorLoss.type = FaultType::MOTOR_THRUST;
+    motorLoss.startSecs = 0.1;
+    motorLoss.index = 0;
+    motorLoss.value = 0.0;
+    faulty.setFaults({motorLoss});
+
+    for(size_t step = 0; step < 250; step++){
+        nominal.process(DT_SECS, setpoint);
+        faulty.process(DT_SECS, setpoint);
+    }
+
+    std::vector<double> motorsRpm;
+    faulty.getMotorsRpm(motorsRpm);
+    ASSERT_EQ(motorsRpm.size(), 4);
+    EXPECT_NEAR(motorsRpm[3], 0.0, 1.0);
+    for(size_t idx = 0; idx < 3; idx++){
+        EXPECT_GT(motorsRpm[idx], 1000.0);
+    }
+
+    const Eigen::Vector3d nominalRates = nominal.getVehicleAngularVelocity();
+    const Eigen::Vector3d faultyRates = faulty.getVehicleAngularVelocity();
+    EXPECT_LT(nominalRates.norm(), 0.5);  // the stochastic moment only
+    EXPECT_GT(faultyRates.x(), 2.0);
+    EXPECT_GT(faultyRates.y(), 2.0);
+    EXPECT_GT(faultyRates.z(), 2.0);
+}
+
+
+int main(int argc, char *argv[]){
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "tester");
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2023 RaccoonLab.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Dmitry Ponomarev <ponomarevda96@gmail.com>
+ */
+
+/**
+ * @file Allocation-counting harness for the per-step simulation path.
+ * With glibc every heap allocation is counted at the malloc level, so Eigen dynamic
+ * matrices are caught as well as operator new. Otherwise only operator new is counted.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "vtolDynamicsSim.hpp"
+
+
+namespace {
+std::atomic<size_t> allocationsCounter{0};
+thread_local bool isCountingEnabled = false;
+
+inline void countAllocation() {
+    if (isCountingEnabled) {
+        allocationsCounter.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Count heap allocations made by the current thread while the object is alive
+ */
+class AllocationsCounter {
+public:
+    AllocationsCounter() {
+        allocationsCounter = 0;
+        isCountingEnabled = true;
+    }
+    ~AllocationsCounter() {
+        isCountingEnabled = false;
+    }
+    size_t stop() {
+        isCountingEnabled = false;
+        return allocationsCounter;
+    }
+};
+}  // namespace
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    countAllocation();
+    return __libc_malloc(size);
+}
+void* calloc(size_t num, size_t size) {
+    countAllocation();
+    return __libc_calloc(num, size);
+}
+void* realloc(void* ptr, size_t size) {
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+}  // extern "C"
+#else
+void* operator new(std::size_t size) {
+    countAllocation();
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
+
+TEST(Allocations, counterDetectsAllocation){
+    static std::vector<double> sink;
+    AllocationsCounter counter;
+    sink.resize(sink.size() + 100);
+    ASSERT_GT(counter.stop(), 0);
+}
+
+/**
+ * @brief After a short warm-up neither process() nor the state extraction used by
+ * Sensors::publishStateToCommunicator() should touch the heap
+ */
+void checkStepIsAllocationFree(IntegrationMethod method){
+    constexpr size_t WARM_UP_STEPS = 10;
+    constexpr size_t STEPS = 1000;
+    constexpr double DT_SECS = 1.0 / 960;
+
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    vtolDynamicsSim.setIntegrationMethod(method);
+    vtolDynamicsSim.setInitialPosition(Eigen::Vector3d(0, 0, -100), Eigen::Quaterniond(1, 0, 0, 0));
+    vtolDynamicsSim.setInitialVelocity(Eigen::Vector3d(18, 0, 0), Eigen::Vector3d(0.3, -0.2, 0.1));
+
+    const std::vector<double> setpoint{0.5, 0.55, 0.5, 0.55, 0.7, 0.2, -0.3, 0.1};
+    std::vector<double> motorsRpm;
+    Eigen::Vector3d acc;
+    Eigen::Vector3d gyro;
+    Eigen::Vector3d stateSum = Eigen::Vector3d::Zero();
+
+    auto step = [&]() {
+        vtolDynamicsSim.process(DT_SECS, setpoint);
+        vtolDynamicsSim.getIMUMeasurement(acc, gyro);
+        vtolDynamicsSim.getMotorsRpm(motorsRpm);
+        stateSum += vtolDynamicsSim.getVehiclePosition() + vtolDynamicsSim.getVehicleVelocity() +
+                    vtolDynamicsSim.getVehicleAirspeed() + vtolDynamicsSim.getVehicleAngularVelocity() +
+                    vtolDynamicsSim.getVehicleAttitude().vec() + acc + gyro;
+    };
+
+    for(size_t idx = 0; idx < WARM_UP_STEPS; idx++){
+        step();
+    }
+
+    AllocationsCounter counter;
+    for(size_t idx = 0; idx < STEPS; idx++){
+        step();
+    }
+    EXPECT_EQ(counter.stop(), 0);
+    EXPECT_TRUE(stateSum.allFinite());
+}
+
+TEST(Allocations, processEuler){
+    checkStepIsAllocationFree(IntegrationMethod::EULER);
+}
+
+TEST(Allocations, processSemiImplicitEuler){
+    checkStepIsAllocationFree(IntegrationMethod::SEMI_IMPLICIT_EULER);
+}
+
+TEST(Allocations, processRK4){
+    checkStepIsAllocationFree(IntegrationMethod::RK4);
+}
+
+TEST(Allocations, processRK45){
+    checkStepIsAllocationFree(IntegrationMethod::RK45);
+}
+
+int main(int argc, char *argv[]){
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "tester");
+    return RUN_ALL_TESTS();
+}
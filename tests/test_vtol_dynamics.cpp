@@ -21,8 +21,15 @@
 #include <iostream>
 #include <Eigen/Geometry>
 #include <random>
+#include <chrono>
+#include <limits>
+#include <unsupported/Eigen/AutoDiff>
 #include "vtolDynamicsSim.hpp"
+#include "vtolFleet.hpp"
+#include "vtolAeroIdentification.hpp"
 #include "common_math.hpp"
+#include "vehicleParamsCache.hpp"
+#include <fstream>
 
 
 TEST(VtolDynamics, calculateWind){
@@ -32,10 +39,41 @@ TEST(VtolDynamics, calculateWind){
     vtolDynamicsSim.setWindParameter(wind_mean_velocity, wind_variance);
     Eigen::Vector3d expected_wind = Eigen::Vector3d(0, 10, 0);
 
-    Eigen::Vector3d actual_wind = vtolDynamicsSim.calculateWind();
+    Eigen::Vector3d actual_wind = vtolDynamicsSim.calculateWind(0.001);
     ASSERT_EQ(actual_wind, expected_wind);
 }
 
+TEST(VtolDynamics, calculateWindTurbulenceSeed){
+    VtolDynamics first, second;
+    for(auto vtol : {&first, &second}){
+        vtol->setInitialPosition(Eigen::Vector3d(0, 0, -50), Eigen::Quaterniond(1, 0, 0, 0));
+        vtol->setWindParameter(Eigen::Vector3d(3, 0, 0), 0.0);
+        vtol->setGustParameter(Eigen::Vector3d(0, 1, 0), 1.0);
+        vtol->setTurbulenceSeed(42);
+    }
+
+    for(size_t step = 0; step < 100; step++){
+        Eigen::Vector3d wind = first.calculateWind(0.01);
+        ASSERT_EQ(wind, second.calculateWind(0.01));
+        ASSERT_NE(wind, Eigen::Vector3d(3, 1, 0));
+    }
+}
+
+TEST(VtolDynamics, calculateWindTurbulenceIntensity){
+    VtolDynamics vtolDynamicsSim;
+    vtolDynamicsSim.setInitialPosition(Eigen::Vector3d(0, 0, -50), Eigen::Quaterniond(1, 0, 0, 0));
+    vtolDynamicsSim.setWindParameter(Eigen::Vector3d::Zero(), 0.0);
+    vtolDynamicsSim.setGustParameter(Eigen::Vector3d::Zero(), 4.0);
+    vtolDynamicsSim.setTurbulenceSeed(1);
+
+    constexpr size_t STEPS = 200000;
+    double verticalSquaredSum = 0;
+    for(size_t step = 0; step < STEPS; step++){
+        verticalSquaredSum += std::pow(vtolDynamicsSim.calculateWind(0.1)[2], 2);
+    }
+    EXPECT_NEAR(sqrt(verticalSquaredSum / STEPS), 2.0, 0.3);
+}
+
 TEST(VtolDynamics, calculateAnglesOfAtack){
     VtolDynamics vtolDynamicsSim;
     Eigen::Vector3d airSpeed;
@@ -139,6 +177,36 @@ TEST(CommonMath, findPrevRowIdxInMonotonicSequenceDecreasing){
     ASSERT_EQ(Math::findPrevRowIdxInMonotonicSequence(table, 50.0), 0);
 }
 
+/**
+ * @brief From any cursor the hunt should give the same segment as the full search,
+ * and a small change of the key should keep the cursor
+ */
+TEST(CommonMath, huntPrevRowIdxInMonotonicSequence){
+    Eigen::MatrixXd increasing(8, 1);
+    increasing << 5, 10, 15, 20, 25, 30, 35, 40;
+    Eigen::MatrixXd decreasing = -increasing;
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> keyDistribution(-50.0, 50.0);
+    std::uniform_int_distribution<size_t> cursorDistribution(0, 10);
+    for(size_t idx = 0; idx < 1000; idx++){
+        for(const auto& table : {increasing, decreasing}){
+            const double key = keyDistribution(generator);
+            size_t cursor = cursorDistribution(generator);
+            const size_t expected = Math::findPrevRowIdxInMonotonicSequence(table, key);
+            EXPECT_EQ(Math::huntPrevRowIdxInMonotonicSequence(table, key, cursor), expected);
+            EXPECT_EQ(cursor, expected);
+        }
+    }
+
+    size_t cursor = 0;
+    EXPECT_EQ(Math::huntPrevRowIdxInMonotonicSequence(increasing, 17.0, cursor), 2);
+    EXPECT_EQ(Math::huntPrevRowIdxInMonotonicSequence(increasing, 17.001, cursor), 2);
+    EXPECT_EQ(Math::huntPrevRowIdxInMonotonicSequence(increasing, 20.5, cursor), 3);
+    EXPECT_EQ(Math::huntPrevRowIdxInMonotonicSequence(increasing, 100.0, cursor), 6);
+    EXPECT_EQ(Math::huntPrevRowIdxInMonotonicSequence(increasing, -100.0, cursor), 0);
+}
+
 TEST(calculateCLPolynomial, test_normal_scalar){
     VtolDynamics vtolDynamicsSim;
 
@@ -294,6 +362,91 @@ TEST(VtolDynamics, griddata){
     EXPECT_NEAR(actual_result, expected_result, 0.001);
 }
 
+/**
+ * @brief All search policies should give the same result as griddata() on the aerodynamic tables axes
+ * including the extrapolation, a 3-D grid should reproduce a multilinear function
+ */
+TEST(CommonMath, gridInterpolator){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    const auto& tables = vtolDynamicsSim.getTables();
+
+    Math::GridInterpolator<Math::GridAxis<8, Math::UniformSearch>, Math::GridAxis<20, Math::LinearSearch>> linear;
+    Math::GridInterpolator<Math::GridAxis<8, Math::BinarySearch>, Math::GridAxis<20, Math::BinarySearch>> binary;
+    Math::GridInterpolator<Math::GridAxis<8, Math::LinearSearch>, Math::GridAxis<20, Math::UniformSearch>> uniform;
+    ASSERT_TRUE(linear.setAxes(tables.airspeed, -tables.actuator) && linear.setValues(tables.CS_rudder));
+    ASSERT_TRUE(binary.setAxes(tables.airspeed, tables.actuator) && binary.setValues(tables.CmxAileron));
+    ASSERT_TRUE(uniform.setAxes(tables.airspeed, tables.actuator) && uniform.setValues(tables.CmxAileron));
+    EXPECT_TRUE(linear.getAxis<0>().isUniform());
+    EXPECT_FALSE(linear.getAxis<1>().isUniform());
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> airspeedDistribution(0.0, 45.0);
+    std::uniform_real_distribution<double> servoDistribution(-25.0, 25.0);
+    decltype(binary)::Cursor cursor{};
+    for(size_t idx = 0; idx < 1000; idx++){
+        const double airspeed = airspeedDistribution(generator);
+        const double servo = servoDistribution(generator);
+        EXPECT_EQ(binary.evaluate<double>({airspeed, servo}, cursor), binary.evaluate<double>({airspeed, servo}));
+        EXPECT_NEAR(linear.evaluate<double>({airspeed, servo}),
+                    Math::griddata(-tables.actuator, tables.airspeed, tables.CS_rudder, servo, airspeed), 1e-9);
+        const double expected = Math::griddata(tables.actuator, tables.airspeed, tables.CmxAileron, servo, airspeed);
+        EXPECT_NEAR(binary.evaluate<double>({airspeed, servo}), expected, 1e-9);
+        EXPECT_NEAR(uniform.evaluate<double>({airspeed, servo}), expected, 1e-9);
+    }
+
+    Eigen::Vector2d x(0.0, 1.0);
+    Eigen::Vector3d y(-1.0, 0.0, 3.0);
+    Eigen::Vector4d z(4.0, 2.0, 1.0, 0.0);
+    auto function = [](double xValue, double yValue, double zValue){
+        return 1.0 + 2.0 * xValue - yValue + 0.5 * zValue + 0.25 * xValue * yValue * zValue;
+    };
+    Eigen::Matrix<double, 6, 4, Eigen::RowMajor> values;
+    for(size_t xIdx = 0; xIdx < 2; xIdx++){
+        for(size_t yIdx = 0; yIdx < 3; yIdx++){
+            for(size_t zIdx = 0; zIdx < 4; zIdx++){
+                values(xIdx * 3 + yIdx, zIdx) = function(x[xIdx], y[yIdx], z[zIdx]);
+            }
+        }
+    }
+    Math::GridInterpolator<Math::GridAxis<2>, Math::GridAxis<3>, Math::GridAxis<4, Math::BinarySearch>> grid;
+    ASSERT_TRUE(grid.setAxes(x, y, z) && grid.setValues(values));
+    EXPECT_NEAR(grid.evaluate<double>({0.3, 2.0, 1.5}), function(0.3, 2.0, 1.5), 1e-12);
+    EXPECT_NEAR(grid.evaluate<double>({-0.5, -2.0, 5.0}), function(-0.5, -2.0, 5.0), 1e-12);
+    EXPECT_FALSE(grid.setAxes(x, y, Eigen::Vector4d(0.0, 1.0, 1.0, 2.0)));
+}
+
+/**
+ * @brief The rows along the reversed airspeed are reordered once, the result stays the one of calculatePolynomial()
+ */
+TEST(CommonMath, rowInterpolator){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    const Eigen::MatrixXd table = vtolDynamicsSim.getTables().CLPolynomial;
+    const Eigen::MatrixXd reversedTable = table.colwise().reverse();
+
+    Math::RowInterpolator<Math::GridAxis<8, Math::UniformSearch>, 7> increasing;
+    Math::RowInterpolator<Math::GridAxis<8, Math::UniformSearch>, 7> decreasing;
+    ASSERT_TRUE(increasing.setTable(table));
+    ASSERT_TRUE(decreasing.setTable(reversedTable));
+    EXPECT_FALSE(increasing.setTable(table.leftCols(7)));
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> airspeedDistribution(0.0, 45.0);
+    size_t cursor = 0;
+    for(size_t idx = 0; idx < 1000; idx++){
+        const double airspeed = airspeedDistribution(generator);
+        Eigen::VectorXd expected(7);
+        Eigen::VectorXd fromIncreasing(7);
+        Eigen::VectorXd fromDecreasing(7);
+        ASSERT_TRUE(Math::calculatePolynomial(table, airspeed, expected));
+        increasing.evaluate(airspeed, fromIncreasing, cursor);
+        decreasing.evaluate(airspeed, fromDecreasing);
+        EXPECT_TRUE(fromIncreasing.isApprox(expected, 1e-12));
+        EXPECT_TRUE(fromDecreasing.isApprox(expected, 1e-12));
+    }
+}
+
 TEST(VtolDynamics, calculateCSRudder){
     VtolDynamics vtolDynamicsSim;
     ASSERT_EQ(vtolDynamicsSim.init(), 0);
@@ -467,6 +620,147 @@ TEST(VtolDynamics, calculateAerodynamicsRealCase){
     }
 }
 
+TEST(VtolDynamics, calculateAerodynamicsMemoized){
+    VtolDynamics memoized;
+    VtolDynamics reference;
+    ASSERT_EQ(memoized.init(), 0);
+    ASSERT_EQ(reference.init(), 0);
+    memoized.setAeroMemoTolerances({0.5, 0.5, 0.5, 0.01});
+
+    Eigen::Vector3d Faero, Maero, expectedFaero, expectedMaero;
+    std::array<double, 3> servos{0.1, -0.05, 0.02};
+    for(size_t step = 0; step < 100; step++){
+        Eigen::Vector3d airspeed(20.0 + 1e-3 * step, 0.5, 1.0);
+        double AoA = reference.calculateAnglesOfAtack(airspeed);
+        double AoS = reference.calculateAnglesOfSideslip(airspeed);
+        memoized.calculateAerodynamics(airspeed, AoA, AoS, servos, Faero, Maero);
+        reference.calculateAerodynamics(airspeed, AoA, AoS, servos, expectedFaero, expectedMaero);
+        EXPECT_NEAR((Faero - expectedFaero).norm(), 0, 0.01 * expectedFaero.norm());
+        EXPECT_NEAR((Maero - expectedMaero).norm(), 0, 0.01 * expectedMaero.norm());
+    }
+    EXPECT_EQ(memoized.getAeroMemoMisses(), 1);
+    EXPECT_EQ(memoized.getAeroMemoHits(), 99);
+
+    servos[0] += 0.02;
+    Eigen::Vector3d airspeed(20.1, 0.5, 1.0);
+    memoized.calculateAerodynamics(airspeed, 0.05, 0.02, servos, Faero, Maero);
+    EXPECT_EQ(memoized.getAeroMemoMisses(), 2);
+
+    EXPECT_EQ(reference.getAeroMemoHits(), 0);
+    EXPECT_EQ(reference.getAeroMemoMisses(), 0);
+}
+
+/**
+ * @brief Envelope clamps are counted by the diagnostics instead of being printed
+ */
+TEST(VtolDynamics, diagnosticsCounters){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    const auto& diagnostics = vtolDynamicsSim.getDiagnostics();
+    for(size_t idx = 0; idx < DynamicsDiagnostics::EVENTS_AMOUNT; idx++){
+        EXPECT_EQ(diagnostics.getCounter(static_cast<DiagnosticEvent>(idx)), 0);
+    }
+
+    Eigen::Vector3d Faero, Maero;
+    std::array<double, 3> servos{0.0, 0.0, 0.0};
+    Eigen::Vector3d airspeed(20.0, 0.0, 1.0);
+    vtolDynamicsSim.calculateAerodynamics(airspeed, 0.05, 0.0, servos, Faero, Maero);
+    EXPECT_EQ(diagnostics.getCounter(DiagnosticEvent::AOA_SATURATION), 0);
+
+    vtolDynamicsSim.calculateAerodynamics(airspeed, 1.0, -2.0, servos, Faero, Maero);
+    vtolDynamicsSim.calculateAerodynamics(airspeed, -1.2, 0.0, servos, Faero, Maero);
+    EXPECT_EQ(diagnostics.getCounter(DiagnosticEvent::AOA_SATURATION), 2);
+    EXPECT_NEAR(diagnostics.getLastValue(DiagnosticEvent::AOA_SATURATION), -1.2 * 180 / 3.1415, 1e-9);
+    EXPECT_EQ(diagnostics.getCounter(DiagnosticEvent::AOS_SATURATION), 1);
+
+    vtolDynamicsSim.setInitialPosition(Eigen::Vector3d(0, 0, -100), Eigen::Quaterniond(1, 0, 0, 0));
+    vtolDynamicsSim.setInitialVelocity(Eigen::Vector3d(55, 0, 0), Eigen::Vector3d::Zero());
+    std::vector<double> motors(5, 0.0);
+    vtolDynamicsSim.proceedState(Eigen::Vector3d::Zero(), motors, servos, 0.001);
+    EXPECT_EQ(diagnostics.getCounter(DiagnosticEvent::AIRSPEED_LIMIT), 1);
+    EXPECT_NEAR(diagnostics.getLastValue(DiagnosticEvent::AIRSPEED_LIMIT), 55, 1e-9);
+
+    auto copy = vtolDynamicsSim;
+    EXPECT_EQ(copy.getDiagnostics().getCounter(DiagnosticEvent::AOA_SATURATION), 2);
+}
+
+/**
+ * @brief Forward-mode AD Jacobian of the aerodynamics by the airspeed should be equal to
+ * the central differences and the double model should be equal to the generic one
+ */
+TEST(VtolDynamics, calculateAerodynamicsAutoDiff){
+    using AutoDiff = Eigen::AutoDiffScalar<Eigen::Vector3d>;
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    const Eigen::Vector3d airspeed(18.0, 1.5, 2.5);
+    const std::array<double, 3> servos{0.05, -0.1, 0.08};
+
+    auto calculateAero = [&](const Eigen::Vector3d& airspeedFrd, Eigen::Vector3d& Faero, Eigen::Vector3d& Maero){
+        double AoA = vtolDynamicsSim.calculateAnglesOfAtackT(airspeedFrd);
+        double AoS = vtolDynamicsSim.calculateAnglesOfSideslipT(airspeedFrd);
+        vtolDynamicsSim.calculateAerodynamicsT(airspeedFrd, AoA, AoS, servos, Faero, Maero);
+    };
+
+    Vector3T<AutoDiff> airspeedAd;
+    for(size_t idx = 0; idx < 3; idx++){
+        airspeedAd[idx] = AutoDiff(airspeed[idx], 3, idx);
+    }
+    std::array<AutoDiff, 3> servosAd{AutoDiff(servos[0]), AutoDiff(servos[1]), AutoDiff(servos[2])};
+    AutoDiff AoA = vtolDynamicsSim.calculateAnglesOfAtackT(airspeedAd);
+    AutoDiff AoS = vtolDynamicsSim.calculateAnglesOfSideslipT(airspeedAd);
+    Vector3T<AutoDiff> FaeroAd;
+    Vector3T<AutoDiff> MaeroAd;
+    vtolDynamicsSim.calculateAerodynamicsT(airspeedAd, AoA, AoS, servosAd, FaeroAd, MaeroAd);
+
+    Eigen::Vector3d Faero;
+    Eigen::Vector3d Maero;
+    vtolDynamicsSim.calculateAerodynamics(airspeed,
+                                          vtolDynamicsSim.calculateAnglesOfAtack(airspeed),
+                                          vtolDynamicsSim.calculateAnglesOfSideslip(airspeed),
+                                          servos, Faero, Maero);
+    constexpr double STEP = 1e-6;
+    for(size_t row = 0; row < 3; row++){
+        EXPECT_DOUBLE_EQ(FaeroAd[row].value(), Faero[row]);
+        EXPECT_DOUBLE_EQ(MaeroAd[row].value(), Maero[row]);
+        for(size_t col = 0; col < 3; col++){
+            Eigen::Vector3d Fplus, Mplus, Fminus, Mminus;
+            calculateAero(airspeed + STEP * Eigen::Vector3d::Unit(col), Fplus, Mplus);
+            calculateAero(airspeed - STEP * Eigen::Vector3d::Unit(col), Fminus, Mminus);
+            double dF = (Fplus[row] - Fminus[row]) / (2 * STEP);
+            double dM = (Mplus[row] - Mminus[row]) / (2 * STEP);
+            EXPECT_NEAR(FaeroAd[row].derivatives()[col], dF, 1e-4 * std::max(1.0, std::abs(dF)));
+            EXPECT_NEAR(MaeroAd[row].derivatives()[col], dM, 1e-4 * std::max(1.0, std::abs(dM)));
+        }
+    }
+
+    AutoDiff thrust, torque, rpm;
+    vtolDynamicsSim.thrusterT(AutoDiff(600.0, 3, 0), thrust, torque, rpm);
+    double expectedThrust, expectedTorque, expectedRpm;
+    vtolDynamicsSim.thruster(600.0, expectedThrust, expectedTorque, expectedRpm);
+    double thrustPlus, thrustMinus;
+    vtolDynamicsSim.thruster(600.0 + 1e-3, thrustPlus, expectedTorque, expectedRpm);
+    vtolDynamicsSim.thruster(600.0 - 1e-3, thrustMinus, expectedTorque, expectedRpm);
+    EXPECT_DOUBLE_EQ(thrust.value(), expectedThrust);
+    EXPECT_NEAR(thrust.derivatives()[0], (thrustPlus - thrustMinus) / 2e-3, 1e-6);
+}
+
+TEST(VtolDynamics, calculateAngularAccel){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    Eigen::Matrix3d inertia;
+    inertia << 0.62684, 0,      0,
+               0,       0.6444, 0,
+               0,       0,      1.26242;
+    Eigen::Vector3d moment(1.0, 2.0, 3.0);
+    Eigen::Vector3d angVel(0.3, 0.2, 0.1);
+    Eigen::Vector3d expected = inertia.inverse() * (moment - angVel.cross(inertia * angVel));
+
+    Eigen::Vector3d actual = vtolDynamicsSim.calculateAngularAccel(moment, angVel);
+    for(size_t idx = 0; idx < 3; idx++){
+        EXPECT_NEAR(actual[idx], expected[idx], 1e-9);
+    }
+}
+
 TEST(thruster, thrusterFirstZeroCmd){
     VtolDynamics vtolDynamicsSim;
     ASSERT_EQ(vtolDynamicsSim.init(), 0);
@@ -516,6 +810,135 @@ TEST(thruster, thrusterThird){
     EXPECT_NEAR(actualRpm, expectedRpm, 0.2);
 }
 
+TEST(thruster, thrustersBatchedEqualToScalar){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    std::vector<double> controls{-10.0, 0.0, 27.5, 134.254698, 500.004648, 551.38, 700.0, 1110.6, 1200.0};
+    std::array<double, MOTORS_MAX_AMOUNT> thrusts, torques, rpms;
+
+    vtolDynamicsSim.thrusters(controls, thrusts, torques, rpms);
+
+    for(size_t idx = 0; idx < controls.size(); idx++){
+        double expectedThrust, expectedTorque, expectedRpm;
+        vtolDynamicsSim.thruster(controls[idx], expectedThrust, expectedTorque, expectedRpm);
+        EXPECT_DOUBLE_EQ(thrusts[idx], expectedThrust);
+        EXPECT_DOUBLE_EQ(torques[idx], expectedTorque);
+        EXPECT_DOUBLE_EQ(rpms[idx], expectedRpm);
+    }
+
+    // The caller's cursors hunt from the previous call, the vehicle isn't written
+    const VtolDynamics& sharedVehicle = vtolDynamicsSim;
+    TableCursors cursors;
+    std::array<double, MOTORS_MAX_AMOUNT> huntedThrusts, huntedTorques, huntedRpms;
+    for(auto controlsOrder : {controls, std::vector<double>(controls.rbegin(), controls.rend())}){
+        sharedVehicle.thrusters(controlsOrder, huntedThrusts, huntedTorques, huntedRpms, cursors);
+        sharedVehicle.thrusters(controlsOrder, thrusts, torques, rpms);
+        for(size_t idx = 0; idx < controls.size(); idx++){
+            EXPECT_DOUBLE_EQ(huntedThrusts[idx], thrusts[idx]);
+            EXPECT_DOUBLE_EQ(huntedRpms[idx], rpms[idx]);
+        }
+    }
+}
+
+/**
+ * @brief The motors loop specialized for the vtol_7kg layout should match the per-motor
+ * thrusters() and the geometry of the vehicle
+ */
+TEST(VtolDynamics, motorsForcesSpecializedEqualToGeneric){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    std::vector<double> motors{600, 550, 450, 500, 650};
+    ASSERT_EQ(motors.size(), vtolDynamicsSim.getParameters().geometry.size());
+    vtolDynamicsSim.setInitialPosition(Eigen::Vector3d(0, 0, -100), Eigen::Quaterniond(1, 0, 0, 0));
+    vtolDynamicsSim.calculateNewState(Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(), motors, 0.001);
+
+    const auto& geometry = vtolDynamicsSim.getParameters().geometry;
+    const auto& forces = vtolDynamicsSim.getForces();
+    const auto& moments = vtolDynamicsSim.getMoments();
+    for(size_t idx = 0; idx < motors.size(); idx++){
+        double thrust, torque, rpm;
+        vtolDynamicsSim.thruster(motors[idx], thrust, torque, rpm);
+        double ccw = geometry[idx].directionCCW ? 1.0 : -1.0;
+        Eigen::Vector3d expectedForce = geometry[idx].axis * thrust;
+        Eigen::Vector3d expectedMoment = -ccw * torque * geometry[idx].axis +
+                                         geometry[idx].position.cross(expectedForce);
+        for(size_t axis = 0; axis < 3; axis++){
+            EXPECT_NEAR(forces.motors[idx][axis], expectedForce[axis], 1e-9);
+            EXPECT_NEAR(moments.motors[idx][axis], expectedMoment[axis], 1e-9);
+        }
+    }
+}
+
+TEST(thruster, thrustersInflowTable){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    const auto& prop = vtolDynamicsSim.getTables().prop;
+
+    // thrust and torque decrease linearly with the inflow, so the bilinear kernel is exact
+    std::vector<double> inflow{-10.0, 0.0, 10.0, 25.0, 40.0};
+    Eigen::MatrixXd thrust(PROP_TABLE_SIZE, inflow.size());
+    Eigen::MatrixXd torque(PROP_TABLE_SIZE, inflow.size());
+    Eigen::MatrixXd rpm(PROP_TABLE_SIZE, inflow.size());
+    for(size_t col = 0; col < inflow.size(); col++){
+        thrust.col(col) = prop.col(1) * (1.0 - inflow[col] / 50.0);
+        torque.col(col) = prop.col(2) * (1.0 - inflow[col] / 80.0);
+        rpm.col(col) = prop.col(4).array() + 10.0 * inflow[col];
+    }
+    std::vector<bool> motors{true, true, true, true, false};
+    vtolDynamicsSim.setPropInflowTable(inflow, thrust, torque, rpm, motors);
+
+    std::vector<double> controls{0.0, 27.5, 134.254698, 500.004648, 700.0};
+    std::array<double, MOTORS_MAX_AMOUNT> inflows{0.0, 5.0, 17.3, 60.0, 30.0};
+    std::array<double, MOTORS_MAX_AMOUNT> thrusts, torques, rpms;
+    vtolDynamicsSim.thrusters(controls, inflows, thrusts, torques, rpms);
+
+    for(size_t idx = 0; idx < controls.size(); idx++){
+        double expectedThrust, expectedTorque, expectedRpm;
+        vtolDynamicsSim.thruster(controls[idx], expectedThrust, expectedTorque, expectedRpm);
+        if(motors[idx]){
+            double motorInflow = std::min(inflows[idx], inflow.back());
+            expectedThrust *= 1.0 - motorInflow / 50.0;
+            expectedTorque *= 1.0 - motorInflow / 80.0;
+            expectedRpm += 10.0 * motorInflow;
+        }
+        EXPECT_NEAR(thrusts[idx], expectedThrust, 1e-9);
+        EXPECT_NEAR(torques[idx], expectedTorque, 1e-9);
+        EXPECT_NEAR(rpms[idx], expectedRpm, 1e-6);
+    }
+}
+
+TEST(VtolDynamics, updateActuatorsFirstOrderLag){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    vtolDynamicsSim.setInitialPosition(Eigen::Vector3d(0, 0, -100), Eigen::Quaterniond(1, 0, 0, 0));
+    constexpr double DT_SECS = 0.001;
+    constexpr double TAU_SECS = 0.01;   // actuatorTimeConstants of the default vehicle
+    const std::vector<double> setpoint{0.5, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0};
+
+    for(size_t step = 1; step <= 10; step++){
+        vtolDynamicsSim.process(DT_SECS, setpoint);
+        const double expected = 1.0 - std::exp(-static_cast<double>(step) * DT_SECS / TAU_SECS);
+        const auto& actuators = vtolDynamicsSim.getActuators();
+        EXPECT_NEAR(actuators[0], 500.0 * expected, 1e-9);
+        EXPECT_NEAR(actuators[5], 20.0 * expected, 1e-9);
+    }
+}
+
+TEST(VtolDynamics, updateActuatorsRateLimitAndDeadband){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    vtolDynamicsSim.setInitialPosition(Eigen::Vector3d(0, 0, -100), Eigen::Quaterniond(1, 0, 0, 0));
+    constexpr double DT_SECS = 0.001;
+    vtolDynamicsSim.setActuatorsLimits({1000, 1000, 1000, 1000, 1000, 100, 100, 100},
+                                       {0, 0, 0, 0, 0, 0.5, 0.5, 0.5});
+
+    vtolDynamicsSim.process(DT_SECS, {1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.02, 0.0});
+    const auto& actuators = vtolDynamicsSim.getActuators();
+    EXPECT_NEAR(actuators[0], 1.0, 1e-9);   // rate limited
+    EXPECT_NEAR(actuators[5], 0.1, 1e-9);   // rate limited
+    EXPECT_NEAR(actuators[6], 0.0, 1e-9);   // -0.4 is inside of the deadband
+}
+
 /**
  * @note In InnoDynamics the altitude is directed to the bottom, but in this simulator
  * it is directed to the top, so we perform invertion.
@@ -542,6 +965,31 @@ void calculateNewState(double dt,
     linearAcceleration = vtolDynamicsSim.getLinearAcceleration();
 }
 
+/**
+ * @brief The exponential map should be exact for a constant angular velocity
+ * and keep the unit norm without normalization, even for large steps
+ */
+TEST(CommonMath, integrateAttitude){
+    Eigen::Quaterniond initialAttitude(Eigen::AngleAxisd(0.4, Eigen::Vector3d(1, 2, 3).normalized()));
+    Eigen::Vector3d angularVel(0.3, -1.2, 2.0);
+    constexpr double DURATION_SECS = 10.0;
+
+    for(double dt : {0.001, 0.01, 0.1}){
+        Eigen::Quaterniond attitude = initialAttitude;
+        auto stepsAmount = static_cast<size_t>(std::llround(DURATION_SECS / dt));
+        for(size_t step = 0; step < stepsAmount; step++){
+            attitude = Math::integrateAttitude(attitude, angularVel, dt);
+        }
+        Eigen::AngleAxisd rotation(angularVel.norm() * DURATION_SECS, angularVel.normalized());
+        Eigen::Quaterniond expected = initialAttitude * Eigen::Quaterniond(rotation);
+        EXPECT_NEAR(attitude.angularDistance(expected), 0.0, 1e-9);
+        EXPECT_NEAR(attitude.norm(), 1.0, 1e-12);
+    }
+
+    auto unchanged = Math::integrateAttitude(initialAttitude, Eigen::Vector3d::Zero(), 0.01);
+    EXPECT_NEAR(unchanged.angularDistance(initialAttitude), 0.0, 1e-15);
+}
+
 TEST(VtolDynamics, calculateNewState_1_OnlyAttitude){
     double dt = 0.002500;
     std::vector<double> motors{0, 0, 0, 0, 0};
@@ -761,6 +1209,724 @@ TEST(VtolDynamics, calculateNewState_9_EightComplexFull){
 }
 
 
+struct TrajectoryEnd{
+    Eigen::Vector3d position;
+    Eigen::Quaterniond attitude;
+};
+
+TrajectoryEnd flyManeuver(IntegrationMethod method, double dt, double durationSecs,
+                          size_t aeroUpdatePeriod = 1, bool isExtrapolated = false){
+    VtolDynamics vtolDynamicsSim;
+    EXPECT_EQ(vtolDynamicsSim.init(), 0);
+    vtolDynamicsSim.setIntegrationMethod(method);
+    vtolDynamicsSim.setAeroUpdatePeriod(aeroUpdatePeriod, isExtrapolated);
+    vtolDynamicsSim.setInitialPosition(Eigen::Vector3d(0, 0, -100), Eigen::Quaterniond(1, 0, 0, 0));
+    vtolDynamicsSim.setInitialVelocity(Eigen::Vector3d(18, 0, 0), Eigen::Vector3d(0.3, -0.2, 0.1));
+
+    std::vector<double> motors{300, 350, 320, 330, 600};
+    std::array<double, 3> servos{5.0, -3.0, 4.0};
+    auto stepsAmount = static_cast<size_t>(std::llround(durationSecs / dt));
+    for(size_t step = 0; step < stepsAmount; step++){
+        vtolDynamicsSim.proceedState(Eigen::Vector3d::Zero(), motors, servos, dt);
+    }
+    return {vtolDynamicsSim.getVehiclePosition(), vtolDynamicsSim.getVehicleAttitude()};
+}
+
+/**
+ * @brief Trajectory-accuracy benchmark: each integrator is compared against RK4 at 10 kHz.
+ * Higher order integrators at 200-250 Hz should be at least as accurate as Euler at 960 Hz.
+ */
+TEST(VtolDynamics, integratorsTrajectoryAccuracy){
+    constexpr double DURATION_SECS = 3.0;
+    auto reference = flyManeuver(IntegrationMethod::RK4, 1e-4, DURATION_SECS);
+
+    struct Case{
+        const char* name;
+        IntegrationMethod method;
+        double rateHz;
+        double positionError;
+        double attitudeError;
+    };
+    std::vector<Case> cases{
+        {"euler",               IntegrationMethod::EULER,               960, 0, 0},
+        {"euler",               IntegrationMethod::EULER,               250, 0, 0},
+        {"semi_implicit_euler", IntegrationMethod::SEMI_IMPLICIT_EULER, 250, 0, 0},
+        {"rk4",                 IntegrationMethod::RK4,                 250, 0, 0},
+        {"rk4",                 IntegrationMethod::RK4,                 200, 0, 0},
+        {"rk45",                IntegrationMethod::RK45,                250, 0, 0},
+        {"rk45",                IntegrationMethod::RK45,                200, 0, 0},
+    };
+
+    for(auto& test_case : cases){
+        auto result = flyManeuver(test_case.method, 1.0 / test_case.rateHz, DURATION_SECS);
+        test_case.positionError = (result.position - reference.position).norm();
+        test_case.attitudeError = result.attitude.angularDistance(reference.attitude);
+        std::cout << test_case.name << " " << test_case.rateHz << " Hz: position error = "
+                  << test_case.positionError << " m, attitude error = "
+                  << test_case.attitudeError << " rad" << std::endl;
+    }
+
+    const auto& baseline = cases[0];
+    for(const auto& test_case : cases){
+        if(test_case.method == IntegrationMethod::RK4 || test_case.method == IntegrationMethod::RK45){
+            EXPECT_LE(test_case.positionError, baseline.positionError);
+            EXPECT_LE(test_case.attitudeError, baseline.attitudeError);
+        }
+    }
+}
+
+/**
+ * @brief Multi-rate error report: the aerodynamics is evaluated every N steps of Euler at 960 Hz.
+ * Both the difference from the single rate 960 Hz and the error against the RK4 10 kHz reference
+ * are reported. With N = 4 the aerodynamics runs at 240 Hz, so the extrapolated one should be more
+ * accurate than the single rate Euler at 250 Hz that does the same amount of aerodynamic evaluations.
+ */
+TEST(VtolDynamics, multiRateAerodynamicsError){
+    constexpr double DURATION_SECS = 3.0;
+    constexpr double DT_SECS = 1.0 / 960;
+    auto reference = flyManeuver(IntegrationMethod::RK4, 1e-4, DURATION_SECS);
+    auto singleRate = flyManeuver(IntegrationMethod::EULER, DT_SECS, DURATION_SECS);
+    auto slowSingleRate = flyManeuver(IntegrationMethod::EULER, 1.0 / 250, DURATION_SECS);
+    double slowPositionError = (slowSingleRate.position - reference.position).norm();
+    double slowAttitudeError = slowSingleRate.attitude.angularDistance(reference.attitude);
+    std::cout << "single rate 250 Hz: position error = " << slowPositionError
+              << " m, attitude error = " << slowAttitudeError << " rad" << std::endl;
+
+    for(size_t period : {2, 4, 8}){
+        for(bool isExtrapolated : {false, true}){
+            auto result = flyManeuver(IntegrationMethod::EULER, DT_SECS, DURATION_SECS, period, isExtrapolated);
+            double positionDiff = (result.position - singleRate.position).norm();
+            double attitudeDiff = result.attitude.angularDistance(singleRate.attitude);
+            double positionError = (result.position - reference.position).norm();
+            double attitudeError = result.attitude.angularDistance(reference.attitude);
+            std::cout << "period " << period << (isExtrapolated ? " extrapolated" : " held")
+                      << ": from single rate " << positionDiff << " m, " << attitudeDiff << " rad"
+                      << ", position error = " << positionError
+                      << " m, attitude error = " << attitudeError << " rad" << std::endl;
+
+            if(period == 4 && isExtrapolated){
+                EXPECT_LE(positionError, slowPositionError);
+                EXPECT_LE(attitudeError, slowAttitudeError);
+            }
+        }
+    }
+}
+
+static GroundContact createGroundContact(){
+    GroundContact contact;
+    contact.isEnabled = true;
+    contact.gearsAmount = 4;
+    contact.positions[0] << 0.3, 0.3, 0.2;
+    contact.positions[1] << 0.3, -0.3, 0.2;
+    contact.positions[2] << -0.3, 0.3, 0.2;
+    contact.positions[3] << -0.3, -0.3, 0.2;
+    contact.stiffness = 20000;
+    contact.damping = 300;
+    contact.friction = 0.5;
+    return contact;
+}
+
+/**
+ * @brief A drop from 0.5 meters: the vehicle should bounce and come to rest on the gear
+ * at the normal step rate of each integrator
+ */
+TEST(VtolDynamics, groundContactDrop){
+    for(auto method : {IntegrationMethod::EULER, IntegrationMethod::SEMI_IMPLICIT_EULER, IntegrationMethod::RK4}){
+        VtolDynamics vtolDynamicsSim;
+        ASSERT_EQ(vtolDynamicsSim.init(), 0);
+        vtolDynamicsSim.setIntegrationMethod(method);
+        vtolDynamicsSim.setGroundContact(createGroundContact());
+        vtolDynamicsSim.setInitialPosition(Eigen::Vector3d(0, 0, -0.7),
+                                           Eigen::Quaterniond(Eigen::AngleAxisd(0.05, Eigen::Vector3d::UnitX())));
+
+        std::vector<double> motors(5, 0.0);
+        std::array<double, 3> servos{0.0, 0.0, 0.0};
+        constexpr double DT_SECS = 1.0 / 250;
+        double maxUpwardVelocity = 0;
+        bool isTouched = false;
+        for(size_t step = 0; step < 1000; step++){
+            vtolDynamicsSim.proceedState(Eigen::Vector3d::Zero(), motors, servos, DT_SECS);
+            isTouched = isTouched || vtolDynamicsSim.getVehiclePosition()[2] > -0.2;
+            if(isTouched){
+                maxUpwardVelocity = std::max(maxUpwardVelocity, -vtolDynamicsSim.getVehicleVelocity()[2]);
+            }
+        }
+
+        // Static deflection of 4 gears is m * g / (4 * k) = 0.86 mm
+        EXPECT_NEAR(vtolDynamicsSim.getVehiclePosition()[2], -0.2 + 0.00086, 1e-3);
+        EXPECT_NEAR(vtolDynamicsSim.getVehicleVelocity().norm(), 0, 1e-3);
+        EXPECT_NEAR(vtolDynamicsSim.getVehicleAngularVelocity().norm(), 0, 1e-3);
+        EXPECT_GT(maxUpwardVelocity, 0.01);
+    }
+}
+
+TEST(VtolDynamics, groundContactFriction){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    vtolDynamicsSim.setGroundContact(createGroundContact());
+    vtolDynamicsSim.setInitialPosition(Eigen::Vector3d(0, 0, -0.2), Eigen::Quaterniond(1, 0, 0, 0));
+    vtolDynamicsSim.setInitialVelocity(Eigen::Vector3d(2, 0, 0), Eigen::Vector3d::Zero());
+
+    std::vector<double> motors(5, 0.0);
+    std::array<double, 3> servos{0.0, 0.0, 0.0};
+    constexpr double DT_SECS = 1.0 / 960;
+    for(size_t step = 0; step < 960; step++){
+        vtolDynamicsSim.proceedState(Eigen::Vector3d::Zero(), motors, servos, DT_SECS);
+    }
+
+    // Deceleration is friction * g, so it stops after v / (friction * g) = 0.41 sec at 0.41 meters
+    EXPECT_NEAR(vtolDynamicsSim.getVehicleVelocity().norm(), 0, 1e-3);
+    EXPECT_NEAR(vtolDynamicsSim.getVehiclePosition()[0], 0.41, 0.05);
+}
+
+/**
+ * @brief An empty schedule doesn't change the flight, the motor loss stops the motor and rolls the
+ * vehicle, the stuck servo ignores the commands, the mass shift is restored at its end
+ */
+TEST(VtolDynamics, faultInjection){
+    constexpr double DT_SECS = 1.0 / 500;
+    const std::vector<double> setpoint{0.7, 0.7, 0.7, 0.7, 0.0, 0.5, 0.0, 0.0};
+    std::vector<double> setpointAfterStuck = setpoint;
+    setpointAfterStuck[5] = -0.5;
+
+    VtolDynamics nominal;
+    VtolDynamics withEmptySchedule;
+    VtolDynamics faulty;
+    for(auto vehicle : {&nominal, &withEmptySchedule, &faulty}){
+        ASSERT_EQ(vehicle->init(), 0);
+        vehicle->setInitialPosition(Eigen::Vector3d(0, 0, -100), Eigen::Quaterniond(1, 0, 0, 0));
+    }
+    const double nominalMass = faulty.getParameters().mass;
+    withEmptySchedule.setFaults({});
+
+    Fault motorLoss;
+    motorLoss.type = FaultType::MOTOR_THRUST;
+    motorLoss.startSecs = 0.5;
+    motorLoss.index = 0;
+    motorLoss.value = 0.0;
+    Fault stuckAileron;
+    stuckAileron.type = FaultType::SERVO_STUCK;
+    stuckAileron.startSecs = 0.2;
+    stuckAileron.index = 0;
+    Fault payload;
+    payload.type = FaultType::MASS_SHIFT;
+    payload.startSecs = 0.1;
+    payload.endSecs = 0.3;
+    payload.value = 1.0;
+    faulty.setFaults({motorLoss, stuckAileron, payload});
+
+    double stuckAileronPosition = 0.0;
+    for(size_t step = 1; step <= 500; step++){
+        const double timeSecs = step * DT_SECS;
+        const auto& crntSetpoint = timeSecs > 0.25 ? setpointAfterStuck : setpoint;
+        nominal.process(DT_SECS, crntSetpoint);
+        withEmptySchedule.process(DT_SECS, crntSetpoint);
+        faulty.process(DT_SECS, crntSetpoint);
+
+        if(step == 100){
+            EXPECT_DOUBLE_EQ(faulty.getParameters().mass, nominalMass + 1.0);
+            stuckAileronPosition = faulty.getActuators()[5];
+        }else if(step > 100){
+            EXPECT_DOUBLE_EQ(faulty.getActuators()[5], stuckAileronPosition);
+        }
+    }
+
+    EXPECT_EQ(withEmptySchedule.getVehiclePosition(), nominal.getVehiclePosition());
+    EXPECT_EQ(withEmptySchedule.getVehicleAttitude().coeffs(), nominal.getVehicleAttitude().coeffs());
+    EXPECT_DOUBLE_EQ(faulty.getParameters().mass, nominalMass);
+    EXPECT_NE(nominal.getActuators()[5], stuckAileronPosition);
+
+    std::vector<double> motorsRpm;
+    faulty.getMotorsRpm(motorsRpm);
+    EXPECT_NEAR(motorsRpm[0], 0.0, 1.0);
+    EXPECT_GT(faulty.getVehicleAngularVelocity().norm(), nominal.getVehicleAngularVelocity().norm() + 0.5);
+
+    // The removed mass is limited, so the mass stays positive
+    Fault massLoss;
+    massLoss.type = FaultType::MASS_SHIFT;
+    massLoss.value = -2.0 * nominalMass;
+    nominal.setFaults({massLoss, massLoss});
+    nominal.process(DT_SECS, setpoint);
+    EXPECT_DOUBLE_EQ(nominal.getParameters().mass, (1.0 - FaultInjector::MAX_REMOVED_MASS_RATIO) * nominalMass);
+    EXPECT_TRUE(nominal.getVehiclePosition().allFinite());
+}
+
+TEST(FaultInjector, parseSchedule){
+    std::vector<Fault> faults;
+    ASSERT_TRUE(FaultInjector::parseSchedule({0, 1.0, -1.0, 3, 0.5, 0, 0, 0,
+                                              4, 2.0, 3.0, 0, 1.0, 0.1, 0, 0}, faults));
+    ASSERT_EQ(faults.size(), 2);
+    EXPECT_EQ(faults[0].type, FaultType::MOTOR_THRUST);
+    EXPECT_EQ(faults[0].index, 3);
+    EXPECT_EQ(faults[0].endSecs, std::numeric_limits<double>::infinity());
+    EXPECT_EQ(faults[1].type, FaultType::MASS_SHIFT);
+    EXPECT_EQ(faults[1].endSecs, 3.0);
+    EXPECT_EQ(faults[1].cgOffset, Eigen::Vector3d(0.1, 0, 0));
+
+    EXPECT_FALSE(FaultInjector::parseSchedule({0, 1.0, -1.0, 3, 0.5, 0, 0}, faults));
+    EXPECT_FALSE(FaultInjector::parseSchedule({5, 1.0, -1.0, 3, 0.5, 0, 0, 0}, faults));
+    EXPECT_FALSE(FaultInjector::parseSchedule({0, NAN, -1.0, 3, 0.5, 0, 0, 0}, faults));
+    EXPECT_EQ(faults.size(), 2);
+    ASSERT_TRUE(FaultInjector::parseSchedule({}, faults));
+    EXPECT_TRUE(faults.empty());
+}
+
+/**
+ * @brief The staged tables are applied by the next step only, then the vehicle flies as the one
+ * with the tables set directly. An active mass shift is kept and a vehicle without tables is rejected.
+ */
+TEST(VtolDynamics, stageVehicle){
+    constexpr double DT_SECS = 1.0 / 500;
+    const std::vector<double> setpoint{0.7, 0.7, 0.7, 0.7, 0.0, 0.5, 0.2, 0.0};
+
+    VtolDynamics running;
+    VtolDynamics reference;
+    VtolDynamics loaded;
+    for(auto vehicle : {&running, &reference, &loaded}){
+        ASSERT_EQ(vehicle->init(), 0);
+        vehicle->setInitialPosition(Eigen::Vector3d(0, 0, -100), Eigen::Quaterniond(1, 0, 0, 0));
+    }
+    Fault payload;
+    payload.type = FaultType::MASS_SHIFT;
+    payload.value = 1.0;
+    running.setFaults({payload});
+    reference.setFaults({payload});
+    const double nominalMass = running.getParameters().mass;
+
+    auto tables = loaded.getTables();
+    tables.CLPolynomial *= 1.5;
+    tables.CmyElevator *= 0.5;
+    loaded.setAeroTables(tables);
+    reference.setAeroTables(tables);
+
+    ASSERT_EQ(running.stageVehicle(loaded), 0);
+    EXPECT_NE(running.getTables().CLPolynomial, tables.CLPolynomial);
+    for(size_t step = 0; step < 500; step++){
+        running.process(DT_SECS, setpoint);
+        reference.process(DT_SECS, setpoint);
+    }
+    EXPECT_EQ(running.getTables().CLPolynomial, tables.CLPolynomial);
+    EXPECT_EQ(running.getTables().CmyElevator, tables.CmyElevator);
+    EXPECT_DOUBLE_EQ(running.getParameters().mass, nominalMass + 1.0);
+    EXPECT_EQ(running.getVehiclePosition(), reference.getVehiclePosition());
+    EXPECT_EQ(running.getVehicleAttitude().coeffs(), reference.getVehicleAttitude().coeffs());
+
+    VtolDynamics withoutTables;
+    EXPECT_EQ(running.stageVehicle(withoutTables), -1);
+}
+
+/**
+ * @brief A truncated table or motors array is rejected by the reload, the running model is kept
+ */
+TEST(VtolDynamics, reloadParamsWithWrongSizes){
+    if(VtolDynamics::isBaked()){
+        GTEST_SKIP() << "The baked vehicle isn't read from the parameter server";
+    }
+    const std::string PATH = "/uav/aerodynamics_coeffs/";
+    VtolDynamics running;
+    ASSERT_EQ(running.init(), 0);
+    const Eigen::MatrixXd CS_beta = running.getTables().CS_beta;
+
+    for(const char* name : {"CS_beta", "motorPositionY", "prop"}){
+        std::vector<double> values;
+        ASSERT_TRUE(ros::param::get(PATH + name, values));
+        std::vector<double> wrongValues(values.begin(), values.end() - 1);
+        if(std::string(name) == "prop"){
+            wrongValues = values;
+            std::swap(wrongValues[0], wrongValues[5]);  // the control column isn't increasing
+        }
+        ros::param::set(PATH + name, wrongValues);
+        EXPECT_EQ(running.reloadParams(), -1) << name;
+        ros::param::set(PATH + name, values);
+    }
+
+    running.process(0.001, {0.5, 0.5, 0.5, 0.5, 0.0, 0.0, 0.0, 0.0});
+    EXPECT_EQ(running.getTables().CS_beta, CS_beta);
+    EXPECT_EQ(running.reloadParams(), 0);
+}
+
+/**
+ * @brief Hover with all motors and the fixed wing cruise with the copter motors stopped
+ * should be trimmed, the grid solved in parallel should be equal to the serial one
+ */
+TEST(TrimSolver, vtolHoverAndCruise){
+    VtolDynamics vtolDynamicsSim;
+    ASSERT_EQ(vtolDynamicsSim.init(), 0);
+    VtolTrimModel model(vtolDynamicsSim);
+    const double gravity = vtolDynamicsSim.getEnvironment().gravity;
+
+    TrimSolver hoverSolver(model, TrimOptions());
+    auto hover = hoverSolver.solve(TrimPoint{0.0, 0.0});
+    ASSERT_TRUE(hover.isConverged);
+    ASSERT_EQ(hover.A.rows(), 9);
+    ASSERT_EQ(hover.B.cols(), 8);
+    // Pitching up tilts the thrust backward
+    EXPECT_NEAR(hover.A(0, 4), -gravity, 1e-3);
+    for(size_t motor_idx = 0; motor_idx < 4; motor_idx++){
+        EXPECT_LT(hover.B(2, motor_idx), 0.0);
+    }
+
+    TrimOptions cruiseOptions;
+    cruiseOptions.initialSetpoint = {0.0, 0.0, 0.0, 0.0, 0.5, 0.0, 0.0, 0.0};
+    cruiseOptions.fixedSetpoints = {true, true, true, true, false, false, false, false};
+    TrimSolver cruiseSolver(model, cruiseOptions);
+    std::vector<TrimPoint> grid;
+    for(double airspeed = 15.0; airspeed <= 30.0; airspeed += 5.0){
+        for(double climbRate = -2.0; climbRate <= 2.0; climbRate += 2.0){
+            grid.push_back({airspeed, climbRate});
+        }
+    }
+
+    auto serial = cruiseSolver.solve(grid, 1);
+    auto parallel = cruiseSolver.solve(grid, 4);
+    ASSERT_EQ(serial.size(), grid.size());
+    ASSERT_EQ(parallel.size(), grid.size());
+    for(size_t idx = 0; idx < grid.size(); idx++){
+        EXPECT_TRUE(serial[idx].isConverged) << grid[idx].airspeed << " " << grid[idx].climbRate;
+        EXPECT_EQ(serial[idx].setpoint, parallel[idx].setpoint);
+        EXPECT_EQ(serial[idx].A, parallel[idx].A);
+        EXPECT_EQ(serial[idx].B, parallel[idx].B);
+        for(size_t motor_idx = 0; motor_idx < 4; motor_idx++){
+            EXPECT_EQ(serial[idx].setpoint[motor_idx], 0.0);
+        }
+    }
+}
+
+/**
+ * @brief Samples of a vehicle with the modified tables should give these tables back
+ */
+TEST(VtolAeroIdentification, recoverModifiedTables){
+    VtolDynamics nominal;
+    ASSERT_EQ(nominal.init(), 0);
+    TablesWithCoeffs modifiedTables = nominal.getTables();
+    modifiedTables.CLPolynomial.col(7).array() += 0.05;
+    modifiedTables.CDPolynomial.col(5).array() *= 1.2;
+    modifiedTables.CmyElevator *= 1.3;
+    modifiedTables.CmxPolynomial.col(7).array() += 0.002;
+    VtolDynamics truth = nominal;
+    truth.setAeroTables(modifiedTables);
+
+    std::default_random_engine generator(42);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    auto generateSamples = [&](size_t samplesAmount){
+        std::vector<AeroFlightSample> samples(samplesAmount);
+        for(auto& sample : samples){
+            const double airspeed = 22.0 + 8.0 * unit(generator);
+            sample.body.position.setZero();
+            sample.body.attitude = Eigen::AngleAxisd(0.2 * unit(generator), Eigen::Vector3d::UnitY()) *
+                                   Eigen::AngleAxisd(0.3 * unit(generator), Eigen::Vector3d::UnitX());
+            sample.body.linearVelNed = Eigen::Vector3d(airspeed, 2.0 * unit(generator), 2.0 * unit(generator));
+            sample.body.angularVel = 0.3 * Eigen::Vector3d(unit(generator), unit(generator), unit(generator));
+            sample.setpoint = {0.0, 0.0, 0.0, 0.0, 0.5 + 0.3 * unit(generator),
+                               0.8 * unit(generator), 0.8 * unit(generator), 0.8 * unit(generator)};
+            truth.calculateSteadyAccelerations(sample.body, sample.windNed, sample.setpoint,
+                                               sample.linearAccel, sample.angularAccel);
+        }
+        return samples;
+    };
+    auto samples = generateSamples(4000);
+
+    AeroIdentificationOptions options;
+    options.regularization = 1e-9;
+    VtolAeroIdentification identification(nominal, options);
+    auto serial = identification.fit(samples, 1);
+    auto parallel = identification.fit(samples, 4);
+    ASSERT_EQ(serial.samplesAmount, samples.size());
+    EXPECT_GT(serial.parametersAmount, 0u);
+    EXPECT_GT(serial.forceRmsBefore, 1.0);
+    EXPECT_LT(serial.forceRmsAfter, 1e-3 * serial.forceRmsBefore);
+    for(size_t axis = 0; axis < 3; axis++){
+        EXPECT_LT(serial.momentRmsAfter[axis], 1e-3 * serial.momentRmsBefore[axis] + 1e-9);
+    }
+    EXPECT_NEAR(parallel.forceRmsAfter, serial.forceRmsAfter, 1e-6);
+    EXPECT_LT((parallel.tables.CmyElevator - serial.tables.CmyElevator).cwiseAbs().maxCoeff(), 1e-6);
+
+    VtolDynamics fitted = nominal;
+    fitted.setAeroTables(serial.tables);
+    for(const auto& sample : generateSamples(100)){
+        Eigen::Vector3d linearAccel;
+        Eigen::Vector3d angularAccel;
+        fitted.calculateSteadyAccelerations(sample.body, sample.windNed, sample.setpoint, linearAccel, angularAccel);
+        EXPECT_LT((linearAccel - sample.linearAccel).norm(), 1e-2);
+        EXPECT_LT((angularAccel - sample.angularAccel).norm(), 1e-2);
+    }
+}
+
+struct FleetCase{
+    Eigen::Vector3d position;
+    Eigen::Quaterniond attitude;
+    Eigen::Vector3d linearVelocity;
+    Eigen::Vector3d angularVelocity;
+    std::vector<double> setpoint;
+};
+
+static std::vector<FleetCase> createFleetCases(size_t amount){
+    std::vector<FleetCase> cases;
+    for(size_t idx = 0; idx < amount; idx++){
+        double k = static_cast<double>(idx % 16) / 16;
+        Eigen::Quaterniond attitude(Eigen::AngleAxisd(0.1 + k, Eigen::Vector3d(0.2, -0.3 * k, 1).normalized()));
+        cases.push_back({Eigen::Vector3d(k, -k, -100.0),
+                         attitude,
+                         Eigen::Vector3d(18 - 10 * k, 2 * k, -k),
+                         Eigen::Vector3d(0.3 * k, -0.2, 0.1 + k),
+                         {0.5, 0.55 + 0.1 * k, 0.5, 0.55, 0.7 * k, 0.8 * k - 0.4, -0.3, 0.6 - k}});
+    }
+    return cases;
+}
+
+static FleetArray createFleetSetpoints(const std::vector<FleetCase>& cases){
+    FleetArray setpoints(cases.front().setpoint.size(), cases.size());
+    for(size_t vehicle_idx = 0; vehicle_idx < cases.size(); vehicle_idx++){
+        for(size_t channel_idx = 0; channel_idx < cases[vehicle_idx].setpoint.size(); channel_idx++){
+            setpoints(channel_idx, vehicle_idx) = cases[vehicle_idx].setpoint[channel_idx];
+        }
+    }
+    return setpoints;
+}
+
+/**
+ * @brief A gap in a log is reported as a wrong log instead of an exception, the written tables round-trip
+ */
+TEST(VtolAeroIdentification, logAndTablesFiles){
+    const std::string logPath = testing::TempDir() + "aero_flight_log.csv";
+    const std::string goodLine = "20,0,0,1,0,0,0,0,0,0,0,0,-9.8,0,0,0,0,0,0,0.5,0.5,0.5,0.5,0.1,0,0,0\r";
+    std::vector<AeroFlightSample> samples;
+    std::ofstream(logPath) << "header\n" << goodLine << "\n";
+    ASSERT_EQ(loadAeroFlightLog(logPath, samples), 0);
+    EXPECT_EQ(samples.size(), 1);
+    const std::vector<std::string> wrongLines{"20,,0,1,0,0,0,0,0,0,0,0,-9.8,0,0,0,0,0,0",
+                                              "20,0,0,1,0,0,0,0,0,0,0,0,-9.8,0,0,0,0,0,1x"};
+    for(const auto& wrongLine : wrongLines){
+        std::ofstream(logPath) << "header\n" << wrongLine << "\n";
+        EXPECT_EQ(loadAeroFlightLog(logPath, samples), -1) << wrongLine;
+    }
+
+    VtolDynamics dynamics;
+    ASSERT_EQ(dynamics.init(), 0);
+    TablesWithCoeffs tables = dynamics.getTables();
+    tables.CLPolynomial /= 3.0;
+    const std::string tablesPath = testing::TempDir() + "aero_tables.yaml";
+    ASSERT_EQ(writeAeroTablesYaml(tablesPath, tables), 0);
+
+    std::ifstream file(tablesPath);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const size_t begin = content.find('[', content.find("CLPolynomial:")) + 1;
+    std::stringstream stream(content.substr(begin, content.find(']', begin) - begin));
+    std::string cell;
+    std::vector<double> values;
+    while(std::getline(stream, cell, ',')){
+        values.push_back(std::stod(cell));
+    }
+    ASSERT_EQ(values.size(), tables.CLPolynomial.size());
+    for(size_t idx = 0; idx < values.size(); idx++){
+        EXPECT_EQ(values[idx], tables.CLPolynomial.data()[idx]);
+    }
+}
+
+TEST(VtolFleet, equalToVtolDynamics){
+    constexpr size_t VEHICLES_AMOUNT = 16;
+    constexpr size_t STEPS = 960;
+    constexpr double DT_SECS = 1.0 / 960;
+    auto cases = createFleetCases(VEHICLES_AMOUNT);
+
+    std::vector<VtolDynamics> vehicles(VEHICLES_AMOUNT);
+    for(size_t idx = 0; idx < VEHICLES_AMOUNT; idx++){
+        ASSERT_EQ(vehicles[idx].init(), 0);
+        vehicles[idx].setInitialPosition(cases[idx].position, cases[idx].attitude);
+        vehicles[idx].setInitialVelocity(cases[idx].linearVelocity, cases[idx].angularVelocity);
+    }
+
+    VtolFleet fleet(vehicles.front(), VEHICLES_AMOUNT);
+    for(size_t idx = 0; idx < VEHICLES_AMOUNT; idx++){
+        fleet.setVehicleState(idx, cases[idx].position, cases[idx].attitude,
+                              cases[idx].linearVelocity, cases[idx].angularVelocity);
+    }
+    FleetArray setpoints = createFleetSetpoints(cases);
+
+    for(size_t step = 0; step < STEPS; step++){
+        fleet.process(DT_SECS, setpoints);
+        for(size_t idx = 0; idx < VEHICLES_AMOUNT; idx++){
+            vehicles[idx].process(DT_SECS, cases[idx].setpoint);
+        }
+    }
+
+    std::vector<double> motorsRpm;
+    for(size_t idx = 0; idx < VEHICLES_AMOUNT; idx++){
+        const auto& vehicle = vehicles[idx];
+        EXPECT_NEAR((fleet.getVehiclePosition(idx) - vehicle.getVehiclePosition()).norm(), 0, 1e-6);
+        EXPECT_NEAR((fleet.getVehicleVelocity(idx) - vehicle.getVehicleVelocity()).norm(), 0, 1e-6);
+        EXPECT_NEAR((fleet.getVehicleAirspeed(idx) - vehicle.getVehicleAirspeed()).norm(), 0, 1e-6);
+        EXPECT_NEAR((fleet.getVehicleAngularVelocity(idx) - vehicle.getVehicleAngularVelocity()).norm(), 0, 1e-6);
+        EXPECT_NEAR(fleet.getVehicleAttitude(idx).angularDistance(vehicle.getVehicleAttitude()), 0, 1e-6);
+
+        vehicles[idx].getMotorsRpm(motorsRpm);
+        for(size_t motor_idx = 0; motor_idx < fleet.getMotorsAmount(); motor_idx++){
+            EXPECT_NEAR(fleet.getState().motorsRpm(motor_idx, idx), motorsRpm[motor_idx], 1e-6);
+        }
+    }
+}
+
+/**
+ * @brief Accuracy regression of the float fleet against the double one over the fleet maneuvers:
+ * 3 seconds of flight with different attitudes, velocities, motors and servos
+ */
+TEST(VtolFleet, floatEqualToDouble){
+    constexpr size_t VEHICLES_AMOUNT = 16;
+    constexpr size_t STEPS = 3 * 960;
+    constexpr double DT_SECS = 1.0 / 960;
+    auto cases = createFleetCases(VEHICLES_AMOUNT);
+
+    VtolDynamics prototype;
+    ASSERT_EQ(prototype.init(), 0);
+    VtolFleet fleet(prototype, VEHICLES_AMOUNT);
+    VtolFleetF fleetFloat(prototype, VEHICLES_AMOUNT);
+    for(size_t idx = 0; idx < VEHICLES_AMOUNT; idx++){
+        fleet.setVehicleState(idx, cases[idx].position, cases[idx].attitude,
+                              cases[idx].linearVelocity, cases[idx].angularVelocity);
+        fleetFloat.setVehicleState(idx, cases[idx].position, cases[idx].attitude,
+                                   cases[idx].linearVelocity, cases[idx].angularVelocity);
+    }
+    FleetArray setpoints = createFleetSetpoints(cases);
+    FleetArrayT<float> setpointsFloat = setpoints.cast<float>();
+
+    for(size_t step = 0; step < STEPS; step++){
+        fleet.process(DT_SECS, setpoints);
+        fleetFloat.process(DT_SECS, setpointsFloat);
+    }
+
+    double maxPositionError = 0;
+    double maxVelocityError = 0;
+    double maxAttitudeError = 0;
+    for(size_t idx = 0; idx < VEHICLES_AMOUNT; idx++){
+        maxPositionError = std::max(maxPositionError,
+                                    (fleetFloat.getVehiclePosition(idx) - fleet.getVehiclePosition(idx)).norm());
+        maxVelocityError = std::max(maxVelocityError,
+                                    (fleetFloat.getVehicleVelocity(idx) - fleet.getVehicleVelocity(idx)).norm());
+        maxAttitudeError = std::max(maxAttitudeError,
+                                    fleetFloat.getVehicleAttitude(idx).angularDistance(fleet.getVehicleAttitude(idx)));
+    }
+    std::cout << "float fleet: position error = " << maxPositionError << " m, velocity error = "
+              << maxVelocityError << " m/sec, attitude error = " << maxAttitudeError << " rad" << std::endl;
+    EXPECT_LE(maxPositionError, 0.01);
+    EXPECT_LE(maxVelocityError, 0.01);
+    EXPECT_LE(maxAttitudeError, 0.002);
+}
+
+/**
+ * @brief The fleet should be faster than the separate vehicles in the Release build: about 3-4 times
+ * for a fleet that fits the cache, as here, and about 10 times for thousands of vehicles, when the
+ * tables copied into each VtolDynamics don't fit it anymore. The bound is conservative and the best
+ * of several runs is taken, so the machine load doesn't fail it.
+ */
+TEST(VtolFleet, fasterThanVtolDynamics){
+#ifndef NDEBUG
+    GTEST_SKIP() << "Timing is compared in the optimized build only";
+#endif
+    constexpr size_t VEHICLES_AMOUNT = 256;
+    constexpr size_t STEPS = 50;
+    constexpr size_t RUNS = 3;
+    constexpr double DT_SECS = 1.0 / 960;
+    constexpr double MIN_SPEEDUP = 2.0;
+    auto cases = createFleetCases(VEHICLES_AMOUNT);
+
+    std::vector<VtolDynamics> vehicles(VEHICLES_AMOUNT);
+    for(size_t idx = 0; idx < VEHICLES_AMOUNT; idx++){
+        ASSERT_EQ(vehicles[idx].init(), 0);
+        vehicles[idx].setInitialPosition(cases[idx].position, cases[idx].attitude);
+        vehicles[idx].setInitialVelocity(cases[idx].linearVelocity, cases[idx].angularVelocity);
+    }
+    VtolFleet fleet(vehicles.front(), VEHICLES_AMOUNT);
+    VtolFleetF fleetFloat(vehicles.front(), VEHICLES_AMOUNT);
+    for(size_t idx = 0; idx < VEHICLES_AMOUNT; idx++){
+        fleet.setVehicleState(idx, cases[idx].position, cases[idx].attitude,
+                              cases[idx].linearVelocity, cases[idx].angularVelocity);
+        fleetFloat.setVehicleState(idx, cases[idx].position, cases[idx].attitude,
+                                   cases[idx].linearVelocity, cases[idx].angularVelocity);
+    }
+    FleetArray setpoints = createFleetSetpoints(cases);
+    FleetArrayT<float> setpointsFloat = setpoints.cast<float>();
+
+    auto measureSecs = [](const auto& runSteps){
+        double bestSecs = std::numeric_limits<double>::max();
+        for(size_t run = 0; run < RUNS; run++){
+            auto start = std::chrono::steady_clock::now();
+            runSteps();
+            std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+            bestSecs = std::min(bestSecs, secs.count());
+        }
+        return bestSecs;
+    };
+    const double vehiclesSecs = measureSecs([&](){
+        for(size_t step = 0; step < STEPS; step++){
+            for(size_t idx = 0; idx < VEHICLES_AMOUNT; idx++){
+                vehicles[idx].process(DT_SECS, cases[idx].setpoint);
+            }
+        }
+    });
+    const double fleetSecs = measureSecs([&](){
+        for(size_t step = 0; step < STEPS; step++){
+            fleet.process(DT_SECS, setpoints);
+        }
+    });
+    const double fleetFloatSecs = measureSecs([&](){
+        for(size_t step = 0; step < STEPS; step++){
+            fleetFloat.process(DT_SECS, setpointsFloat);
+        }
+    });
+
+    EXPECT_TRUE(fleet.getState().positionZ.allFinite());
+    EXPECT_TRUE(fleetFloat.getState().positionZ.allFinite());
+    EXPECT_GE(vehiclesSecs / fleetSecs, MIN_SPEEDUP);
+    EXPECT_GE(vehiclesSecs / fleetFloatSecs, MIN_SPEEDUP);
+}
+
+TEST(VehicleParamsCache, writeAndMap){
+    const std::string source = testing::TempDir() + "vehicle_params_cache_source.yaml";
+    const std::string path = testing::TempDir() + "vehicle_params_cache.bin";
+    std::ofstream(source) << "mass: 7.0";
+    std::remove(path.c_str());
+
+    VehicleParamsCache writer;
+    ASSERT_FALSE(writer.open(path, {source}));
+    writer.record("mass", 7.0);
+    writer.record("CS_rudder_table", std::vector<double>{0.1, -0.2, 0.3});
+    writer.record("motorDirectionCCW", std::vector<bool>{true, false});
+    ASSERT_EQ(writer.write(), 0);
+
+    VehicleParamsCache reader;
+    ASSERT_TRUE(reader.open(path, {source}));
+    double mass;
+    std::vector<double> table;
+    std::vector<bool> directions;
+    ASSERT_TRUE(reader.get("mass", mass));
+    ASSERT_TRUE(reader.get("CS_rudder_table", table));
+    ASSERT_TRUE(reader.get("motorDirectionCCW", directions));
+    EXPECT_EQ(mass, 7.0);
+    EXPECT_EQ(table, std::vector<double>({0.1, -0.2, 0.3}));
+    EXPECT_EQ(directions, std::vector<bool>({true, false}));
+    EXPECT_FALSE(reader.get("wingArea", mass));
+    EXPECT_FALSE(reader.get("CS_rudder_table", mass));
+
+    // A damaged payload fails the checksum
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('\x7f');
+    }
+    EXPECT_FALSE(reader.open(path, {source}));
+    ASSERT_FALSE(reader.isMapped());
+
+    // A modified source outdates the cache
+    ASSERT_FALSE(writer.open(path, {source}));
+    writer.record("mass", 7.0);
+    ASSERT_EQ(writer.write(), 0);
+    ASSERT_TRUE(reader.open(path, {source}));
+    std::ofstream(source) << "mass: 8.25";
+    EXPECT_FALSE(reader.open(path, {source}));
+    EXPECT_FALSE(reader.open(path, {source + ".absent"}));
+}
+
+
 int main(int argc, char *argv[]){
     testing::InitGoogleTest(&argc, argv);
     ros::init(argc, argv, "tester");